@@ -10,6 +10,7 @@
 #include "esp_mac.h"
 
 #include "wireless/wireless.h"
+#include "wireless/rx_pool.h"
 
 #include "esp_mac.h"
 
@@ -19,12 +20,7 @@ void app_main(void) {
     
     current_mode = MOUSE_MODE;
     
-    tp_queue = xQueueCreate(1, sizeof(ptp_report_t));
-    mouse_queue = xQueueCreate(1, sizeof(mouse_hid_report_t));
-
-    main_queue_set = xQueueCreateSet(1 + 1);
-    xQueueAddToSet(mouse_queue, main_queue_set);
-    xQueueAddToSet(tp_queue, main_queue_set);
+    rx_pool_init();
 
     usb_event_group = xEventGroupCreate();
     
@@ -33,7 +29,9 @@ void app_main(void) {
     usbhid_init();
     wifi_recieve_task_init();
 
-    xTaskCreate(usbhid_task, "hid", 4096, NULL, 12, NULL);
+    TaskHandle_t hid_task_handle = NULL;
+    xTaskCreate(usbhid_task, "hid", 4096, NULL, 12, &hid_task_handle);
+    rx_pool_set_consumer(hid_task_handle);
 
     xTaskCreate(monitor_link_task, "heartbeat", 2048, NULL, 2, NULL);
 
@@ -46,9 +44,4 @@ void app_main(void) {
     ESP_LOGI("MAIN", "Device MAC: %02X:%02X:%02X:%02X:%02X:%02X",
              wifi_mac[0], wifi_mac[1], wifi_mac[2],
              wifi_mac[3], wifi_mac[4], wifi_mac[5]);
-
-    while (1) {
-        tud_task(); 
-        vTaskDelay(pdMS_TO_TICKS(1)); 
-    }
 }
\ No newline at end of file
@@ -19,6 +19,8 @@
 #include "usb/usbhid.h"
 
 #include "wireless/wireless.h"
+#include "wireless/rx_pool.h"
+#include "wireless/wl_mode.h"
 
 #include "sdkconfig.h"
 
@@ -111,6 +113,7 @@ uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_t
 }
 
 static uint8_t ptp_input_mode = 0x00;
+static TaskHandle_t mode_task = NULL;
 
 void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t const *buffer, uint16_t bufsize) {
     (void)instance;
@@ -120,6 +123,7 @@ void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_
     if (report_type == HID_REPORT_TYPE_FEATURE && report_id == REPORTID_FEATURE) {
         if (bufsize >= 1) {
             ptp_input_mode = buffer[0];
+            if (mode_task != NULL) xTaskNotifyGive(mode_task);
         }
     }
 
@@ -141,7 +145,11 @@ EventGroupHandle_t usb_event_group;
 
 static uint8_t last_ptp_input_mode = 0xFF;
 
+// Woken by SET_REPORT and detach, so a mode the host sets goes out to
+// the touch pad at once
 void usb_mount_task(void *arg) {
+    mode_task = xTaskGetCurrentTaskHandle();
+
     while (1) {
 
         xEventGroupWaitBits(
@@ -171,12 +179,12 @@ void usb_mount_task(void *arg) {
                     current_mode = MOUSE_MODE;
                     break;
                 }
-                esp_now_send(broadcast_mac, (const uint8_t *)&current_mode, 1);
+                wl_mode_request(current_mode);
 
                 last_ptp_input_mode = ptp_input_mode;
             }
 
-            vTaskDelay(pdMS_TO_TICKS(100));
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
         }
     }
 }
@@ -191,6 +199,7 @@ static void tinyusb_event_cb(tinyusb_event_t *event, void *arg) {
         case TINYUSB_EVENT_DETACHED:
             xEventGroupClearBits(usb_event_group, USB_CONNECTED);
             ptp_input_mode = 0x00;
+            if (mode_task != NULL) xTaskNotifyGive(mode_task);
             break;
 
         case TINYUSB_EVENT_SUSPENDED:
@@ -236,7 +245,10 @@ static void tinyusb_event_cb(tinyusb_event_t *event, void *arg) {
 // }
 
 void usbhid_init(void) {
+    // esp_tinyusb runs tud_task() in its own task, blocked on the TinyUSB
+    // event queue, so nothing else may call it.
     tinyusb_config_t tusb_cfg = TINYUSB_DEFAULT_CONFIG();
+    tusb_cfg.task.priority = USB_DEVICE_TASK_PRIORITY;
     tusb_cfg.descriptor.device = &desc_device;
     tusb_cfg.descriptor.full_speed_config = desc_configuration;
     tusb_cfg.descriptor.string = string_desc;
@@ -246,26 +258,77 @@ void usbhid_init(void) {
     ESP_ERROR_CHECK(tinyusb_driver_install(&tusb_cfg));
 }
 
+static TaskHandle_t hid_task = NULL;
+
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint16_t len) {
+    (void)instance; (void)report; (void)len;
+
+    // Endpoint free again: let usbhid_task submit the next slot
+    if (hid_task != NULL) {
+        xTaskNotifyGive(hid_task);
+    }
+}
+
+// Frames unpacked from one batch packet are spaced by their scan_time
+// (100 us units) instead of being sent back to back.
+#define RX_PACE_MAX_US  20000
+
+static int64_t pace_due_us(const rx_slot_t *slot, int64_t last_us, uint16_t last_scan) {
+    int64_t gap = (int64_t)(uint16_t)(slot->report.ptp.scan_time - last_scan) * 100;
+    if (gap > RX_PACE_MAX_US) gap = RX_PACE_MAX_US;
+    return last_us + gap;
+}
+
 void usbhid_task(void *arg) {
-    ptp_report_t tp_report; 
-    mouse_hid_report_t mouse_report;
+    int64_t last_ptp_us = 0;
+    uint16_t last_scan = 0;
+
+    hid_task = xTaskGetCurrentTaskHandle();
 
     while (1) {
-        QueueSetMemberHandle_t xActivatedMember = xQueueSelectFromSet(main_queue_set, portMAX_DELAY);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        rx_slot_t *slot;
+        bool stalled = false;
+        while ((slot = rx_pool_peek()) != NULL) {
+            uint8_t instance = (slot->type == MOUSE_MODE) ? 2 : 1;
+
+            if (!tud_mounted()) {
+                stalled = false;
+                rx_pool_count_discard();
+                rx_pool_release();
+                continue;
+            }
 
-        if (xActivatedMember == mouse_queue) {
-            if (xQueueReceive(mouse_queue, &mouse_report, 0)) {
-                if (tud_hid_n_ready(2)) {
-                    tud_hid_n_report(2, REPORTID_MOUSE, &mouse_report, sizeof(mouse_report));
-                }
+            // Keep the slot until the endpoint takes it; woken by
+            // tud_hid_report_complete_cb or the next received report
+            if (!tud_hid_n_ready(instance)) {
+                if (!stalled) rx_pool_count_overrun();
+                stalled = true;
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1));
+                continue;
             }
-        } 
-        else if (xActivatedMember == tp_queue) {
-            if (xQueueReceive(tp_queue, &tp_report, 0)) {
-                if (tud_hid_n_ready(1)) {
-                    tud_hid_n_report(1, REPORTID_TOUCHPAD, &tp_report, sizeof(tp_report));
+
+            int64_t now = esp_timer_get_time();
+
+            // Catch up instead of pacing once the pool is half full
+            if (slot->type == PTP_MODE && slot->paced && rx_pool_depth() < RX_POOL_DEPTH / 2) {
+                int64_t due = pace_due_us(slot, last_ptp_us, last_scan);
+                if (now < due) {
+                    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((due - now + 999) / 1000));
+                    continue;
                 }
             }
+
+            if (slot->type == MOUSE_MODE) {
+                tud_hid_n_report(2, REPORTID_MOUSE, &slot->report.mouse, sizeof(mouse_hid_report_t));
+            } else {
+                tud_hid_n_report(1, REPORTID_TOUCHPAD, &slot->report.ptp, sizeof(ptp_report_t));
+                last_ptp_us = now;
+                last_scan = slot->report.ptp.scan_time;
+            }
+            stalled = false;
+            rx_pool_release();
         }
     }
 }
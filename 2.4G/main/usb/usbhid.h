@@ -4,6 +4,10 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+// TinyUSB device task (esp_tinyusb), above usbhid_task so transfer
+// completions are handled before the next report is queued.
+#define USB_DEVICE_TASK_PRIORITY 13
+
 void usbhid_task(void *arg);
 void usbhid_init(void);
 void usb_mount_task(void *arg);
@@ -0,0 +1,84 @@
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#include "wireless/rx_pool.h"
+
+static const char *TAG = "RX_POOL";
+
+static rx_slot_t slots[RX_POOL_DEPTH];
+
+// head is only written by the Wi-Fi task, tail only by usbhid_task
+static atomic_uint head;
+static atomic_uint tail;
+
+static TaskHandle_t consumer_task = NULL;
+static rx_pool_stats_t stats;
+
+void rx_pool_init(void) {
+    atomic_init(&head, 0);
+    atomic_init(&tail, 0);
+    memset(&stats, 0, sizeof(stats));
+}
+
+void rx_pool_set_consumer(TaskHandle_t task) {
+    consumer_task = task;
+}
+
+rx_slot_t *rx_pool_acquire(void) {
+    unsigned h = atomic_load_explicit(&head, memory_order_relaxed);
+    unsigned t = atomic_load_explicit(&tail, memory_order_acquire);
+    if (h - t >= RX_POOL_DEPTH) return NULL;
+    return &slots[h % RX_POOL_DEPTH];
+}
+
+void rx_pool_publish(void) {
+    unsigned h = atomic_load_explicit(&head, memory_order_relaxed) + 1;
+    unsigned depth = h - atomic_load_explicit(&tail, memory_order_relaxed);
+
+    atomic_store_explicit(&head, h, memory_order_release);
+
+    stats.received++;
+    if (depth > stats.max_depth) stats.max_depth = depth;
+
+    if (consumer_task != NULL) {
+        xTaskNotifyGive(consumer_task);
+    }
+}
+
+void rx_pool_count_drop(void) {
+    if (stats.dropped++ == 0) {
+        ESP_LOGW(TAG, "Receive pool full, dropping reports");
+    }
+}
+
+rx_slot_t *rx_pool_peek(void) {
+    unsigned t = atomic_load_explicit(&tail, memory_order_relaxed);
+    unsigned h = atomic_load_explicit(&head, memory_order_acquire);
+    if (h == t) return NULL;
+    return &slots[t % RX_POOL_DEPTH];
+}
+
+unsigned rx_pool_depth(void) {
+    return atomic_load_explicit(&head, memory_order_acquire) -
+           atomic_load_explicit(&tail, memory_order_relaxed);
+}
+
+void rx_pool_release(void) {
+    unsigned t = atomic_load_explicit(&tail, memory_order_relaxed);
+    atomic_store_explicit(&tail, t + 1, memory_order_release);
+}
+
+void rx_pool_count_overrun(void) {
+    stats.overrun++;
+}
+
+void rx_pool_count_discard(void) {
+    stats.discarded++;
+}
+
+void rx_pool_get_stats(rx_pool_stats_t *out) {
+    *out = stats;
+}
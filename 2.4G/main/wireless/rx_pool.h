@@ -0,0 +1,58 @@
+#ifndef RX_POOL_H
+#define RX_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "wireless/wireless.h"
+
+// Preallocated report slots between the radio side and usbhid_task (single
+// consumer). Reports are produced from two tasks: the ESP-NOW receive
+// callback (Wi-Fi task) and the jitter buffer's hold-expiry timer
+// (esp_timer task), both through jitter_deliver in wifi_quene.c. They hold
+// jitter_lock from rx_pool_acquire to rx_pool_publish, so the pool only
+// ever sees one producer at a time; any new producer must take the same
+// lock. The producer writes the report straight into the next free slot
+// and publishes its index; the USB task submits the report from the slot
+// and then releases it, without any lock.
+
+#define RX_POOL_DEPTH 16
+
+typedef struct {
+    input_mode_t type;          // MOUSE_MODE or PTP_MODE
+    bool paced;                 // from a batch: send at its scan_time spacing
+    union {
+        mouse_hid_report_t mouse;
+        ptp_report_t       ptp;
+    } report;
+} rx_slot_t;
+
+typedef struct {
+    uint32_t received;          // reports placed in a slot
+    uint32_t dropped;           // pool full, report lost
+    uint32_t overrun;           // USB endpoint still busy when a report was due
+    uint32_t discarded;         // USB not mounted, report released unsent
+    uint8_t  max_depth;         // highest number of slots in use
+} rx_pool_stats_t;
+
+void rx_pool_init(void);
+void rx_pool_set_consumer(TaskHandle_t task);
+
+// Producer side, under jitter_lock
+rx_slot_t *rx_pool_acquire(void);
+void rx_pool_publish(void);
+void rx_pool_count_drop(void);
+
+// Consumer side (usbhid_task)
+rx_slot_t *rx_pool_peek(void);
+unsigned rx_pool_depth(void);
+void rx_pool_release(void);
+void rx_pool_count_overrun(void);
+void rx_pool_count_discard(void);
+
+void rx_pool_get_stats(rx_pool_stats_t *stats);
+
+#endif
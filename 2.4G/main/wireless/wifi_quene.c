@@ -2,6 +2,7 @@
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "esp_timer.h"
@@ -12,49 +13,157 @@
 #include "sdkconfig.h"
 
 #include "wireless/wireless.h"
+#include "wireless/rx_pool.h"
+#include "wl_proto.h"
+#include "wireless/wl_jitter.h"
+#include "wireless/wl_clock.h"
+#include "wireless/wl_mode.h"
 
-QueueHandle_t tp_queue = NULL;
-QueueHandle_t mouse_queue = NULL;
-QueueSetHandle_t main_queue_set = NULL;
 volatile uint8_t current_mode = MOUSE_MODE;
 
 static const char *TAG = "WIFI_QUENE";
 
-static void wifi_now_recv_cb(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len) {
-    if (len < sizeof(input_mode_t)) return;
+static wl_decoder_t decoder;
+static wl_jitter_t jitter;
 
-    wireless_msg_t *msg = (wireless_msg_t *)data;
+// The jitter buffer and decoder are shared by the Wi-Fi task (receive
+// callback) and the esp_timer task (hold expiry).
+static SemaphoreHandle_t jitter_lock = NULL;
+static esp_timer_handle_t jitter_timer = NULL;
 
-    switch (msg->type) {
-        case MOUSE_MODE:
-            if (len >= sizeof(input_mode_t) + sizeof(mouse_hid_report_t)) {
-                xQueueSend(mouse_queue, &msg->payload.mouse, 0);
-            }
+// Set while the frames of a batch packet are unpacked
+static bool unpacking_batch = false;
+
+static void rx_pool_put_mouse(const uint8_t *pkt, int len) {
+    if (len != WL_PROTO_HEADER_LEN + sizeof(mouse_hid_report_t)) return;
+
+    rx_slot_t *slot = rx_pool_acquire();
+    if (slot == NULL) {
+        rx_pool_count_drop();
+        return;
+    }
+
+    slot->type = MOUSE_MODE;
+    slot->paced = false;
+    memcpy(&slot->report.mouse, wl_payload(pkt), sizeof(mouse_hid_report_t));
+    rx_pool_publish();
+    wl_decoder_delivered(&decoder);
+}
+
+static void rx_pool_put_ptp(const uint8_t *pkt, int len) {
+    rx_slot_t *slot = rx_pool_acquire();
+
+    // Decode even when the pool is full so the delta reference stays valid;
+    // the frame is not delivered, so a keyframe repeat may still bring it
+    if (slot == NULL) {
+        ptp_report_t scratch;
+        wl_decode_ptp(&decoder, pkt, len, &scratch);
+        rx_pool_count_drop();
+        return;
+    }
+
+    if (wl_decode_ptp(&decoder, pkt, len, &slot->report.ptp)) {
+        ptp_report_t *report = &slot->report.ptp;
+        report->scan_time = wl_clock_scan_time(report->scan_time, esp_timer_get_time());
+        slot->type = PTP_MODE;
+        slot->paced = unpacking_batch;
+        rx_pool_publish();
+        wl_decoder_delivered(&decoder);
+    }
+}
+
+// Packets leave the jitter buffer in sequence order
+static void jitter_deliver(const uint8_t *pkt, size_t len, bool resync) {
+    if (resync) wl_decoder_resync(&decoder);
+    if (!wl_decoder_accept(&decoder, pkt)) return;
+
+    if ((pkt[0] & 0x0F) == WL_PKT_MOUSE) {
+        rx_pool_put_mouse(pkt, len);
+    } else {
+        rx_pool_put_ptp(pkt, len);
+    }
+}
+
+static void jitter_arm(bool holding) {
+    if (holding && !esp_timer_is_active(jitter_timer)) {
+        esp_timer_start_once(jitter_timer, WL_JITTER_HOLD_US);
+    }
+}
+
+static void jitter_timeout_cb(void *arg) {
+    xSemaphoreTake(jitter_lock, portMAX_DELAY);
+    bool holding = wl_jitter_poll(&jitter, (uint32_t)esp_timer_get_time(), jitter_deliver);
+    xSemaphoreGive(jitter_lock);
+
+    jitter_arm(holding);
+}
+
+static void jitter_push(const uint8_t *pkt, int len) {
+    xSemaphoreTake(jitter_lock, portMAX_DELAY);
+    wl_jitter_push(&jitter, pkt, len, (uint32_t)esp_timer_get_time(), jitter_deliver);
+    bool holding = jitter.holding;
+    xSemaphoreGive(jitter_lock);
+
+    jitter_arm(holding);
+}
+
+static void jitter_push_batch(const uint8_t *batch, int len) {
+    const uint8_t *pkt;
+    size_t pkt_len, pos = 0;
+    uint32_t now = (uint32_t)esp_timer_get_time();
+
+    xSemaphoreTake(jitter_lock, portMAX_DELAY);
+    unpacking_batch = true;
+    while (wl_batch_next(batch, len, &pos, &pkt, &pkt_len)) {
+        wl_jitter_push(&jitter, pkt, pkt_len, now, jitter_deliver);
+    }
+    unpacking_batch = false;
+    bool holding = jitter.holding;
+    xSemaphoreGive(jitter_lock);
+
+    jitter_arm(holding);
+}
+
+static void wifi_now_recv_cb(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len) {
+    const alive_msg_t *alive;
+    const vbus_msg_t *vbus;
+
+    switch (wl_packet_type(&decoder, data, len)) {
+        case WL_PKT_MOUSE:
+        case WL_PKT_PTP_KEY:
+        case WL_PKT_PTP_DELTA:
+            jitter_push(data, len);
             break;
 
-        case PTP_MODE:
-            if (len >= sizeof(input_mode_t) + sizeof(ptp_report_t)) {
-                xQueueSend(tp_queue, &msg->payload.ptp, 0);
-            }
+        case WL_PKT_BATCH:
+            jitter_push_batch(data, len);
             break;
 
-        case VBUS_STATUS: 
-    
-            gpio_set_level(CONFIG_CONN_LED_GPIO_CFG, msg->payload.vbus.vbus_level);
-            // ESP_DRAM_LOGI(TAG, "Remote VBUS Level: %d", msg->payload.vbus.vbus_level);
+        case WL_PKT_VBUS:
+            if (len < WL_PROTO_HEADER_LEN + sizeof(vbus_msg_t)) break;
+            vbus = (const vbus_msg_t *)wl_payload(data);
+            gpio_set_level(CONFIG_CONN_LED_GPIO_CFG, vbus->vbus_level);
+            // ESP_DRAM_LOGI(TAG, "Remote VBUS Level: %d", vbus->vbus_level);
             break;
 
-        case ALIVE_MODE:
+        case WL_PKT_ALIVE:
+            if (len < WL_PROTO_HEADER_LEN + sizeof(alive_msg_t)) break;
+            alive = (const alive_msg_t *)wl_payload(data);
 
             // ESP_DRAM_LOGI(TAG,"LAST_SEEN_TIMESTAMP before: %u", last_seen_timestamp);
             last_seen_timestamp = xTaskGetTickCount();
-            gpio_set_level(CONFIG_CONN_LED_GPIO_CFG, msg->payload.alive.vbus_level);
-            if (msg->payload.alive.vbus_level == 0) {
-                ESP_LOGI(TAG, "Device online, sending current mode: %d", current_mode);
-                esp_now_send(broadcast_mac, (const uint8_t *)&current_mode, 1);
+            wl_clock_sample(alive->clock_us, esp_timer_get_time());
+            gpio_set_level(CONFIG_CONN_LED_GPIO_CFG, alive->vbus_level);
+            if (alive->vbus_level == 0) {
+                wl_mode_on_alive(alive->mode);
             }
             break;
 
+        case WL_PKT_MODE_ACK:
+            if (len < WL_PROTO_HEADER_LEN + sizeof(mode_ack_msg_t)) break;
+            wl_mode_on_ack((const mode_ack_msg_t *)wl_payload(data));
+            break;
+
         default:
             break;
     }
@@ -81,6 +190,18 @@ void wifi_recieve_task_init() {
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
     ESP_ERROR_CHECK(esp_wifi_start());
 
+    wl_decoder_init(&decoder);
+    wl_jitter_init(&jitter);
+    wl_clock_init();
+    jitter_lock = xSemaphoreCreateMutex();
+
+    const esp_timer_create_args_t jitter_timer_args = {
+        .callback = &jitter_timeout_cb,
+        .name = "wl_jitter"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&jitter_timer_args, &jitter_timer));
+
     ESP_ERROR_CHECK(esp_now_init());
+    wl_mode_init();
     ESP_ERROR_CHECK(esp_now_register_recv_cb(wifi_now_recv_cb));
 }
\ No newline at end of file
@@ -4,9 +4,9 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 
-extern QueueHandle_t tp_queue;
-extern QueueHandle_t mouse_queue;
-extern QueueSetHandle_t main_queue_set;
+#include "ptp_wire.h"
+#include "wl_msg.h"
+
 extern uint32_t last_seen_timestamp;
 
 typedef struct {
@@ -31,12 +31,6 @@ typedef struct __attribute__((packed)) {
     uint8_t vbus_level;
 } vbus_msg_t;
 
-typedef struct __attribute__((packed)) {
-    uint8_t vbus_level;
-    uint8_t battery_level;
-    uint32_t uptime;
-} alive_msg_t;
-
 typedef enum {
     MOUSE_MODE = 0,
     PTP_MODE = 1,
@@ -44,35 +38,12 @@ typedef enum {
     ALIVE_MODE = 3
 } input_mode_t;
 
-typedef struct __attribute__((packed)) {
-    uint8_t tip_conf_id;  // Bit0:Conf, Bit1:Tip, Bit2-7:ID
-    uint16_t x;           
-    uint16_t y;           
-} finger_t;
-
-typedef struct __attribute__((packed)) {
-    finger_t fingers[5];   // 5 * 5 = 25 bytes
-    uint16_t scan_time;    // 2 bytes
-    uint8_t contact_count; // 1 byte
-    uint8_t buttons;       // 1 byte
-} ptp_report_t;
-
 typedef struct __attribute__((packed)) {
     uint8_t buttons;
     int8_t  x;
     int8_t  y;
 } mouse_hid_report_t;
 
-typedef struct __attribute__((packed)) {
-    input_mode_t type;
-    union {
-        mouse_hid_report_t mouse;
-        ptp_report_t       ptp;
-        vbus_msg_t         vbus;
-        alive_msg_t        alive;
-    } payload;
-} wireless_msg_t;
-
 extern volatile uint8_t current_mode;
 extern uint8_t broadcast_mac[6];
 
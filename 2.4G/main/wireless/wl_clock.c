@@ -0,0 +1,75 @@
+#include <stdbool.h>
+
+#include "wl_proto.h"
+#include "wireless/wl_clock.h"
+
+#define PERIOD WL_PROTO_CLOCK_PERIOD_US
+
+static uint32_t samples[WL_CLOCK_WINDOW];
+static uint8_t sample_count;
+static uint8_t sample_next;
+
+static volatile uint32_t offset_us;     // rx - tx, modulo PERIOD
+static volatile bool have_offset;
+
+static uint16_t last_out;
+static bool have_out;
+
+// Signed distance a - b on the clock circle
+static int32_t circ_diff(uint32_t a, uint32_t b) {
+    int32_t d = (int32_t)((a + PERIOD - b) % PERIOD);
+    return d >= (int32_t)(PERIOD / 2) ? d - (int32_t)PERIOD : d;
+}
+
+void wl_clock_init(void) {
+    sample_count = 0;
+    sample_next = 0;
+    have_offset = false;
+    have_out = false;
+}
+
+void wl_clock_sample(uint32_t tx_clock_us, int64_t rx_us) {
+    uint32_t rx_clock = (uint32_t)(rx_us % PERIOD);
+    uint32_t sample = (rx_clock + PERIOD - tx_clock_us % PERIOD) % PERIOD;
+
+    if (have_offset && sample_count > 0) {
+        int32_t jump = circ_diff(sample, offset_us);
+        if (jump > WL_CLOCK_RESET_US || jump < -WL_CLOCK_RESET_US) {
+            sample_count = 0;
+            sample_next = 0;
+        }
+    }
+
+    samples[sample_next] = sample;
+    sample_next = (sample_next + 1) % WL_CLOCK_WINDOW;
+    if (sample_count < WL_CLOCK_WINDOW) sample_count++;
+
+    uint32_t best = samples[0];
+    for (int i = 1; i < sample_count; i++) {
+        if (circ_diff(samples[i], best) < 0) best = samples[i];
+    }
+
+    offset_us = best;
+    have_offset = true;
+}
+
+uint16_t wl_clock_scan_time(uint16_t tx_scan, int64_t rx_us) {
+    uint32_t tx_clock = (uint32_t)tx_scan * 100;
+
+    if (!have_offset) {
+        offset_us = ((uint32_t)(rx_us % PERIOD) + PERIOD - tx_clock) % PERIOD;
+        have_offset = true;
+    }
+
+    uint16_t out = (uint16_t)(((tx_clock + offset_us) % PERIOD) / 100);
+
+    // Small steps back come from offset updates; anything larger is the
+    // 16-bit clock wrapping during a pause and is left alone.
+    int16_t step = (int16_t)(out - last_out);
+    if (have_out && step <= 0 && step > -(int16_t)(WL_CLOCK_RESET_US / 100)) {
+        out = last_out + 1;
+    }
+    last_out = out;
+    have_out = true;
+    return out;
+}
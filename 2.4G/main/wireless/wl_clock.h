@@ -0,0 +1,24 @@
+#ifndef WL_CLOCK_H
+#define WL_CLOCK_H
+
+#include <stdint.h>
+
+// Maps the transmitter's capture clock (PTP scan_time on the wire, see
+// wl_proto.h) into the receiver's esp_timer, in the same 100 us unit.
+//
+// Each ALIVE heartbeat gives one offset sample (receive time minus send
+// time). The smallest offset of the last WL_CLOCK_WINDOW samples is the
+// one with the least radio and queueing delay and is used as the offset.
+// Until the first heartbeat the first frame seeds the offset.
+
+#define WL_CLOCK_WINDOW     4
+#define WL_CLOCK_RESET_US   50000   // a jump this large means the sender restarted
+
+void wl_clock_init(void);
+void wl_clock_sample(uint32_t tx_clock_us, int64_t rx_us);
+
+// Transmitter scan time to receiver scan time. Output never goes
+// backwards between calls.
+uint16_t wl_clock_scan_time(uint16_t tx_scan, int64_t rx_us);
+
+#endif
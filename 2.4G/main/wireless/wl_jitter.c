@@ -0,0 +1,112 @@
+#include <string.h>
+
+#include "wireless/wl_jitter.h"
+
+#define SLOT(jb, seq) (&(jb)->slots[(seq) & (WL_JITTER_DEPTH - 1)])
+
+void wl_jitter_init(wl_jitter_t *jb) {
+    memset(jb, 0, sizeof(*jb));
+}
+
+// Delivers held packets from next_seq on until the next gap.
+static void release_in_order(wl_jitter_t *jb, wl_jitter_deliver_t deliver) {
+    wl_jitter_slot_t *slot;
+    while ((slot = SLOT(jb, jb->next_seq))->used && slot->data[1] == jb->next_seq) {
+        deliver(slot->data, slot->len, false);
+        slot->used = false;
+        jb->next_seq++;
+        jb->reordered++;
+    }
+}
+
+static bool any_held(const wl_jitter_t *jb) {
+    for (int i = 0; i < WL_JITTER_DEPTH; i++) {
+        if (jb->slots[i].used) return true;
+    }
+    return false;
+}
+
+// Gives up on every missing sequence number and delivers all held packets.
+static void release_all(wl_jitter_t *jb, wl_jitter_deliver_t deliver) {
+    while (any_held(jb)) {
+        release_in_order(jb, deliver);
+        if (!any_held(jb)) break;
+        jb->next_seq++;
+        jb->skipped++;
+    }
+    jb->holding = false;
+}
+
+void wl_jitter_push(wl_jitter_t *jb, const uint8_t *pkt, size_t len, uint32_t now_us,
+                    wl_jitter_deliver_t deliver) {
+    uint8_t seq = pkt[1];
+
+    if (len > WL_PROTO_MAX_PACKET) return;
+
+    if (jb->holding && now_us - jb->held_since_us >= WL_JITTER_HOLD_US) {
+        release_all(jb, deliver);
+    }
+
+    if (!jb->have_seq) {
+        jb->next_seq = seq;
+        jb->have_seq = true;
+    }
+
+    int8_t diff = (int8_t)(seq - jb->next_seq);
+
+    // A keyframe repeat of the last delivered frame goes to the decoder,
+    // which knows whether the original reached the host and drops it if so.
+    if (diff == -1 && (pkt[0] & 0x0F) == WL_PKT_PTP_KEY) {
+        jb->duplicate++;
+        deliver(pkt, len, false);
+        return;
+    }
+
+    // Repeats come at most WL_PROTO_REDUNDANCY in a row; a longer run of
+    // old sequence numbers means the sender restarted its counter.
+    if (diff < 0 && ++jb->stale_run <= 2 * WL_JITTER_DEPTH) {
+        jb->duplicate++;
+        return;
+    }
+    jb->stale_run = 0;
+
+    // Too far ahead (or behind) to wait for: the sender restarted or a long
+    // burst was lost. Flush and resynchronise on this packet.
+    bool resync = diff < 0 || diff >= WL_JITTER_DEPTH;
+    if (resync) {
+        release_all(jb, deliver);
+        if (diff > 0) jb->skipped += (uint8_t)(seq - jb->next_seq);
+        jb->next_seq = seq;
+        diff = 0;
+    }
+
+    if (diff == 0) {
+        deliver(pkt, len, resync);
+        jb->next_seq++;
+        release_in_order(jb, deliver);
+        jb->holding = any_held(jb);
+        return;
+    }
+
+    wl_jitter_slot_t *slot = SLOT(jb, seq);
+    if (slot->used && slot->data[1] == seq) {
+        jb->duplicate++;
+        return;
+    }
+
+    memcpy(slot->data, pkt, len);
+    slot->len = len;
+    slot->used = true;
+
+    if (!jb->holding) {
+        jb->holding = true;
+        jb->held_since_us = now_us;
+    }
+}
+
+bool wl_jitter_poll(wl_jitter_t *jb, uint32_t now_us, wl_jitter_deliver_t deliver) {
+    if (jb->holding && now_us - jb->held_since_us >= WL_JITTER_HOLD_US) {
+        release_all(jb, deliver);
+    }
+    return jb->holding;
+}
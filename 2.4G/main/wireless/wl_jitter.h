@@ -0,0 +1,52 @@
+#ifndef WL_JITTER_H
+#define WL_JITTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "wl_proto.h"
+
+// Reorders input packets by sequence number before they reach the
+// decoder. In-order packets pass straight through; a packet that arrives
+// after a gap is held until the missing one shows up or
+// WL_JITTER_HOLD_US has passed, then everything held is released in
+// order and the gap is given up.
+
+#define WL_JITTER_DEPTH     4           // power of two
+#define WL_JITTER_HOLD_US   8000        // about one frame at 125 Hz
+
+typedef struct {
+    bool used;
+    uint8_t len;
+    uint8_t data[WL_PROTO_MAX_PACKET];
+} wl_jitter_slot_t;
+
+typedef struct {
+    wl_jitter_slot_t slots[WL_JITTER_DEPTH];
+    uint8_t next_seq;           // next sequence number to deliver
+    bool have_seq;
+    bool holding;
+    uint8_t stale_run;          // consecutive packets behind next_seq
+    uint32_t held_since_us;
+
+    uint32_t reordered;         // held packets released in order
+    uint32_t duplicate;         // repeats and late packets dropped
+    uint32_t skipped;           // sequence numbers given up
+} wl_jitter_t;
+
+// resync is set for the first packet after the sequence was restarted;
+// the decoder must not treat it as a gap or a late packet.
+typedef void (*wl_jitter_deliver_t)(const uint8_t *pkt, size_t len, bool resync);
+
+void wl_jitter_init(wl_jitter_t *jb);
+
+// Input packets (mouse or PTP) only.
+void wl_jitter_push(wl_jitter_t *jb, const uint8_t *pkt, size_t len, uint32_t now_us,
+                    wl_jitter_deliver_t deliver);
+
+// Releases held packets whose wait has expired. Returns true while
+// packets are still held.
+bool wl_jitter_poll(wl_jitter_t *jb, uint32_t now_us, wl_jitter_deliver_t deliver);
+
+#endif
@@ -0,0 +1,123 @@
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_now.h"
+
+#include "wireless/wireless.h"
+#include "wl_proto.h"
+#include "wireless/wl_mode.h"
+
+static const char *TAG = "WL_MODE";
+
+static esp_timer_handle_t retry_timer = NULL;
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Command in flight, guarded by lock
+static bool pending;
+static uint8_t pending_mode;
+static uint8_t pending_token;
+static uint8_t retries_left;
+static int64_t requested_at;
+static uint8_t next_token = 1;
+
+static void send_command(uint8_t mode, uint8_t token) {
+    mode_msg_t cmd = {
+        .mode = mode,
+        .token = token,
+    };
+    uint8_t pkt[WL_PROTO_MAX_PACKET];
+    size_t len = wl_encode_status(WL_PKT_MODE, &cmd, sizeof(cmd), pkt);
+    esp_now_send(broadcast_mac, pkt, len);
+}
+
+static void retry_cb(void *arg) {
+    bool resend = false, give_up = false;
+    uint8_t mode = 0, token = 0;
+
+    portENTER_CRITICAL(&lock);
+    if (pending && retries_left > 0) {
+        retries_left--;
+        mode = pending_mode;
+        token = pending_token;
+        resend = true;
+    } else if (pending) {
+        pending = false;
+        mode = pending_mode;
+        give_up = true;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if (resend) {
+        send_command(mode, token);
+        return;
+    }
+
+    esp_timer_stop(retry_timer);
+    if (give_up) {
+        // The next heartbeat with another mode sends it again
+        ESP_LOGW(TAG, "Mode %u not acknowledged", mode);
+    }
+}
+
+void wl_mode_request(uint8_t mode) {
+    // USB may set a mode before the radio is up; the first heartbeat
+    // repairs it
+    if (retry_timer == NULL) return;
+
+    portENTER_CRITICAL(&lock);
+    uint8_t token = next_token++;
+    if (next_token == 0) next_token = 1;
+    pending = true;
+    pending_mode = mode;
+    pending_token = token;
+    retries_left = WL_PROTO_MODE_RETRIES;
+    requested_at = esp_timer_get_time();
+    portEXIT_CRITICAL(&lock);
+
+    send_command(mode, token);
+
+    esp_timer_stop(retry_timer);
+    esp_timer_start_periodic(retry_timer, WL_PROTO_MODE_RETRY_MS * 1000);
+}
+
+void wl_mode_on_ack(const mode_ack_msg_t *ack) {
+    bool matched = false;
+    int64_t took = 0;
+
+    portENTER_CRITICAL(&lock);
+    if (pending && ack->token == pending_token) {
+        pending = false;
+        matched = true;
+        took = esp_timer_get_time() - requested_at;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if (!matched) return;
+
+    esp_timer_stop(retry_timer);
+    if (ack->ok) {
+        ESP_LOGI(TAG, "Touch pad in mode %u after %lu us", ack->mode, (unsigned long)took);
+    } else {
+        ESP_LOGW(TAG, "Touch pad failed to switch, still in mode %u", ack->mode);
+    }
+}
+
+void wl_mode_on_alive(uint8_t remote_mode) {
+    portENTER_CRITICAL(&lock);
+    bool idle = !pending;
+    portEXIT_CRITICAL(&lock);
+
+    if (idle && remote_mode != current_mode) {
+        ESP_LOGI(TAG, "Touch pad in mode %u, sending mode %u", remote_mode, current_mode);
+        wl_mode_request(current_mode);
+    }
+}
+
+void wl_mode_init(void) {
+    const esp_timer_create_args_t retry_timer_args = {
+        .callback = &retry_cb,
+        .name = "wl_mode"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&retry_timer_args, &retry_timer));
+}
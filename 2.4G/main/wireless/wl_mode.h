@@ -0,0 +1,26 @@
+#ifndef WL_MODE_H
+#define WL_MODE_H
+
+#include <stdint.h>
+
+#include "wireless/wireless.h"
+
+// Mode commands to the touch pad (WL_PKT_MODE, see wl_proto.h). Each
+// request gets a new token and is sent again every WL_PROTO_MODE_RETRY_MS
+// until the touch pad acknowledges that token, at most
+// WL_PROTO_MODE_RETRIES times. The time from the request to the
+// acknowledgement is logged.
+//
+// Called from usb_mount_task and the ESP-NOW receive callback; the
+// retries run in the esp_timer task.
+
+void wl_mode_init(void);
+void wl_mode_request(uint8_t mode);
+
+void wl_mode_on_ack(const mode_ack_msg_t *ack);
+
+// Mode the touch pad reports in its heartbeat. A mismatch with
+// current_mode and no command in flight sends current_mode again.
+void wl_mode_on_alive(uint8_t remote_mode);
+
+#endif
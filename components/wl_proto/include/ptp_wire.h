@@ -0,0 +1,22 @@
+#ifndef PTP_WIRE_H
+#define PTP_WIRE_H
+
+#include <stdint.h>
+
+// PTP input report as the host sees it (report ID 0x01) and as it crosses
+// the air between the touch pad and the receiver.
+
+typedef struct __attribute__((packed)) {
+    uint8_t tip_conf_id;  // Bit0:Conf, Bit1:Tip, Bit2-7:ID
+    uint16_t x;           
+    uint16_t y;           
+} finger_t;
+
+typedef struct __attribute__((packed)) {
+    finger_t fingers[5];   // 5 * 5 = 25 bytes
+    uint16_t scan_time;    // 2 bytes
+    uint8_t contact_count; // 1 byte
+    uint8_t buttons;       // 1 byte
+} ptp_report_t;
+
+#endif
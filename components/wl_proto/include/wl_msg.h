@@ -0,0 +1,28 @@
+#ifndef WL_MSG_H
+#define WL_MSG_H
+
+#include <stdint.h>
+
+// Status payloads that follow the wl_proto header. The receiver sends
+// mode_msg_t; everything else comes from the touch pad.
+
+typedef struct __attribute__((packed)) {
+    uint8_t vbus_level;
+    uint8_t battery_level;
+    uint32_t uptime;
+    uint32_t clock_us;      // transmitter esp_timer modulo WL_PROTO_CLOCK_PERIOD_US, at send
+    uint8_t mode;           // input_mode_t the touch pad is in
+} alive_msg_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t mode;           // input_mode_t
+    uint8_t token;          // echoed by the acknowledgement
+} mode_msg_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t mode;           // input_mode_t the touch pad is in now
+    uint8_t token;
+    uint8_t ok;             // 0 when switching the controller failed
+} mode_ack_msg_t;
+
+#endif
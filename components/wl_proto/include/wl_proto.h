@@ -0,0 +1,158 @@
+#ifndef WL_PROTO_H
+#define WL_PROTO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ptp_wire.h"
+
+// ESP-NOW wire format between the touch pad and the 2.4G receiver, built
+// into both projects from this component.
+//
+// Every packet starts with a two byte header:
+//   byte 0  version (high nibble) | packet type (low nibble)
+//   byte 1  frame sequence number, +1 per input frame (mouse or touch)
+//
+// The PTP scan_time on the wire is the transmitter's capture time in
+// 100 us ticks of its esp_timer (low 16 bits), not the controller's scan
+// time. ALIVE packets carry the same clock, in microseconds modulo
+// WL_PROTO_CLOCK_PERIOD_US, so the receiver can map it into its own.
+//
+// A PTP keyframe carries the whole ptp_report_t. A PTP delta frame is
+// relative to the previous PTP frame and is only usable when no sequence
+// number was lost since then:
+//   varint   scan_time delta (mod 2^16)
+//   uint8    bit0-4 fingers with moved x/y, bit5 count/buttons follow,
+//            bit6 tip/confidence byte follows
+//   [uint8   bit0-4 fingers whose tip_conf_id follows]  [tip_conf_id ...]
+//   [uint8   contact_count, uint8 buttons]
+//   per moved finger: zigzag varint dx, zigzag varint dy
+//
+// After a frame that changes tip/confidence, contact count or buttons, the
+// next WL_PROTO_REDUNDANCY frames are sent as keyframes. If no frame
+// follows, the last one is repeated as a keyframe with the same sequence
+// number, so a lost state change is always repaired.
+//
+// A batch packet (seq byte unused) carries several input packets, each
+// prefixed by its length, when the air is too busy for one per frame:
+//   [uint8 len][packet] [uint8 len][packet] ...
+//
+// Mode commands (receiver -> touch pad, seq byte unused) carry the mode
+// the host selected and a token; the touch pad answers each with a
+// MODE_ACK echoing the token and the mode it is in. The receiver sends
+// a command again every WL_PROTO_MODE_RETRY_MS until it is acknowledged,
+// at most WL_PROTO_MODE_RETRIES times; after that the mode reported in
+// ALIVE packets still repairs a mismatch.
+
+#define WL_PROTO_VERSION        3
+#define WL_PROTO_HEADER_LEN     2
+#define WL_PROTO_MAX_PACKET     48
+#define WL_PROTO_MAX_BATCH      250     // ESP_NOW_MAX_DATA_LEN
+
+// Wrap period of the 16-bit, 100 us scan time clock
+#define WL_PROTO_CLOCK_PERIOD_US (100u * 65536u)
+
+// A delta chain is cut by a keyframe at least this often, and after a
+// pause longer than WL_PROTO_KEY_IDLE scan time units (100 us).
+#define WL_PROTO_KEY_INTERVAL   16
+#define WL_PROTO_KEY_IDLE       1000
+
+#define WL_PROTO_REDUNDANCY     2
+#define WL_PROTO_REPEAT_MS      8
+
+#define WL_PROTO_MODE_RETRY_MS  20
+#define WL_PROTO_MODE_RETRIES   10
+
+typedef enum {
+    WL_PKT_MOUSE     = 0,
+    WL_PKT_PTP_KEY   = 1,
+    WL_PKT_PTP_DELTA = 2,
+    WL_PKT_VBUS      = 3,
+    WL_PKT_ALIVE     = 4,
+    WL_PKT_BATCH     = 5,
+    WL_PKT_MODE      = 6,
+    WL_PKT_MODE_ACK  = 7,
+} wl_pkt_type_t;
+
+typedef struct {
+    ptp_report_t ref;           // last frame sent
+    uint8_t seq;
+    uint8_t since_key;
+    uint8_t redundant;          // keyframes still owed for a state change
+    bool have_ref;
+} wl_encoder_t;
+
+typedef struct {
+    ptp_report_t ref;           // last frame decoded
+    uint8_t seq;                // sequence number of the last input frame
+    bool have_seq;
+    bool have_ref;
+    bool delivered;             // frame seq reached the host
+    uint32_t lost;              // sequence numbers skipped
+    uint32_t late;              // frames older than the last one, dropped
+    uint32_t unreferenced;      // deltas dropped while waiting for a keyframe
+    uint32_t bad;               // wrong version or malformed
+    uint32_t repeats;           // keyframe repeats of a delivered frame, dropped
+} wl_decoder_t;
+
+void wl_encoder_init(wl_encoder_t *enc);
+void wl_decoder_init(wl_decoder_t *dec);
+
+// Encoder side. Each returns the packet length written to out
+// (WL_PROTO_MAX_PACKET bytes available).
+size_t wl_encode_ptp(wl_encoder_t *enc, const ptp_report_t *report, uint8_t *out);
+size_t wl_encode_mouse(wl_encoder_t *enc, const void *report, size_t len, uint8_t *out);
+
+// Keyframe repeat of the last PTP frame, same sequence number. Returns 0
+// once the owed keyframes have been sent.
+size_t wl_encode_repeat(wl_encoder_t *enc, uint8_t *out);
+
+static inline bool wl_encoder_repeat_pending(const wl_encoder_t *enc) {
+    return enc->have_ref && enc->redundant > 0;
+}
+
+// Owe keyframes again, e.g. after a send failure.
+void wl_encoder_resync(wl_encoder_t *enc);
+
+// Status packets carry no frame and do not advance the sequence.
+size_t wl_encode_status(wl_pkt_type_t type, const void *payload, size_t len, uint8_t *out);
+
+// Appends an encoded packet to a batch (WL_PROTO_MAX_BATCH bytes). Starts
+// the batch when batch_len is 0. Returns the new batch length, or 0 when
+// the packet does not fit.
+size_t wl_batch_add(uint8_t *batch, size_t batch_len, const uint8_t *pkt, size_t len);
+
+// Walks the packets of a received batch; *pos starts at 0. Returns false
+// at the end or on a malformed entry.
+bool wl_batch_next(const uint8_t *batch, size_t len, size_t *pos, const uint8_t **pkt, size_t *pkt_len);
+
+// Decoder side. Returns the packet type, or -1 for a packet that cannot
+// be used (wrong version, too short).
+int wl_packet_type(wl_decoder_t *dec, const uint8_t *pkt, size_t len);
+
+// Sequence check for an input frame (mouse or PTP). Returns false for a
+// late or duplicate packet, which must be dropped. A keyframe repeat of
+// the last frame is only accepted while that frame has not been delivered
+// (its original was lost or could not be used), so the host sees each
+// frame once. A gap invalidates the delta reference.
+bool wl_decoder_accept(wl_decoder_t *dec, const uint8_t *pkt);
+
+// The last accepted frame reached the host; repeats of it are dropped.
+static inline void wl_decoder_delivered(wl_decoder_t *dec) {
+    dec->delivered = true;
+}
+
+// Forget the sequence (sender restarted): the next packet is accepted as
+// is, and only a keyframe can follow it.
+void wl_decoder_resync(wl_decoder_t *dec);
+
+// Rebuilds the PTP report of a key or delta packet already accepted by
+// wl_decoder_accept. Returns false when the frame cannot be rebuilt.
+bool wl_decode_ptp(wl_decoder_t *dec, const uint8_t *pkt, size_t len, ptp_report_t *report);
+
+static inline const uint8_t *wl_payload(const uint8_t *pkt) {
+    return pkt + WL_PROTO_HEADER_LEN;
+}
+
+#endif
@@ -0,0 +1,294 @@
+#include <string.h>
+
+#include "wl_proto.h"
+
+#define DELTA_MOVED_MASK    0x1F
+#define DELTA_META          0x20
+#define DELTA_TIP           0x40
+
+#define KEY_LEN (WL_PROTO_HEADER_LEN + sizeof(ptp_report_t))
+
+void wl_encoder_init(wl_encoder_t *enc) {
+    memset(enc, 0, sizeof(*enc));
+}
+
+void wl_decoder_init(wl_decoder_t *dec) {
+    memset(dec, 0, sizeof(*dec));
+}
+
+static void put_header(uint8_t *out, wl_pkt_type_t type, uint8_t seq) {
+    out[0] = (WL_PROTO_VERSION << 4) | type;
+    out[1] = seq;
+}
+
+static uint8_t *put_varint(uint8_t *p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static const uint8_t *get_varint(const uint8_t *p, const uint8_t *end, uint32_t *v) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 21 && p < end; shift += 7) {
+        uint8_t b = *p++;
+        result |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *v = result;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static bool state_changed(const ptp_report_t *ref, const ptp_report_t *cur) {
+    if (cur->contact_count != ref->contact_count || cur->buttons != ref->buttons) return true;
+    for (int i = 0; i < 5; i++) {
+        if (cur->fingers[i].tip_conf_id != ref->fingers[i].tip_conf_id) return true;
+    }
+    return false;
+}
+
+static size_t encode_key(const wl_encoder_t *enc, uint8_t *out) {
+    put_header(out, WL_PKT_PTP_KEY, enc->seq);
+    memcpy(out + WL_PROTO_HEADER_LEN, &enc->ref, sizeof(ptp_report_t));
+    return KEY_LEN;
+}
+
+static size_t encode_delta(const ptp_report_t *ref, const ptp_report_t *cur, uint8_t *out) {
+    uint8_t *p = out;
+    uint8_t moved = 0, tip = 0;
+
+    for (int i = 0; i < 5; i++) {
+        if (cur->fingers[i].x != ref->fingers[i].x || cur->fingers[i].y != ref->fingers[i].y) {
+            moved |= 1u << i;
+        }
+        if (cur->fingers[i].tip_conf_id != ref->fingers[i].tip_conf_id) {
+            tip |= 1u << i;
+        }
+    }
+
+    bool meta = cur->contact_count != ref->contact_count || cur->buttons != ref->buttons;
+
+    p = put_varint(p, (uint16_t)(cur->scan_time - ref->scan_time));
+    *p++ = moved | (meta ? DELTA_META : 0) | (tip ? DELTA_TIP : 0);
+
+    if (tip) {
+        *p++ = tip;
+        for (int i = 0; i < 5; i++) {
+            if (tip & (1u << i)) *p++ = cur->fingers[i].tip_conf_id;
+        }
+    }
+
+    if (meta) {
+        *p++ = cur->contact_count;
+        *p++ = cur->buttons;
+    }
+
+    for (int i = 0; i < 5; i++) {
+        if (!(moved & (1u << i))) continue;
+        p = put_varint(p, zigzag((int32_t)cur->fingers[i].x - ref->fingers[i].x));
+        p = put_varint(p, zigzag((int32_t)cur->fingers[i].y - ref->fingers[i].y));
+    }
+
+    return p - out;
+}
+
+size_t wl_encode_ptp(wl_encoder_t *enc, const ptp_report_t *report, uint8_t *out) {
+    enc->seq++;
+
+    bool changed = enc->have_ref && state_changed(&enc->ref, report);
+    bool key = !enc->have_ref ||
+               enc->redundant > 0 ||
+               enc->since_key >= WL_PROTO_KEY_INTERVAL - 1 ||
+               (uint16_t)(report->scan_time - enc->ref.scan_time) > WL_PROTO_KEY_IDLE;
+
+    size_t len = 0;
+    if (!key) {
+        len = WL_PROTO_HEADER_LEN + encode_delta(&enc->ref, report, out + WL_PROTO_HEADER_LEN);
+        // A delta that is not smaller than the report is sent as a keyframe
+        key = len >= KEY_LEN;
+    }
+
+    enc->ref = *report;
+    enc->have_ref = true;
+
+    if (key) {
+        len = encode_key(enc, out);
+        enc->since_key = 0;
+        if (enc->redundant > 0) enc->redundant--;
+    } else {
+        put_header(out, WL_PKT_PTP_DELTA, enc->seq);
+        enc->since_key++;
+    }
+
+    if (changed) enc->redundant = WL_PROTO_REDUNDANCY;
+    return len;
+}
+
+size_t wl_encode_repeat(wl_encoder_t *enc, uint8_t *out) {
+    if (!wl_encoder_repeat_pending(enc)) return 0;
+
+    enc->redundant--;
+    enc->since_key = 0;
+    return encode_key(enc, out);
+}
+
+void wl_encoder_resync(wl_encoder_t *enc) {
+    enc->redundant = WL_PROTO_REDUNDANCY;
+}
+
+size_t wl_encode_mouse(wl_encoder_t *enc, const void *report, size_t len, uint8_t *out) {
+    enc->seq++;
+    put_header(out, WL_PKT_MOUSE, enc->seq);
+    memcpy(out + WL_PROTO_HEADER_LEN, report, len);
+    return WL_PROTO_HEADER_LEN + len;
+}
+
+size_t wl_encode_status(wl_pkt_type_t type, const void *payload, size_t len, uint8_t *out) {
+    put_header(out, type, 0);
+    memcpy(out + WL_PROTO_HEADER_LEN, payload, len);
+    return WL_PROTO_HEADER_LEN + len;
+}
+
+size_t wl_batch_add(uint8_t *batch, size_t batch_len, const uint8_t *pkt, size_t len) {
+    if (batch_len == 0) {
+        put_header(batch, WL_PKT_BATCH, 0);
+        batch_len = WL_PROTO_HEADER_LEN;
+    }
+    if (batch_len + 1 + len > WL_PROTO_MAX_BATCH) return 0;
+
+    batch[batch_len] = (uint8_t)len;
+    memcpy(batch + batch_len + 1, pkt, len);
+    return batch_len + 1 + len;
+}
+
+bool wl_batch_next(const uint8_t *batch, size_t len, size_t *pos, const uint8_t **pkt, size_t *pkt_len) {
+    size_t p = *pos ? *pos : WL_PROTO_HEADER_LEN;
+
+    if (p >= len) return false;
+    size_t n = batch[p];
+    if (n < WL_PROTO_HEADER_LEN || n > WL_PROTO_MAX_PACKET || p + 1 + n > len) return false;
+
+    *pkt = batch + p + 1;
+    *pkt_len = n;
+    *pos = p + 1 + n;
+    return true;
+}
+
+int wl_packet_type(wl_decoder_t *dec, const uint8_t *pkt, size_t len) {
+    if (len < WL_PROTO_HEADER_LEN || (pkt[0] >> 4) != WL_PROTO_VERSION) {
+        dec->bad++;
+        return -1;
+    }
+    return pkt[0] & 0x0F;
+}
+
+bool wl_decoder_accept(wl_decoder_t *dec, const uint8_t *pkt) {
+    uint8_t seq = pkt[1];
+
+    if (dec->have_seq) {
+        int8_t diff = (int8_t)(seq - dec->seq);
+
+        // Keyframe repeat of the last frame: rebuilds it only if it never
+        // reached the host
+        if (diff == 0 && (pkt[0] & 0x0F) == WL_PKT_PTP_KEY) {
+            if (!dec->delivered) return true;
+            dec->repeats++;
+            return false;
+        }
+
+        if (diff <= 0) {
+            dec->late++;
+            return false;
+        }
+        if (diff > 1) {
+            dec->lost += diff - 1;
+            dec->have_ref = false;
+        }
+    }
+
+    dec->seq = seq;
+    dec->have_seq = true;
+    dec->delivered = false;
+    return true;
+}
+
+void wl_decoder_resync(wl_decoder_t *dec) {
+    dec->have_seq = false;
+    dec->have_ref = false;
+    dec->delivered = false;
+}
+
+static bool decode_delta(ptp_report_t *ref, const uint8_t *p, const uint8_t *end) {
+    uint32_t v;
+
+    if ((p = get_varint(p, end, &v)) == NULL || p >= end) return false;
+    ref->scan_time += (uint16_t)v;
+
+    uint8_t ctrl = *p++;
+    uint8_t moved = ctrl & DELTA_MOVED_MASK;
+
+    if (ctrl & DELTA_TIP) {
+        if (p >= end) return false;
+        uint8_t tip = *p++;
+        for (int i = 0; i < 5; i++) {
+            if (!(tip & (1u << i))) continue;
+            if (p >= end) return false;
+            ref->fingers[i].tip_conf_id = *p++;
+        }
+    }
+
+    if (ctrl & DELTA_META) {
+        if (end - p < 2) return false;
+        ref->contact_count = *p++;
+        ref->buttons = *p++;
+    }
+
+    for (int i = 0; i < 5; i++) {
+        if (!(moved & (1u << i))) continue;
+        if ((p = get_varint(p, end, &v)) == NULL) return false;
+        ref->fingers[i].x += unzigzag(v);
+        if ((p = get_varint(p, end, &v)) == NULL) return false;
+        ref->fingers[i].y += unzigzag(v);
+    }
+
+    return p == end;
+}
+
+bool wl_decode_ptp(wl_decoder_t *dec, const uint8_t *pkt, size_t len, ptp_report_t *report) {
+    const uint8_t *payload = wl_payload(pkt);
+
+    if ((pkt[0] & 0x0F) == WL_PKT_PTP_KEY) {
+        if (len != KEY_LEN) {
+            dec->bad++;
+            dec->have_ref = false;
+            return false;
+        }
+        memcpy(&dec->ref, payload, sizeof(ptp_report_t));
+        dec->have_ref = true;
+    } else {
+        if (!dec->have_ref) {
+            dec->unreferenced++;
+            return false;
+        }
+        if (!decode_delta(&dec->ref, payload, pkt + len)) {
+            dec->bad++;
+            dec->have_ref = false;
+            return false;
+        }
+    }
+
+    *report = dec->ref;
+    return true;
+}
@@ -0,0 +1,783 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#include "i2c/tp_frame.h"
+#include "i2c/tp_filter.h"
+#include "i2c/tp_tracker.h"
+#include "i2c/tp_assembler.h"
+#include "i2c/hid_decoder.h"
+#include "usb/ptp_report.h"
+#include "wl_proto.h"
+
+#define BENCH_FRAMES 200000
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint64_t now_cycles(void) {
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Deterministic pseudo random noise so runs are comparable.
+static uint32_t rng_state = 0x12345678;
+
+static int noise(int amplitude) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (int)((rng_state >> 16) % (2 * amplitude + 1)) - amplitude;
+}
+
+// Synthetic trace: one finger sweeping, a second finger tapping every
+// 64 frames, with a few coordinate spikes the jump rejection should catch.
+static void synth_frame(uint32_t n, tp_raw_frame_t *raw) {
+    memset(raw, 0, sizeof(*raw));
+
+    uint32_t phase = n % 400;
+    bool down = phase < 380;
+
+    raw->scan_time = (uint16_t)(n * 80);
+    raw->slot_mask = 0x1F;
+    raw->contacts[0].x = 400 + phase * 6 + noise(3);
+    raw->contacts[0].y = 600 + (phase * 3) / 2 + noise(3);
+    if (n % 97 == 0) raw->contacts[0].x += 900;
+    raw->contacts[0].confidence = 1;
+    raw->contacts[0].tip_switch = down;
+    raw->contact_count = 1;
+
+    if ((n / 64) % 2) {
+        raw->contacts[1].x = 2000 + noise(2);
+        raw->contacts[1].y = 1200 + noise(2);
+        raw->contacts[1].confidence = 1;
+        raw->contacts[1].tip_switch = down;
+        raw->contact_count = 2;
+    }
+}
+
+static void bench_filter(void) {
+    static tp_raw_frame_t frames[4096];
+    for (uint32_t i = 0; i < 4096; i++) synth_frame(i, &frames[i]);
+
+    tp_filter_t filter;
+    tp_multi_msg_t out;
+    uint32_t checksum = 0;
+
+    tp_filter_init(&filter);
+
+    uint64_t t0 = now_ns();
+    uint64_t c0 = now_cycles();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+        tp_filter_process(&filter, &frames[i & 4095], frames[i & 4095].scan_time, &out);
+        checksum += out.fingers[0].x + out.fingers[1].y;
+    }
+    uint64_t c1 = now_cycles();
+    uint64_t t1 = now_ns();
+
+    double ns = (double)(t1 - t0) / BENCH_FRAMES;
+    printf("tp_filter: %u frames, %.1f ns/frame, %.0f frames/s",
+           BENCH_FRAMES, ns, 1e9 / ns);
+#ifdef HAVE_TSC
+    printf(", %.0f cycles/frame", (double)(c1 - c0) / BENCH_FRAMES);
+#else
+    (void)c0; (void)c1;
+#endif
+    printf(" (checksum %08x)\n", (unsigned)checksum);
+}
+
+// The same trace as the ELAN controller sends it: one contact per report,
+// the first report of a scan carrying the contact count. Each finger the
+// assembled frame reports down must sit where the full-frame path (Goodix)
+// puts it, since both run the same tp_filter stage.
+static void bench_filter_hybrid(void) {
+    static tp_raw_frame_t frames[4096];
+    for (uint32_t i = 0; i < 4096; i++) synth_frame(i, &frames[i]);
+
+    tp_filter_t full, single;
+    tp_assembler_t as;
+    tp_multi_msg_t ref, out;
+    tp_trace_t trace = {0};
+    uint32_t mismatches = 0, compared = 0;
+
+    tp_filter_init(&full);
+    tp_filter_init(&single);
+    tp_assembler_init(&as);
+
+    for (uint32_t i = 0; i < 4096; i++) {
+        const tp_raw_frame_t *f = &frames[i];
+        tp_filter_process(&full, f, f->scan_time, &ref);
+
+        // Fingers the controller stopped reporting, lifted at their deadline
+        uint8_t ended = tp_filter_expire_tracks(&single, f->scan_time);
+        if (ended) tp_assembler_lift(&as, ended, f->scan_time, f->scan_time, &out);
+
+        bool sent = tp_assembler_begin(&as, f->scan_time, f->scan_time, &trace, &out);
+        uint8_t count = f->contact_count;
+        for (uint8_t s = 0; s < TP_MAX_CONTACTS; s++) {
+            if (f->contacts[s].x == 0) continue;
+
+            tp_raw_frame_t report = {0};
+            report.scan_time = f->scan_time;
+            report.contact_count = count;
+            report.slot_mask = 1u << s;
+            report.contacts[s] = f->contacts[s];
+            count = 0;
+
+            tp_finger_t finger;
+            bool have = tp_filter_single(&single, &report, f->scan_time, &finger);
+            sent = tp_assembler_add(&as, &report, have ? &finger : NULL, &out) || sent;
+        }
+        if (!sent) continue;
+
+        for (int a = 0; a < out.actual_count; a++) {
+            for (int b = 0; b < ref.actual_count; b++) {
+                if (out.fingers[a].contact_id != ref.fingers[b].contact_id || !ref.fingers[b].tip_switch ||
+                    !out.fingers[a].tip_switch) {
+                    continue;
+                }
+                compared++;
+                if (out.fingers[a].x != ref.fingers[b].x || out.fingers[a].y != ref.fingers[b].y) mismatches++;
+            }
+        }
+    }
+
+    if (compared == 0 || mismatches != 0) {
+        printf("tp_filter: hybrid reports differ from full frames (%u of %u contacts)\n",
+               (unsigned)mismatches, (unsigned)compared);
+        exit(1);
+    }
+
+    // Timed per report, as the ELAN task runs it
+    tp_filter_init(&single);
+    uint32_t checksum = 0, reports = 0;
+    tp_finger_t finger;
+    uint64_t t0 = now_ns();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+        const tp_raw_frame_t *f = &frames[i & 4095];
+        tp_raw_frame_t report = *f;
+        report.slot_mask = 1u << (i & 1);
+        if (f->contacts[i & 1].x == 0) continue;
+        if (tp_filter_single(&single, &report, f->scan_time, &finger)) checksum += finger.x;
+        reports++;
+    }
+    uint64_t t1 = now_ns();
+
+    printf("tp_filter hybrid: %u contacts match full frames, %.1f ns/report (checksum %08x)\n",
+           (unsigned)compared, (double)(t1 - t0) / reports, (unsigned)checksum);
+}
+
+// Smoothing comparison against a known finger path: jitter is the RMS
+// error of a finger held still (controller noise +-3 units), lag the mean
+// distance behind a finger sweeping at constant speed.
+#define SMOOTH_FRAMES 240
+#define SMOOTH_SETTLE 40
+
+static const char *const smooth_names[TP_SMOOTH_COUNT] = {"iir", "one-euro", "kalman"};
+
+static double smooth_error(tp_smooth_mode_t mode, int speed, bool signed_lag) {
+    tp_filter_t filter;
+    tp_multi_msg_t out;
+    double sum = 0;
+    int count = 0;
+
+    tp_filter_init(&filter);
+    filter.smoothing = mode;
+
+    for (int n = 0; n < SMOOTH_FRAMES; n++) {
+        tp_raw_frame_t raw = {0};
+        int truth = 800 + n * speed;
+
+        raw.scan_time = (uint16_t)(n * 80);
+        raw.slot_mask = 0x1F;
+        raw.contact_count = 1;
+        raw.contacts[0].x = truth + noise(3);
+        raw.contacts[0].y = 1000 + noise(3);
+        raw.contacts[0].tip_switch = 1;
+        raw.contacts[0].confidence = 1;
+        tp_filter_process(&filter, &raw, raw.scan_time, &out);
+
+        if (n < SMOOTH_SETTLE) continue;
+        double ex = (double)truth - (double)out.fingers[0].x / (1 << TP_SUBPIXEL_BITS);
+        double ey = 1000.0 - (double)out.fingers[0].y / (1 << TP_SUBPIXEL_BITS);
+        sum += signed_lag ? ex : ex * ex + ey * ey;
+        count++;
+    }
+    return signed_lag ? sum / count : sqrt(sum / count);
+}
+
+static void bench_smoothing(void) {
+    static tp_raw_frame_t frames[4096];
+    for (uint32_t i = 0; i < 4096; i++) synth_frame(i, &frames[i]);
+
+    for (int mode = 0; mode < TP_SMOOTH_COUNT; mode++) {
+        double jitter = smooth_error(mode, 0, false);
+        double lag_slow = smooth_error(mode, 1, true);
+        double lag_fast = smooth_error(mode, 8, true);
+
+        tp_filter_t filter;
+        tp_multi_msg_t out;
+        uint32_t checksum = 0;
+
+        tp_filter_init(&filter);
+        filter.smoothing = mode;
+
+        uint64_t t0 = now_ns();
+        uint64_t c0 = now_cycles();
+        for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+            tp_filter_process(&filter, &frames[i & 4095], frames[i & 4095].scan_time, &out);
+            checksum += out.fingers[0].x + out.fingers[1].y;
+        }
+        uint64_t c1 = now_cycles();
+        uint64_t t1 = now_ns();
+
+        printf("smoothing %-8s: jitter %.2f units rms, lag %.1f / %.1f units at 1 / 8 units per frame, %.1f ns/frame",
+               smooth_names[mode], jitter, lag_slow, lag_fast, (double)(t1 - t0) / BENCH_FRAMES);
+#ifdef HAVE_TSC
+        printf(" (%.0f cycles)", (double)(c1 - c0) / BENCH_FRAMES);
+#else
+        (void)c0; (void)c1;
+#endif
+        printf(" (checksum %08x)\n", (unsigned)checksum);
+    }
+}
+
+// Slow glide of 1/32 unit per frame with +-1 unit of noise: the filter's
+// fractional bits follow it, the reported position only as finely as
+// TP_SUBPIXEL_BITS allows. Errors and steps in controller units.
+static void bench_subpixel(void) {
+    tp_filter_t filter;
+    tp_multi_msg_t out;
+    double sum = 0, max_step = 0;
+    int count = 0, prev = -1;
+
+    tp_filter_init(&filter);
+
+    for (int n = 0; n < SMOOTH_FRAMES; n++) {
+        tp_raw_frame_t raw = {0};
+        double truth = 800 + n / 32.0;
+
+        raw.scan_time = (uint16_t)(n * 80);
+        raw.slot_mask = 0x1F;
+        raw.contact_count = 1;
+        raw.contacts[0].x = (uint16_t)(truth + 0.5) + noise(1);
+        raw.contacts[0].y = 1000;
+        raw.contacts[0].tip_switch = 1;
+        raw.contacts[0].confidence = 1;
+        tp_filter_process(&filter, &raw, raw.scan_time, &out);
+
+        if (n < SMOOTH_SETTLE) continue;
+        double ex = truth - (double)out.fingers[0].x / (1 << TP_SUBPIXEL_BITS);
+        if (prev >= 0) {
+            double step = fabs((double)(out.fingers[0].x - prev)) / (1 << TP_SUBPIXEL_BITS);
+            if (step > max_step) max_step = step;
+        }
+        prev = out.fingers[0].x;
+        sum += ex * ex;
+        count++;
+    }
+
+    printf("subpixel: %d bits, slow glide error %.2f units rms, largest step %.3f units\n",
+           TP_SUBPIXEL_BITS, sqrt(sum / count), max_step);
+}
+
+// Synthetic crossing trace: two fingers sweep past each other 30 units
+// apart, and the controller swaps their slots where they cross (it numbers
+// contacts left to right). truth[slot] is the finger in each slot.
+#define CROSS_PERIOD 200
+#define CROSS_DOWN   190
+
+static void synth_crossing(uint32_t n, tp_raw_frame_t *raw, uint8_t *truth) {
+    memset(raw, 0, sizeof(*raw));
+
+    uint32_t phase = n % CROSS_PERIOD;
+    bool down = phase < CROSS_DOWN;
+    uint16_t xa = 500 + phase * 12 + noise(3);
+    uint16_t xb = 500 + CROSS_DOWN * 12 - phase * 12 + noise(3);
+
+    raw->scan_time = (uint16_t)(n * 80);
+    raw->slot_mask = 0x1F;
+    raw->contact_count = down ? 2 : 0;
+
+    bool swapped = xa > xb;
+    truth[0] = swapped ? 1 : 0;
+    truth[1] = swapped ? 0 : 1;
+
+    for (int s = 0; s < 2; s++) {
+        raw->contacts[s].x = truth[s] == 0 ? xa : xb;
+        raw->contacts[s].y = (truth[s] == 0 ? 1000 : 1030) + noise(3);
+        raw->contacts[s].tip_switch = down;
+        raw->contacts[s].confidence = 1;
+    }
+}
+
+// Five fingers wandering independently: the solver's worst case.
+static void synth_five(uint32_t n, tp_raw_frame_t *raw) {
+    memset(raw, 0, sizeof(*raw));
+
+    raw->scan_time = (uint16_t)(n * 80);
+    raw->slot_mask = 0x1F;
+    raw->contact_count = 5;
+    for (int s = 0; s < 5; s++) {
+        uint32_t phase = (n + s * 37) % 256;
+        raw->contacts[s].x = 300 + s * 600 + (phase < 128 ? phase : 256 - phase) * 2 + noise(4);
+        raw->contacts[s].y = 400 + s * 300 + noise(4);
+        raw->contacts[s].tip_switch = 1;
+        raw->contacts[s].confidence = 1;
+    }
+}
+
+static void bench_tracker(void) {
+    static tp_raw_frame_t frames[4096];
+    static uint8_t truth[4096][2];
+    for (uint32_t i = 0; i < 4096; i++) synth_crossing(i, &frames[i], truth[i]);
+
+    // Identity check: a finger must keep its track for the whole touch
+    tp_tracker_t tracker;
+    tp_track_update_t update;
+    uint8_t track_of[2] = {TP_TRACK_NONE, TP_TRACK_NONE};
+    uint32_t switches = 0, crossings = 0;
+
+    tp_tracker_init(&tracker);
+    for (uint32_t i = 0; i < 4096; i++) {
+        uint32_t phase = i % CROSS_PERIOD;
+        if (phase == 0) {
+            track_of[0] = track_of[1] = TP_TRACK_NONE;
+            crossings++;
+        }
+        tp_tracker_update(&tracker, &frames[i], frames[i].scan_time, &update);
+        if (phase >= CROSS_DOWN) continue;
+
+        for (int s = 0; s < 2; s++) {
+            uint8_t f = truth[i][s];
+            if (track_of[f] != TP_TRACK_NONE && track_of[f] != update.track[s]) switches++;
+            track_of[f] = update.track[s];
+        }
+    }
+
+    uint32_t checksum = 0;
+    tp_tracker_init(&tracker);
+    uint64_t t0 = now_ns();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+        tp_tracker_update(&tracker, &frames[i & 4095], frames[i & 4095].scan_time, &update);
+        checksum += update.track[0] + update.started;
+    }
+    uint64_t t1 = now_ns();
+
+    for (uint32_t i = 0; i < 4096; i++) synth_five(i, &frames[i]);
+    tp_tracker_init(&tracker);
+    uint64_t t2 = now_ns();
+    uint64_t c0 = now_cycles();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+        tp_tracker_update(&tracker, &frames[i & 4095], frames[i & 4095].scan_time, &update);
+        checksum += update.track[4];
+    }
+    uint64_t c1 = now_cycles();
+    uint64_t t3 = now_ns();
+
+    printf("tp_tracker: %u id switches in %u crossings, 2 contacts %.1f ns/frame, 5 contacts %.1f ns/frame",
+           (unsigned)switches, (unsigned)crossings,
+           (double)(t1 - t0) / BENCH_FRAMES, (double)(t3 - t2) / BENCH_FRAMES);
+#ifdef HAVE_TSC
+    printf(" (%.0f cycles)", (double)(c1 - c0) / BENCH_FRAMES);
+#else
+    (void)c0; (void)c1;
+#endif
+    printf(" (checksum %08x)\n", (unsigned)checksum);
+}
+
+// A frame is only its contacts, packed: the report's count must match them
+// and every finger past it must be padding with tip and confidence clear.
+static bool check_packed(const tp_multi_msg_t *msg) {
+    ptp_report_t report;
+    ptp_report_build(msg, &report);
+
+    if (report.contact_count != msg->actual_count) return false;
+    for (int i = 0; i < TP_MAX_CONTACTS; i++) {
+        const finger_t *f = &report.fingers[i];
+        if (i < msg->actual_count && f->tip_conf_id >> 2 != msg->fingers[i].contact_id) return false;
+        if (i >= msg->actual_count && (f->tip_conf_id != 0 || f->x != 0 || f->y != 0)) return false;
+    }
+    return true;
+}
+
+// Two fingers down, then the one in the lower slot lifts while the other
+// stays: the remaining finger must be sent alone, under its own track,
+// with no phantom contact where the lifted one was.
+static void check_lift_low(void) {
+    tp_filter_t filter;
+    tp_multi_msg_t out;
+    uint8_t stay_id = TP_TRACK_NONE;
+
+    tp_filter_init(&filter);
+    for (uint32_t n = 0; n < 40; n++) {
+        tp_raw_frame_t raw = {0};
+        raw.scan_time = (uint16_t)(n * 80);
+        raw.slot_mask = 0x1F;
+        raw.contact_count = n <= 20 ? 2 : 1;
+        if (n <= 20) {
+            raw.contacts[0].x = 500 + n;
+            raw.contacts[0].y = 600;
+            raw.contacts[0].confidence = 1;
+            raw.contacts[0].tip_switch = n < 20;
+        }
+        raw.contacts[1].x = 2000 + n;
+        raw.contacts[1].y = 1200;
+        raw.contacts[1].confidence = 1;
+        raw.contacts[1].tip_switch = 1;
+
+        tp_filter_process(&filter, &raw, raw.scan_time, &out);
+        if (!check_packed(&out)) {
+            printf("tp_filter: frame %u not packed after a lower finger lifted\n", (unsigned)n);
+            exit(1);
+        }
+        for (int i = 0; i < out.actual_count; i++) {
+            if (out.fingers[i].x >= TP_OUTPUT_MAX(1000) && n < 20) stay_id = out.fingers[i].contact_id;
+        }
+        if (n > 20 && (out.actual_count != 1 || out.fingers[0].contact_id != stay_id ||
+                       !out.fingers[0].tip_switch)) {
+            printf("tp_filter: frame %u sent %u contacts after a lower finger lifted\n",
+                   (unsigned)n, out.actual_count);
+            exit(1);
+        }
+    }
+
+    // The same through the assembler, one contact per report (ELAN)
+    tp_assembler_t as;
+    tp_raw_frame_t meta = {0};
+    tp_trace_t trace = {0};
+    tp_finger_t low = {.x = 500, .y = 600, .tip_switch = 1, .confidence = 1, .contact_id = 0};
+    tp_finger_t high = {.x = 2000, .y = 1200, .tip_switch = 1, .confidence = 1, .contact_id = 1};
+
+    tp_assembler_init(&as);
+    for (uint16_t scan = 1; scan <= 4; scan++) {
+        if (scan == 3) low.tip_switch = 0;
+        bool sent = false;
+        tp_assembler_begin(&as, scan, scan, &trace, &out);
+        // The first report of a scan announces its contacts
+        meta.contact_count = scan <= 3 ? 2 : 1;
+        if (scan <= 3) {
+            sent = tp_assembler_add(&as, &meta, &low, &out);
+            meta.contact_count = 0;
+        }
+        sent |= tp_assembler_add(&as, &meta, &high, &out);
+
+        if (!sent || !check_packed(&out) || out.actual_count != (scan <= 3 ? 2 : 1) ||
+            out.fingers[out.actual_count - 1].contact_id != 1) {
+            printf("tp_assembler: scan %u not packed after a lower finger lifted\n", scan);
+            exit(1);
+        }
+    }
+}
+
+// Report descriptor shaped like the Goodix GT7863 touch pad input report:
+// five finger collections (confidence, tip, 6-bit ID, 16-bit X/Y), then
+// scan time, contact count and one button bit.
+#define BENCH_FINGER                                                    \
+    0x09, 0x22, 0xA1, 0x02,                                             \
+    0x05, 0x0D, 0x09, 0x47, 0x09, 0x42, 0x15, 0x00, 0x25, 0x01,         \
+    0x75, 0x01, 0x95, 0x02, 0x81, 0x02,                                 \
+    0x09, 0x51, 0x25, 0x3F, 0x75, 0x06, 0x95, 0x01, 0x81, 0x02,         \
+    0x05, 0x01, 0x09, 0x30, 0x26, 0x7F, 0x0D, 0x75, 0x10, 0x95, 0x01,   \
+    0x81, 0x02, 0x09, 0x31, 0x26, 0x6F, 0x08, 0x81, 0x02,               \
+    0xC0
+
+static const uint8_t bench_report_desc[] = {
+    0x05, 0x0D, 0x09, 0x05, 0xA1, 0x01, 0x85, 0x04,
+    BENCH_FINGER, BENCH_FINGER, BENCH_FINGER, BENCH_FINGER, BENCH_FINGER,
+    0x05, 0x0D, 0x55, 0x0C, 0x66, 0x01, 0x10, 0x47, 0xFF, 0xFF, 0x00, 0x00,
+    0x27, 0xFF, 0xFF, 0x00, 0x00, 0x75, 0x10, 0x95, 0x01, 0x09, 0x56, 0x81, 0x02,
+    0x09, 0x54, 0x25, 0x7F, 0x95, 0x01, 0x75, 0x08, 0x81, 0x02,
+    0x05, 0x09, 0x09, 0x01, 0x25, 0x01, 0x75, 0x01, 0x95, 0x01, 0x81, 0x02,
+    0x95, 0x07, 0x81, 0x03,
+    0xC0,
+};
+
+// The hand-written decode the goodix driver used before the layout table.
+__attribute__((noinline)) static void legacy_decode(const uint8_t *data, tp_raw_frame_t *raw) {
+    memset(raw, 0, sizeof(*raw));
+    raw->scan_time = data[28] | (data[29] << 8);
+    raw->button_mask = (data[31] & 0x01) ? 0x01 : 0x00;
+    raw->contact_count = data[30];
+    for (int id = 0; id < TP_MAX_CONTACTS; id++) {
+        const uint8_t *f_ptr = &data[3 + (id * 5)];
+        raw->contacts[id].confidence = (f_ptr[0] & 0x01);
+        raw->contacts[id].tip_switch = (f_ptr[0] & 0x02) ? 1 : 0;
+        raw->contacts[id].x = f_ptr[1] | (f_ptr[2] << 8);
+        raw->contacts[id].y = f_ptr[3] | (f_ptr[4] << 8);
+        raw->slot_mask |= 1u << id;
+    }
+}
+
+// Built-in table for the same report, as a driver would declare it.
+#define BENCH_LAYOUT_FINGER(i) {                            \
+    .tip        = HID_FIELD(8 * (1 + 5 * (i)) + 1, 1),      \
+    .confidence = HID_FIELD(8 * (1 + 5 * (i)), 1),          \
+    .contact_id = HID_FIELD(8 * (1 + 5 * (i)) + 2, 6),      \
+    .x          = HID_FIELD(8 * (2 + 5 * (i)), 16),         \
+    .y          = HID_FIELD(8 * (4 + 5 * (i)), 16),         \
+}
+
+static const hid_tp_layout_t bench_const_layout = {
+    .report_id = 0x04,
+    .finger_count = 5,
+    .report_len = 30,
+    .logical_max_x = 0x0D7F,
+    .logical_max_y = 0x086F,
+    .finger_stride = 5,
+    .fingers = { BENCH_LAYOUT_FINGER(0), BENCH_LAYOUT_FINGER(1), BENCH_LAYOUT_FINGER(2),
+                 BENCH_LAYOUT_FINGER(3), BENCH_LAYOUT_FINGER(4) },
+    .scan_time = HID_FIELD(8 * 26, 16),
+    .contact_count = HID_FIELD(8 * 28, 8),
+    .button = HID_FIELD(8 * 29, 1),
+};
+
+__attribute__((noinline)) static bool const_decode(const uint8_t *report, size_t len, tp_raw_frame_t *raw) {
+    return hid_decoder_decode_inline(&bench_const_layout, report, len, raw);
+}
+
+static void bench_decoder(void) {
+    hid_tp_layout_t layout;
+    if (!hid_decoder_parse(bench_report_desc, sizeof(bench_report_desc), &layout)) {
+        printf("hid_decoder: descriptor parse failed\n");
+        exit(1);
+    }
+
+    if (memcmp(&layout, &bench_const_layout, sizeof(layout)) != 0) {
+        printf("hid_decoder: parsed layout differs from the built-in table\n");
+        exit(1);
+    }
+
+    static uint8_t buffers[256][64];
+    for (int i = 0; i < 256; i++) {
+        for (int b = 0; b < 64; b++) buffers[i][b] = (uint8_t)noise(127);
+        buffers[i][2] = layout.report_id;
+    }
+
+    hid_decoder_plan_t plan;
+    hid_decoder_plan(&layout, &plan);
+    if (!plan.fixed) {
+        printf("hid_decoder: parsed layout not compiled to a fixed-shape plan\n");
+        exit(1);
+    }
+
+    // A layout the plan cannot take decodes through the generic fields
+    hid_tp_layout_t odd = layout;
+    odd.fingers[0].x.shift = 1;
+    hid_decoder_compile(&odd);
+    hid_decoder_plan_t odd_plan;
+    hid_decoder_plan(&odd, &odd_plan);
+
+    // All decoders must agree before timing them.
+    for (int i = 0; i < 256; i++) {
+        tp_raw_frame_t a, b, c;
+        legacy_decode(buffers[i], &a);
+        if (!hid_decoder_decode(&plan, &buffers[i][2], layout.report_len, &b) || memcmp(&a, &b, sizeof(a)) != 0) {
+            printf("hid_decoder: mismatch against legacy decode on buffer %d\n", i);
+            exit(1);
+        }
+        if (odd_plan.fixed || !hid_decoder_decode(&odd_plan, &buffers[i][2], layout.report_len, &c) ||
+            c.contacts[0].x != (uint16_t)hid_field_get(&odd.fingers[0].x, &buffers[i][2]) ||
+            memcmp(&a.contacts[1], &c.contacts[1], sizeof(a.contacts[1])) != 0) {
+            printf("hid_decoder: generic fallback wrong on buffer %d\n", i);
+            exit(1);
+        }
+        // A report cut short by the controller is not a touch frame
+        if (hid_decoder_decode(&plan, &buffers[i][2], layout.report_len - 1, &b) ||
+            hid_decoder_decode(&odd_plan, &buffers[i][2], layout.report_len - 1, &c)) {
+            printf("hid_decoder: short report accepted on buffer %d\n", i);
+            exit(1);
+        }
+    }
+
+    tp_raw_frame_t raw;
+    uint32_t checksum = 0;
+
+    uint64_t t0 = now_ns();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+        legacy_decode(buffers[i & 255], &raw);
+        checksum += raw.contacts[i % TP_MAX_CONTACTS].x;
+    }
+    uint64_t t1 = now_ns();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+        const_decode(&buffers[i & 255][2], layout.report_len, &raw);
+        checksum += raw.contacts[i % TP_MAX_CONTACTS].x;
+    }
+    uint64_t t2 = now_ns();
+
+    // The parsed plan is only checked above, not timed: it exists for
+    // descriptors without a built-in table, not for speed
+    printf("hid_decoder: report 0x%02X, %u fingers, %u bytes; legacy %.1f ns/frame, "
+           "built-in table %.1f ns/frame (checksum %08x)\n",
+           layout.report_id, layout.finger_count, layout.report_len,
+           (double)(t1 - t0) / BENCH_FRAMES, (double)(t2 - t1) / BENCH_FRAMES, (unsigned)checksum);
+}
+
+// Filtered synthetic trace through the ESP-NOW codec: every frame must
+// come back byte-identical, with and without packet loss.
+static void bench_wl_proto(void) {
+    static ptp_report_t reports[4096];
+    tp_filter_t filter;
+    tp_raw_frame_t raw;
+    tp_multi_msg_t msg;
+
+    tp_filter_init(&filter);
+    for (uint32_t i = 0; i < 4096; i++) {
+        synth_frame(i, &raw);
+        tp_filter_process(&filter, &raw, raw.scan_time, &msg);
+        ptp_report_build(&msg, &reports[i]);
+    }
+
+    wl_encoder_t enc;
+    wl_decoder_t dec;
+    uint8_t pkt[WL_PROTO_MAX_PACKET];
+    uint64_t bytes = 0;
+    uint32_t keys = 0, rebuilt = 0;
+
+    wl_encoder_init(&enc);
+    wl_decoder_init(&dec);
+    for (uint32_t i = 0; i < 4096; i++) {
+        size_t len = wl_encode_ptp(&enc, &reports[i], pkt);
+        bytes += len;
+        if (wl_packet_type(&dec, pkt, len) == WL_PKT_PTP_KEY) keys++;
+
+        // Drop every 50th packet: frames must stay exact or be withheld
+        if (i % 50 == 49) continue;
+
+        ptp_report_t out;
+        if (wl_decoder_accept(&dec, pkt) && wl_decode_ptp(&dec, pkt, len, &out)) {
+            if (memcmp(&out, &reports[i], sizeof(out)) != 0) {
+                printf("wl_proto: frame %u decoded wrong\n", i);
+                exit(1);
+            }
+            wl_decoder_delivered(&dec);
+            rebuilt++;
+        }
+    }
+
+    // Same trace in batches of 4 frames, no loss
+    static uint8_t batch[WL_PROTO_MAX_BATCH];
+    size_t batch_len = 0;
+    uint64_t batch_bytes = 0;
+    uint32_t batch_at = 0;
+
+    wl_decoder_t batch_dec;
+    wl_encoder_init(&enc);
+    wl_decoder_init(&batch_dec);
+    for (uint32_t i = 0; i < 4096; i++) {
+        size_t len = wl_encode_ptp(&enc, &reports[i], pkt);
+        batch_len = wl_batch_add(batch, batch_len, pkt, len);
+        if (i % 4 != 3) continue;
+
+        const uint8_t *sub;
+        size_t sub_len, pos = 0;
+        while (wl_batch_next(batch, batch_len, &pos, &sub, &sub_len)) {
+            ptp_report_t out;
+            if (!wl_decoder_accept(&batch_dec, sub) || !wl_decode_ptp(&batch_dec, sub, sub_len, &out) ||
+                memcmp(&out, &reports[batch_at], sizeof(out)) != 0) {
+                printf("wl_proto: batched frame %u decoded wrong\n", batch_at);
+                exit(1);
+            }
+            wl_decoder_delivered(&batch_dec);
+            batch_at++;
+        }
+        batch_bytes += batch_len;
+        batch_len = 0;
+    }
+
+    uint64_t t0 = now_ns();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+        wl_encode_ptp(&enc, &reports[i & 4095], pkt);
+    }
+    uint64_t t1 = now_ns();
+
+    printf("wl_proto: %.1f bytes/frame (legacy %u), %u keyframes, %u/4096 rebuilt with 2%% loss "
+           "(%u lost, %u unreferenced), encode %.1f ns/frame\n",
+           (double)bytes / 4096, (unsigned)(sizeof(uint32_t) + sizeof(ptp_report_t)), keys, rebuilt,
+           (unsigned)dec.lost, (unsigned)dec.unreferenced, (double)(t1 - t0) / BENCH_FRAMES);
+    printf("wl_proto: batches of 4, %.1f bytes/packet\n", (double)batch_bytes / 1024);
+}
+
+// Sends the owed keyframe repeats of the last encoded frame; returns how
+// many frames the host would see, each checked against expect.
+static uint32_t deliver_repeats(wl_encoder_t *enc, wl_decoder_t *dec, const ptp_report_t *expect) {
+    uint8_t pkt[WL_PROTO_MAX_PACKET];
+    uint32_t frames = 0;
+    size_t len;
+
+    while ((len = wl_encode_repeat(enc, pkt)) != 0) {
+        ptp_report_t out;
+        if (!wl_decoder_accept(dec, pkt) || !wl_decode_ptp(dec, pkt, len, &out)) continue;
+        if (memcmp(&out, expect, sizeof(out)) != 0) {
+            printf("wl_proto: keyframe repeat decoded wrong\n");
+            exit(1);
+        }
+        wl_decoder_delivered(dec);
+        frames++;
+    }
+    return frames;
+}
+
+// Keyframe repeats must reach the host only in place of an original that
+// never did: delivered, lost, or decoded while the output pool was full.
+static void check_wl_repeat(void) {
+    static const char *const cases[] = {"delivered", "lost", "not delivered"};
+    tp_filter_t filter;
+    tp_raw_frame_t raw;
+    tp_multi_msg_t msg;
+    ptp_report_t report;
+    wl_encoder_t enc;
+    wl_decoder_t dec;
+    uint8_t pkt[WL_PROTO_MAX_PACKET];
+
+    tp_filter_init(&filter);
+    wl_encoder_init(&enc);
+    wl_decoder_init(&dec);
+    for (uint32_t i = 0; i < 3; i++) {
+        synth_frame(i, &raw);
+        tp_filter_process(&filter, &raw, raw.scan_time, &msg);
+        ptp_report_build(&msg, &report);
+
+        size_t len = wl_encode_ptp(&enc, &report, pkt);
+        wl_encoder_resync(&enc);
+
+        uint32_t frames = 0;
+        ptp_report_t out;
+        if (i != 1 && wl_decoder_accept(&dec, pkt) && wl_decode_ptp(&dec, pkt, len, &out) && i == 0) {
+            wl_decoder_delivered(&dec);
+            frames++;
+        }
+        frames += deliver_repeats(&enc, &dec, &report);
+
+        if (frames != 1) {
+            printf("wl_proto: original %s, %u frames reached the host\n", cases[i], frames);
+            exit(1);
+        }
+    }
+    printf("wl_proto: keyframe repeats ok, %u dropped\n", (unsigned)dec.repeats);
+}
+
+int main(void) {
+    check_lift_low();
+    bench_filter();
+    bench_filter_hybrid();
+    bench_decoder();
+    bench_wl_proto();
+    check_wl_repeat();
+    bench_tracker();
+    bench_smoothing();
+    bench_subpixel();
+    return 0;
+}
@@ -0,0 +1,53 @@
+"""Print the boot timeline of the touch pad.
+
+    python tp_boot.py
+
+Times are from esp_timer start, so the ROM and second stage bootloader
+(a few tens of ms, see sdkconfig.defaults) come on top. The touch pad is
+usable on USB once both 'touch ready' and 'USB mounted' are reached.
+"""
+import argparse
+import struct
+import sys
+
+from tp_hid import FEATURE_PAGE_BOOT, open_generic_interface, read_feature_page
+
+REPORT_VERSION = 1
+
+# tp_boot.h order
+STEPS = ['app_main', 'USB started', 'touch reset', 'touch ready', 'USB mounted', 'radio ready']
+
+
+def parse(data):
+    page, version, count = struct.unpack_from('<BBB', data, 0)
+    if page != FEATURE_PAGE_BOOT or version != REPORT_VERSION:
+        raise ValueError(f'unexpected page {page:#x} version {version}')
+    return struct.unpack_from(f'<{count}I', data, 4)
+
+
+def show(times):
+    for i, us in enumerate(times):
+        name = STEPS[i] if i < len(STEPS) else f'#{i}'
+        print(f'{name:16} {us / 1000:8.1f} ms' if us else f'{name:16} {"-":>8}')
+
+    touch, mounted = times[STEPS.index('touch ready')], times[STEPS.index('USB mounted')]
+    if touch and mounted:
+        print(f'{"usable on USB":16} {max(touch, mounted) / 1000:8.1f} ms')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.parse_args()
+
+    dev = open_generic_interface()
+    if dev is None:
+        sys.exit('Touch pad not found')
+
+    try:
+        show(parse(read_feature_page(dev, FEATURE_PAGE_BOOT)))
+    finally:
+        dev.close()
+
+
+if __name__ == '__main__':
+    main()
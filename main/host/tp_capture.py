@@ -0,0 +1,69 @@
+"""Record a raw I2C touch capture from the touch pad.
+
+Over USB (generic HID interface 0, needs CONFIG_TP_CAPTURE):
+    python tp_capture.py out.tpcap [--seconds 10]
+Over UART (CONFIG_TP_CAPTURE_TRANSPORT_UART):
+    python tp_capture.py out.tpcap --serial /dev/ttyUSB0 [--baud 2000000]
+
+Replay the result with tp_replay (see CMakeLists.txt in this directory).
+"""
+import argparse
+import sys
+import time
+
+from tp_hid import CMD_CAPTURE_START, CMD_CAPTURE_STOP, REPORT_SIZE, open_generic_interface, send_command
+
+
+def capture_hid(dev, out, seconds):
+    deadline = time.monotonic() + seconds if seconds else None
+    while deadline is None or time.monotonic() < deadline:
+        report = dev.read(REPORT_SIZE, 100)
+        if not report:
+            continue
+        n = report[0]
+        out.write(bytes(report[1:1 + n]))
+
+
+def capture_serial(port, baud, out, seconds):
+    import serial
+
+    deadline = time.monotonic() + seconds if seconds else None
+    with serial.Serial(port, baud, timeout=0.1) as ser:
+        while deadline is None or time.monotonic() < deadline:
+            data = ser.read(4096)
+            out.write(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('output')
+    parser.add_argument('--seconds', type=float, default=0, help='stop after this long (default: Ctrl-C)')
+    parser.add_argument('--serial', help='read the stream from this serial port instead of USB')
+    parser.add_argument('--baud', type=int, default=2000000)
+    args = parser.parse_args()
+
+    dev = open_generic_interface()
+    if dev is None and not args.serial:
+        sys.exit('Touch pad not found')
+
+    with open(args.output, 'wb') as out:
+        if dev is not None:
+            send_command(dev, CMD_CAPTURE_START)
+        try:
+            if args.serial:
+                capture_serial(args.serial, args.baud, out, args.seconds)
+            else:
+                capture_hid(dev, out, args.seconds)
+        except KeyboardInterrupt:
+            pass
+        finally:
+            if dev is not None:
+                send_command(dev, CMD_CAPTURE_STOP)
+                dev.close()
+        total = out.tell()
+
+    print(f'{args.output}: {total} bytes')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,68 @@
+"""Print the firmware event counters and their rates.
+
+    python tp_counters.py              print totals once
+    python tp_counters.py --watch 1    print totals and per-second rates every second
+
+Rates come from the difference between two reads, so the first read of
+--watch shows totals only. Counters wrap at 2^32.
+"""
+import argparse
+import struct
+import sys
+import time
+
+from tp_hid import FEATURE_PAGE_COUNTERS, open_generic_interface, read_feature_page
+
+REPORT_VERSION = 1
+
+# tp_counters.h order
+COUNTERS = ['frames', 'i2c_errors', 'i2c_empty', 'burst_limit', 'reader_dropped', 'pipe_dropped',
+            'pipe_coalesced', 'hid_busy', 'hid_rejected', 'espnow_send_failed', 'espnow_no_ack']
+
+
+def parse(data):
+    page, version, count, _, uptime_ms = struct.unpack_from('<BBBBI', data, 0)
+    if page != FEATURE_PAGE_COUNTERS or version != REPORT_VERSION:
+        raise ValueError(f'unexpected page {page:#x} version {version}')
+    return uptime_ms, struct.unpack_from(f'<{count}I', data, 8)
+
+
+def show(uptime_ms, values, previous=None):
+    print(f'uptime {uptime_ms / 1000:.1f} s')
+    dt = (uptime_ms - previous[0]) / 1000 if previous else 0
+    print(f'{"counter":20} {"total":>10} {"per s":>10}')
+    for i, value in enumerate(values):
+        name = COUNTERS[i] if i < len(COUNTERS) else f'#{i}'
+        rate = ''
+        if dt > 0:
+            rate = f'{((value - previous[1][i]) & 0xFFFFFFFF) / dt:10.1f}'
+        print(f'{name:20} {value:10} {rate:>10}')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--watch', type=float, default=0, help='refresh interval in seconds')
+    args = parser.parse_args()
+
+    dev = open_generic_interface()
+    if dev is None:
+        sys.exit('Touch pad not found')
+
+    try:
+        previous = None
+        while True:
+            current = parse(read_feature_page(dev, FEATURE_PAGE_COUNTERS))
+            show(*current, previous)
+            if not args.watch:
+                break
+            previous = current
+            time.sleep(args.watch)
+            print()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        dev.close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,59 @@
+"""Access to the touch pad's generic HID interface (instance 0)."""
+import hid
+
+TARGET_DEVICES = [
+    (0x0D00, 0x072A),
+    (0x0D00, 0x072B),
+    (0x0D00, 0x072C),
+    (0x0D00, 0x072D),
+]
+
+REPORT_SIZE = 64
+
+CMD_CAPTURE_START = 0xC0
+CMD_CAPTURE_STOP = 0xC1
+CMD_STRESS_START = 0xC2
+CMD_STRESS_STOP = 0xC3
+
+FEATURE_PAGE_LATENCY = 0x01
+FEATURE_PAGE_FILTER = 0x02
+FEATURE_PAGE_SCHED = 0x03
+FEATURE_PAGE_COUNTERS = 0x04
+FEATURE_PAGE_LOG = 0x05
+FEATURE_PAGE_BOOT = 0x06
+FEATURE_PAGE_MODE = 0x07
+FEATURE_FLAG_RESET = 0x01
+FEATURE_FLAG_WRITE = 0x02
+
+
+def open_generic_interface():
+    for vid, pid in TARGET_DEVICES:
+        for d in hid.enumerate(vid, pid):
+            if d['interface_number'] == 0:
+                dev = hid.device()
+                dev.open_path(d['path'])
+                return dev
+    return None
+
+
+def send_command(dev, command):
+    # Leading 0x00: the generic interface has no report IDs
+    dev.write([0x00, command] + [0x00] * (REPORT_SIZE - 1))
+
+
+def read_feature_page(dev, page, reset=False):
+    """Select a diagnostics page and read it back (64 bytes, page id first)."""
+    flags = FEATURE_FLAG_RESET if reset else 0
+    dev.send_feature_report([0x00, page, flags] + [0x00] * (REPORT_SIZE - 2))
+    data = dev.get_feature_report(0x00, REPORT_SIZE + 1)
+    # Some backends return the (zero) report ID in front
+    if len(data) == REPORT_SIZE + 1:
+        data = data[1:]
+    return bytes(data)
+
+
+def write_feature_page(dev, page, settings):
+    """Write a settings page (bytes from offset 2) and read it back."""
+    payload = [page, FEATURE_FLAG_WRITE] + list(settings)
+    dev.send_feature_report([0x00] + payload + [0x00] * (REPORT_SIZE - len(payload)))
+    return read_feature_page(dev, page)
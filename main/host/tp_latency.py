@@ -0,0 +1,76 @@
+"""Print the touch-to-USB latency trace (needs CONFIG_TP_LATENCY_TRACE).
+
+    python tp_latency.py              print once
+    python tp_latency.py --reset      clear the statistics first
+    python tp_latency.py --watch 1    refresh every second
+"""
+import argparse
+import struct
+import sys
+import time
+
+from tp_hid import FEATURE_PAGE_LATENCY, open_generic_interface, read_feature_page
+
+REPORT_VERSION = 1
+
+STAGES = [
+    'INT edge -> I2C read',
+    'I2C read -> filter',
+    'filter -> dequeue',
+    'dequeue -> submit',
+    'total',
+]
+
+HIST_LABELS = ['<250us', '<500us', '<1ms', '<2ms', '<4ms', '<8ms', '<16ms', '>=16ms']
+
+
+def parse(data):
+    page, version, stage_count, _, frames = struct.unpack_from('<BBBBI', data, 0)
+    if page != FEATURE_PAGE_LATENCY or version != REPORT_VERSION:
+        raise ValueError(f'unexpected page {page:#x} version {version}')
+    stages = [struct.unpack_from('<4H', data, 8 + s * 8) for s in range(stage_count)]
+    hist = struct.unpack_from(f'<{len(HIST_LABELS)}H', data, 48)
+    return frames, stages, hist
+
+
+def show(frames, stages, hist):
+    print(f'{frames} frames')
+    print(f'{"stage (us)":24} {"min":>7} {"avg":>7} {"p99":>7} {"max":>7}')
+    for name, (lo, avg, p99, hi) in zip(STAGES, stages):
+        print(f'{name:24} {lo:7} {avg:7} {p99:7} {hi:7}')
+
+    total = sum(hist)
+    if total:
+        print(f'total latency, last {total} frames')
+        for label, count in zip(HIST_LABELS, hist):
+            bar = '#' * round(40 * count / total)
+            print(f'  {label:>7} {count:5} {bar}')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--reset', action='store_true', help='clear the statistics before reading')
+    parser.add_argument('--watch', type=float, default=0, help='refresh interval in seconds')
+    args = parser.parse_args()
+
+    dev = open_generic_interface()
+    if dev is None:
+        sys.exit('Touch pad not found')
+
+    try:
+        if args.reset:
+            read_feature_page(dev, FEATURE_PAGE_LATENCY, reset=True)
+        while True:
+            show(*parse(read_feature_page(dev, FEATURE_PAGE_LATENCY)))
+            if not args.watch:
+                break
+            time.sleep(args.watch)
+            print()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        dev.close()
+
+
+if __name__ == '__main__':
+    main()
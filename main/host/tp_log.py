@@ -0,0 +1,164 @@
+"""Decode the firmware's deferred binary log (CONFIG_TP_LOG).
+
+The firmware stores only format string addresses and raw arguments; the
+strings are read back from the application ELF of the same build.
+
+Console transport (default), other console output is passed through:
+    python tp_log.py build/touchpad.elf --serial /dev/ttyUSB0 [--baud 115200]
+    idf.py monitor | python tp_log.py build/touchpad.elf
+USB transport (CONFIG_TP_LOG_TRANSPORT_HID):
+    python tp_log.py build/touchpad.elf --hid
+"""
+import argparse
+import re
+import struct
+import sys
+import time
+
+REPORT_VERSION = 1
+RECORD = struct.Struct('<7I')       # tp_log_record_t
+LINE_PREFIX = '#TPL '
+
+CONVERSION = re.compile(r'%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z|j|t)?([diouxXcsp%])')
+
+
+class Strings:
+    """Reads NUL-terminated strings out of the ELF's loaded sections."""
+
+    SHT_PROGBITS = 1
+    SHF_ALLOC = 0x2
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            elf = f.read()
+        if elf[:4] != b'\x7fELF':
+            raise ValueError(f'{path}: not an ELF file')
+        wide = elf[4] == 2
+        order = '<' if elf[5] == 1 else '>'
+        if wide:
+            shoff, = struct.unpack_from(order + 'Q', elf, 0x28)
+            shentsize, shnum = struct.unpack_from(order + 'HH', elf, 0x3A)
+            header = struct.Struct(order + 'IIQQQQ')
+        else:
+            shoff, = struct.unpack_from(order + 'I', elf, 0x20)
+            shentsize, shnum = struct.unpack_from(order + 'HH', elf, 0x2E)
+            header = struct.Struct(order + 'IIIIII')
+
+        self.sections = []
+        for i in range(shnum):
+            _, sh_type, flags, addr, offset, size = header.unpack_from(elf, shoff + i * shentsize)
+            if sh_type == self.SHT_PROGBITS and flags & self.SHF_ALLOC and size:
+                self.sections.append((addr, elf[offset:offset + size]))
+
+    def get(self, addr):
+        for base, data in self.sections:
+            if base <= addr < base + len(data):
+                end = data.find(b'\0', addr - base)
+                return data[addr - base:end if end >= 0 else len(data)].decode(errors='replace')
+        return None
+
+
+def format_message(strings, fmt, args):
+    args = list(args)
+
+    def convert(m):
+        flags, kind = m.groups()
+        if kind == '%':
+            return '%'
+        value = args.pop(0) if args else 0
+        if kind in 'di':
+            return ('%' + flags + 'd') % (value - (1 << 32) if value & 0x80000000 else value)
+        if kind == 'u':
+            return ('%' + flags + 'd') % value
+        if kind == 'c':
+            return chr(value & 0xFF)
+        if kind == 's':
+            s = strings.get(value)
+            return ('%' + flags + 's') % (s if s is not None else f'<{value:#010x}>')
+        if kind == 'p':
+            return f'{value:#010x}'
+        return ('%' + flags + kind) % value
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def decode(strings, record):
+    timestamp_us, fmt_addr, tag_addr, *args = RECORD.unpack(record)
+    fmt = strings.get(fmt_addr)
+    tag = strings.get(tag_addr) or f'{tag_addr:#010x}'
+    if not fmt:
+        return f'? ({timestamp_us // 1000}) {tag}: unknown format {fmt_addr:#010x} (ELF from another build?)'
+    return f'{fmt[0]} ({timestamp_us // 1000}) {tag}: {format_message(strings, fmt[1:], args)}'
+
+
+def decode_line(strings, line):
+    if not line.startswith(LINE_PREFIX):
+        return line
+    payload = line[len(LINE_PREFIX):].strip()
+    if payload.startswith('!'):
+        return f'W TP_LOG: {payload[1:].strip()} records dropped'
+    try:
+        return decode(strings, bytes.fromhex(payload))
+    except (ValueError, struct.error):
+        return line
+
+
+def read_lines(source):
+    for raw in source:
+        if isinstance(raw, bytes):
+            raw = raw.decode(errors='replace')
+        yield raw.rstrip('\r\n')
+
+
+def run_hid(strings, interval):
+    from tp_hid import FEATURE_PAGE_LOG, open_generic_interface, read_feature_page
+
+    dev = open_generic_interface()
+    if dev is None:
+        sys.exit('Touch pad not found')
+    try:
+        while True:
+            data = read_feature_page(dev, FEATURE_PAGE_LOG)
+            page, version, count, dropped = data[0], data[1], data[2], data[3]
+            if page != FEATURE_PAGE_LOG or version != REPORT_VERSION:
+                raise ValueError(f'unexpected page {page:#x} version {version}')
+            if dropped:
+                print(f'W TP_LOG: {dropped} records dropped')
+            for i in range(count):
+                print(decode(strings, data[8 + i * RECORD.size:8 + (i + 1) * RECORD.size]))
+            # Keep reading while the ring has more
+            if count == 0:
+                time.sleep(interval)
+    finally:
+        dev.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('elf', help='application ELF of the running firmware')
+    parser.add_argument('--serial', help='read the console from this serial port instead of stdin')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--hid', action='store_true', help='poll the log over the generic HID interface')
+    parser.add_argument('--interval', type=float, default=0.05, help='HID poll interval when the log is empty')
+    args = parser.parse_args()
+
+    strings = Strings(args.elf)
+
+    try:
+        if args.hid:
+            run_hid(strings, args.interval)
+        elif args.serial:
+            import serial
+
+            with serial.Serial(args.serial, args.baud) as ser:
+                for line in read_lines(ser):
+                    print(decode_line(strings, line), flush=True)
+        else:
+            for line in read_lines(sys.stdin):
+                print(decode_line(strings, line), flush=True)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == '__main__':
+    main()
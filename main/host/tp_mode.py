@@ -0,0 +1,71 @@
+"""Print the touch pad's input mode and how long mode switches took.
+
+    python tp_mode.py            state and switch timings
+    python tp_mode.py --reset    clear the switch statistics first
+
+'accepted' runs from the host's SET_REPORT (or the receiver's command, or
+the VBUS edge) to the controller accepting the switch; 'first frame' to
+the first report of the new mode, so it only means something when a
+finger is on the pad while the mode changes.
+"""
+import argparse
+import struct
+import sys
+
+from tp_hid import FEATURE_PAGE_MODE, open_generic_interface, read_feature_page
+
+REPORT_VERSION = 1
+
+MODES = {0: 'mouse', 1: 'PTP'}
+# tp_mode.h tp_mode_source_t
+SOURCES = ['-', 'host', 'receiver', 'VBUS', 'reset']
+
+
+def parse(data):
+    page, version, mode, host_mode, radio_mode, source = struct.unpack_from('<6B', data, 0)
+    if page != FEATURE_PAGE_MODE or version != REPORT_VERSION:
+        raise ValueError(f'unexpected page {page:#x} version {version}')
+    switches, failures, command, command_max, frame, frame_max = struct.unpack_from('<6I', data, 8)
+    return {
+        'mode': mode,
+        'host_mode': host_mode,
+        'radio_mode': radio_mode,
+        'source': source,
+        'switches': switches,
+        'failures': failures,
+        'command': (command, command_max),
+        'frame': (frame, frame_max),
+    }
+
+
+def show(r):
+    source = SOURCES[r['source']] if r['source'] < len(SOURCES) else str(r['source'])
+    print(f'mode            {MODES.get(r["mode"], r["mode"])}')
+    print(f'host request    {r["host_mode"]:#04x}')
+    print(f'receiver        {MODES.get(r["radio_mode"], r["radio_mode"])}')
+    print(f'switches        {r["switches"]} ({r["failures"]} failed), last by {source}')
+    for name in ('command', 'frame'):
+        last, worst = r[name]
+        label = 'accepted' if name == 'command' else 'first frame'
+        print(f'{label:15} last {last / 1000:7.2f} ms  max {worst / 1000:7.2f} ms')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--reset', action='store_true', help='clear the switch statistics before reading')
+    args = parser.parse_args()
+
+    dev = open_generic_interface()
+    if dev is None:
+        sys.exit('Touch pad not found')
+
+    try:
+        if args.reset:
+            read_feature_page(dev, FEATURE_PAGE_MODE, reset=True)
+        show(parse(read_feature_page(dev, FEATURE_PAGE_MODE)))
+    finally:
+        dev.close()
+
+
+if __name__ == '__main__':
+    main()
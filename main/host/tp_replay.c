@@ -0,0 +1,330 @@
+// Replay a raw I2C capture (see trace/tp_capture_format.h) through the
+// firmware's decoder, filter and PTP report code.
+//
+//   tp_replay capture.tpcap                 print one line per PTP report
+//   tp_replay capture.tpcap -o out.txt      write the reports to a file
+//   tp_replay capture.tpcap -g golden.txt   exit 1 if the reports differ
+//   tp_replay capture.tpcap -b 1000         time 1000 passes over the capture
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "i2c/tp_frame.h"
+#include "i2c/tp_filter.h"
+#include "i2c/tp_tracker.h"
+#include "i2c/tp_assembler.h"
+#include "i2c/hid_decoder.h"
+#include "usb/ptp_report.h"
+#include "trace/tp_capture_format.h"
+
+// Timeout flush, lift, closed scan and completed scan
+#define REPLAY_MAX_REPORTS 4
+
+typedef struct {
+    uint32_t timestamp_us;
+    uint8_t len;                // report bytes after the length prefix
+    uint8_t data[TP_CAPTURE_FRAME_MAX + HID_DECODER_SLACK];
+} replay_frame_t;
+
+typedef struct {
+    uint8_t model;
+    hid_tp_layout_t layout;
+    hid_decoder_plan_t plan;
+    replay_frame_t *frames;
+    size_t frame_count;
+    size_t skipped_bytes;
+} replay_capture_t;
+
+typedef struct {
+    tp_filter_t filter;
+    tp_assembler_t assembler;
+    uint32_t last_us;
+    uint32_t touch_frames;
+    uint32_t other_frames;
+} replay_state_t;
+
+static tp_smooth_mode_t replay_smoothing = TP_SMOOTH_IIR;
+
+static const char *model_name(uint8_t model) {
+    switch (model) {
+    case TP_CAPTURE_MODEL_ELAN_33370A: return "ELAN 33370A";
+    case TP_CAPTURE_MODEL_GOODIX_GT7863: return "Goodix GT7863";
+    default: return "unknown";
+    }
+}
+
+static uint8_t *read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *buf = malloc(size > 0 ? (size_t)size : 1);
+    if (buf && fread(buf, 1, (size_t)size, f) != (size_t)size) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    *len = (size_t)size;
+    return buf;
+}
+
+static int load_capture(const char *path, replay_capture_t *cap) {
+    size_t len;
+    uint8_t *buf = read_file(path, &len);
+    if (!buf) {
+        fprintf(stderr, "%s: cannot read\n", path);
+        return -1;
+    }
+
+    // The stream may start with the tail of an earlier capture that was
+    // still queued on the device; skip to the first header.
+    tp_capture_header_t hdr;
+    size_t start = 0;
+    for (; start + sizeof(hdr) + sizeof(hid_tp_layout_t) <= len; start++) {
+        memcpy(&hdr, buf + start, sizeof(hdr));
+        if (hdr.magic == TP_CAPTURE_MAGIC) break;
+    }
+    if (start + sizeof(hdr) + sizeof(hid_tp_layout_t) > len) goto bad;
+    if (hdr.version != TP_CAPTURE_VERSION || hdr.layout_size != sizeof(hid_tp_layout_t)) goto bad;
+
+    memset(cap, 0, sizeof(*cap));
+    cap->model = hdr.model;
+    cap->skipped_bytes = start;
+    memcpy(&cap->layout, buf + start + sizeof(hdr), sizeof(hid_tp_layout_t));
+    hid_decoder_plan(&cap->layout, &cap->plan);
+    cap->frames = calloc(len / sizeof(tp_capture_record_t) + 1, sizeof(replay_frame_t));
+    if (!cap->frames) goto bad;
+
+    size_t pos = start + sizeof(hdr) + sizeof(hid_tp_layout_t);
+    while (pos + sizeof(tp_capture_record_t) <= len) {
+        tp_capture_record_t rec;
+        memcpy(&rec, buf + pos, sizeof(rec));
+
+        // Resynchronise on the next sync byte after a corrupt record
+        if (rec.sync != TP_CAPTURE_SYNC || rec.len > TP_CAPTURE_FRAME_MAX ||
+            pos + sizeof(rec) + rec.len > len) {
+            pos++;
+            cap->skipped_bytes++;
+            continue;
+        }
+
+        replay_frame_t *fr = &cap->frames[cap->frame_count++];
+        fr->timestamp_us = rec.timestamp_us;
+        memcpy(fr->data, buf + pos + sizeof(rec), rec.len);
+        // Same length the reader hands the driver: the prefix, cut to the read
+        uint16_t prefix = rec.len >= 2 ? fr->data[0] | (fr->data[1] << 8) : 0;
+        if (prefix > rec.len) prefix = rec.len;
+        fr->len = prefix > 2 ? prefix - 2 : 0;
+        pos += sizeof(rec) + rec.len;
+    }
+
+    free(buf);
+    return 0;
+
+bad:
+    fprintf(stderr, "%s: not a version %d capture\n", path, TP_CAPTURE_VERSION);
+    free(buf);
+    return -1;
+}
+
+static void replay_reset(replay_state_t *st) {
+    memset(st, 0, sizeof(*st));
+    tp_filter_init(&st->filter);
+    st->filter.smoothing = replay_smoothing;
+    tp_assembler_init(&st->assembler);
+}
+
+// Mirrors the driver tasks: multi-finger reports go through tp_filter
+// (goodix), one-contact reports through tp_filter_single and tp_assembler
+// (ELAN). The capture timestamps stand in for the timeouts. Returns the number of PTP
+// reports written to reports[] (at most REPLAY_MAX_REPORTS).
+static int replay_frame(replay_state_t *st, const hid_decoder_plan_t *plan,
+                        const replay_frame_t *fr, ptp_report_t *reports) {
+    const hid_tp_layout_t *layout = plan->layout;
+    tp_raw_frame_t raw;
+    tp_multi_msg_t msg;
+    uint16_t now = (uint16_t)(fr->timestamp_us / 100);
+    int n = 0;
+
+    if (layout->finger_count == 1 && tp_assembler_pending(&st->assembler) &&
+        fr->timestamp_us - st->last_us >= TP_ASSEMBLER_TIMEOUT_MS * 1000 &&
+        tp_assembler_flush(&st->assembler, &msg)) {
+        ptp_report_build(&msg, &reports[n++]);
+    }
+    st->last_us = fr->timestamp_us;
+
+    // Contacts the controller stopped reporting, lifted at their deadline
+    if (layout->finger_count > 1) {
+        if (tp_filter_expire(&st->filter, now, &msg)) ptp_report_build(&msg, &reports[n++]);
+    } else {
+        uint8_t ended = tp_filter_expire_tracks(&st->filter, now);
+        if (ended &&
+            tp_assembler_lift(&st->assembler, ended, tp_tracker_scan_time(&st->filter.tracker, now), now, &msg)) {
+            ptp_report_build(&msg, &reports[n++]);
+        }
+    }
+
+    if (!hid_decoder_decode(plan, &fr->data[2], fr->len, &raw)) {
+        st->other_frames++;
+        return n;
+    }
+    st->touch_frames++;
+
+    if (layout->finger_count > 1) {
+        tp_filter_process(&st->filter, &raw, now, &msg);
+        ptp_report_build(&msg, &reports[n++]);
+        return n;
+    }
+
+    tp_trace_t trace = {0};
+    if (tp_assembler_begin(&st->assembler, raw.scan_time, 0, &trace, &msg)) {
+        ptp_report_build(&msg, &reports[n++]);
+    }
+
+    tp_finger_t finger;
+    bool have = tp_filter_single(&st->filter, &raw, now, &finger);
+    if (tp_assembler_add(&st->assembler, &raw, have ? &finger : NULL, &msg)) {
+        ptp_report_build(&msg, &reports[n++]);
+    }
+    return n;
+}
+
+static void format_report(FILE *out, uint32_t timestamp_us, const ptp_report_t *report) {
+    fprintf(out, "%10u scan=%5u count=%u btn=%u", timestamp_us, report->scan_time,
+            report->contact_count, report->buttons);
+    for (int i = 0; i < 5; i++) {
+        const finger_t *f = &report->fingers[i];
+        fprintf(out, " %02X:%4u,%4u", f->tip_conf_id, f->x, f->y);
+    }
+    fputc('\n', out);
+}
+
+static int compare_files(FILE *a, const char *golden_path) {
+    FILE *g = fopen(golden_path, "r");
+    if (!g) {
+        fprintf(stderr, "%s: cannot read\n", golden_path);
+        return -1;
+    }
+
+    rewind(a);
+    char la[256], lg[256];
+    int line = 0, rc = 0;
+    while (1) {
+        char *ra = fgets(la, sizeof(la), a);
+        char *rg = fgets(lg, sizeof(lg), g);
+        line++;
+        if (!ra && !rg) break;
+        if (!ra || !rg || strcmp(la, lg) != 0) {
+            fprintf(stderr, "mismatch at report %d\n  got:    %s  golden: %s", line,
+                    ra ? la : "<end>\n", rg ? lg : "<end>\n");
+            rc = 1;
+            break;
+        }
+    }
+    fclose(g);
+    return rc;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void bench(const replay_capture_t *cap, int passes) {
+    replay_state_t st;
+    ptp_report_t reports[REPLAY_MAX_REPORTS];
+    uint32_t checksum = 0;
+    uint64_t frames = 0;
+
+    uint64_t t0 = now_ns();
+    for (int p = 0; p < passes; p++) {
+        replay_reset(&st);
+        for (size_t i = 0; i < cap->frame_count; i++) {
+            int n = replay_frame(&st, &cap->plan, &cap->frames[i], reports);
+            for (int r = 0; r < n; r++) {
+                checksum += reports[r].fingers[0].x + reports[r].scan_time;
+            }
+        }
+        frames += cap->frame_count;
+    }
+    uint64_t t1 = now_ns();
+
+    double ns = (double)(t1 - t0) / (double)frames;
+    printf("replay: %llu frames in %d passes, %.1f ns/frame, %.0f frames/s (checksum %08x)\n",
+           (unsigned long long)frames, passes, ns, 1e9 / ns, (unsigned)checksum);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: tp_replay <capture.tpcap> [-o reports.txt] [-g golden.txt] [-b passes] [-s iir|euro|kalman]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    const char *in_path = NULL, *out_path = NULL, *golden_path = NULL;
+    int passes = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) out_path = argv[++i];
+        else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) golden_path = argv[++i];
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) passes = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            const char *mode = argv[++i];
+            if (strcmp(mode, "iir") == 0) replay_smoothing = TP_SMOOTH_IIR;
+            else if (strcmp(mode, "euro") == 0) replay_smoothing = TP_SMOOTH_ONE_EURO;
+            else if (strcmp(mode, "kalman") == 0) replay_smoothing = TP_SMOOTH_KALMAN;
+            else usage();
+        }
+        else if (argv[i][0] != '-' && !in_path) in_path = argv[i];
+        else usage();
+    }
+    if (!in_path) usage();
+
+    replay_capture_t cap;
+    if (load_capture(in_path, &cap) != 0) return 1;
+
+    fprintf(stderr, "%s: %s, report 0x%02X, %u finger(s)/report, %zu frames",
+            in_path, model_name(cap.model), cap.layout.report_id, cap.layout.finger_count, cap.frame_count);
+    if (cap.frame_count > 1) {
+        uint32_t span = cap.frames[cap.frame_count - 1].timestamp_us - cap.frames[0].timestamp_us;
+        fprintf(stderr, " over %.3f s", span / 1e6);
+    }
+    if (cap.skipped_bytes) fprintf(stderr, ", %zu corrupt bytes skipped", cap.skipped_bytes);
+    fputc('\n', stderr);
+
+    if (passes > 0) {
+        bench(&cap, passes);
+        free(cap.frames);
+        return 0;
+    }
+
+    FILE *out = stdout;
+    if (out_path) out = fopen(out_path, "w+");
+    else if (golden_path) out = tmpfile();
+    if (!out) {
+        fprintf(stderr, "cannot open output\n");
+        return 1;
+    }
+
+    replay_state_t st;
+    replay_reset(&st);
+    for (size_t i = 0; i < cap.frame_count; i++) {
+        ptp_report_t reports[REPLAY_MAX_REPORTS];
+        int n = replay_frame(&st, &cap.plan, &cap.frames[i], reports);
+        for (int r = 0; r < n; r++) {
+            format_report(out, cap.frames[i].timestamp_us, &reports[r]);
+        }
+    }
+    fprintf(stderr, "%u touch reports, %u other reports\n", st.touch_frames, st.other_frames);
+
+    int rc = 0;
+    if (golden_path) rc = compare_files(out, golden_path) ? 1 : 0;
+    if (out != stdout) fclose(out);
+    free(cap.frames);
+    return rc;
+}
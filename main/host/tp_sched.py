@@ -0,0 +1,110 @@
+"""Print the task plan monitor (needs CONFIG_TP_SCHED_MONITOR).
+
+    python tp_sched.py                print once
+    python tp_sched.py --reset        clear the statistics first
+    python tp_sched.py --watch 1      refresh every second
+    python tp_sched.py --stress 20    touch-path jitter, idle radio vs saturated
+                                      (CONFIG_TP_SCHED_STRESS, keep a finger moving)
+
+For a before/after comparison run --stress on a build with
+CONFIG_TP_TASK_PLAN_LEGACY and on one with the default plan. Frame-time
+jitter is the spread (p99 - min) of the touch-to-USB latency, so
+CONFIG_TP_LATENCY_TRACE must be on as well.
+"""
+import argparse
+import struct
+import sys
+import time
+
+from tp_hid import (CMD_STRESS_START, CMD_STRESS_STOP, FEATURE_PAGE_LATENCY, FEATURE_PAGE_SCHED,
+                    open_generic_interface, read_feature_page, send_command)
+from tp_latency import parse as parse_latency
+
+REPORT_VERSION = 2
+
+# tp_tasks.h order
+STAGES = ['tp_reader', 'i2c_task', 'hid']
+TASKS = ['tp_reader', 'i2c_task', 'hid', 'TinyUSB', 'mode_sel', 'vbus_task', 'tp_capture', 'heartbeat', 'tp_log',
+         'stress']
+
+
+def parse(data):
+    page, version, stage_count, task_count, window_ms = struct.unpack_from('<BBBBI', data, 0)
+    if page != FEATURE_PAGE_SCHED or version != REPORT_VERSION:
+        raise ValueError(f'unexpected page {page:#x} version {version}')
+    stages = [struct.unpack_from('<4H', data, 8 + s * 8) for s in range(stage_count)]
+    shares = list(struct.unpack_from(f'<{task_count + 1}H', data, 32))
+    shares.append(max(0, 1000 - sum(shares)))
+    prios = data[32 + (task_count + 1) * 2:32 + (task_count + 1) * 2 + task_count]
+    return window_ms, stages, shares, prios
+
+
+def show(window_ms, stages, shares, prios):
+    print(f'{window_ms / 1000:.1f} s')
+    print(f'{"wake delay (us)":16} {"avg":>6} {"max":>6} {"budget":>6} {"over":>6}')
+    for name, (avg, hi, budget, over) in zip(STAGES, stages):
+        print(f'{name:16} {avg:6} {hi:6} {budget:6} {over:6}')
+
+    print(f'{"task":16} {"prio":>4} {"cpu %":>6}')
+    names = TASKS + ['idle', 'other']
+    for i, (name, share) in enumerate(zip(names, shares)):
+        if i < len(prios) and prios[i] == 0:
+            continue
+        prio = str(prios[i]) if i < len(prios) else ''
+        print(f'{name:16} {prio:>4} {share / 10:6.1f}')
+
+
+def measure(dev, seconds):
+    read_feature_page(dev, FEATURE_PAGE_LATENCY, reset=True)
+    read_feature_page(dev, FEATURE_PAGE_SCHED, reset=True)
+    time.sleep(seconds)
+    frames, lat, _ = parse_latency(read_feature_page(dev, FEATURE_PAGE_LATENCY))
+    sched = parse(read_feature_page(dev, FEATURE_PAGE_SCHED))
+    lo, avg, p99, hi = lat[-1]
+    print(f'{frames} frames, touch-to-USB min {lo} avg {avg} p99 {p99} max {hi} us, jitter {p99 - lo} us')
+    show(*sched)
+
+
+def stress(dev, seconds):
+    print('== radio idle')
+    measure(dev, seconds / 2)
+    send_command(dev, CMD_STRESS_START)
+    try:
+        print('\n== radio saturated')
+        measure(dev, seconds / 2)
+    finally:
+        send_command(dev, CMD_STRESS_STOP)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--reset', action='store_true', help='clear the statistics before reading')
+    parser.add_argument('--watch', type=float, default=0, help='refresh interval in seconds')
+    parser.add_argument('--stress', type=float, default=0, metavar='SECONDS',
+                        help='measure half the time idle, half with the radio saturated')
+    args = parser.parse_args()
+
+    dev = open_generic_interface()
+    if dev is None:
+        sys.exit('Touch pad not found')
+
+    try:
+        if args.stress:
+            stress(dev, args.stress)
+            return
+        if args.reset:
+            read_feature_page(dev, FEATURE_PAGE_SCHED, reset=True)
+        while True:
+            show(*parse(read_feature_page(dev, FEATURE_PAGE_SCHED)))
+            if not args.watch:
+                break
+            time.sleep(args.watch)
+            print()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        dev.close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,39 @@
+"""Show or change the contact position smoothing (CONFIG_TP_SMOOTHING).
+
+    python tp_smoothing.py            print the mode in use
+    python tp_smoothing.py kalman     switch to iir, euro or kalman until reset
+
+Compare the modes offline with tp_replay -s on a capture, or tp_bench.
+"""
+import argparse
+import sys
+
+from tp_hid import FEATURE_PAGE_FILTER, open_generic_interface, read_feature_page, write_feature_page
+
+MODES = ['iir', 'euro', 'kalman']
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('mode', nargs='?', choices=MODES)
+    args = parser.parse_args()
+
+    dev = open_generic_interface()
+    if dev is None:
+        sys.exit('Touch pad not found')
+
+    try:
+        if args.mode:
+            data = write_feature_page(dev, FEATURE_PAGE_FILTER, [MODES.index(args.mode)])
+        else:
+            data = read_feature_page(dev, FEATURE_PAGE_FILTER)
+    finally:
+        dev.close()
+
+    if data[0] != FEATURE_PAGE_FILTER:
+        sys.exit(f'unexpected page {data[0]:#x}')
+    print(MODES[data[1]] if data[1] < len(MODES) else f'unknown mode {data[1]}')
+
+
+if __name__ == '__main__':
+    main()
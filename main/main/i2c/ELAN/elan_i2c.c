@@ -7,35 +7,29 @@
 #include "esp_log.h"
 #include "esp_timer.h"
 
-#include "i2c/ELAN/elan_i2c.h"
 #include "i2c/I2C_HID_Report.h"
+#include "i2c/tp_driver.h"
+#include "i2c/i2c_hid.h"
+#include "i2c/tp_pipe.h"
+#include "i2c/tp_assembler.h"
+#include "i2c/tp_filter.h"
+#include "i2c/tp_reader.h"
+#include "trace/tp_capture.h"
+#include "trace/tp_latency.h"
+#include "trace/tp_sched.h"
 
 #include "usb/usbhid.h"
-
-#include <math.h>
+#include "tp_mode.h"
 
 static const char *TAG = "ELAN_PTP";
 
-QueueHandle_t tp_queue = NULL;
-QueueHandle_t mouse_queue = NULL;
-QueueSetHandle_t main_queue_set = NULL;
-volatile uint8_t current_mode = MOUSE_MODE;
-
 #define I2C_ADDR 0x15
 #define RST_IO   6
 #define INT_IO   7
+#define SCL_IO   9
+#define SDA_IO   8
 
-i2c_master_dev_handle_t dev_handle = NULL;
-i2c_master_bus_handle_t bus_handle = NULL;
-
-TaskHandle_t tp_read_task_handle = NULL;
-
-#define TAP_MOVE_THRESHOLD 10
-#define TAP_TIME_THRESHOLD 150
-#define DOUBLE_TAP_WINDOW  50
-#define MULTI_TAP_JOIN_MS 30
-
-esp_err_t elan_activate_ptp() {
+static esp_err_t elan_activate_ptp(void) {
     uint8_t payload[] = {
         0x05, 0x00,             // Command Register
         0x33, 0x03,             // SET_REPORT Feature ID 03
@@ -46,7 +40,7 @@ esp_err_t elan_activate_ptp() {
     return i2c_master_transmit(dev_handle, payload, sizeof(payload), 200);
 }
 
-esp_err_t elan_activate_mouse() {
+static esp_err_t elan_activate_mouse(void) {
     uint8_t payload[] = {
         0x05, 0x00,
         0x33, 0x03,
@@ -57,34 +51,39 @@ esp_err_t elan_activate_mouse() {
     return i2c_master_transmit(dev_handle, payload, sizeof(payload), 200);
 }
 
-typedef struct {
-    uint8_t tip_offset;
-    uint8_t id_offset;
-    uint8_t x_offset;
-    uint8_t y_offset;
-    uint8_t x_size;
-    uint8_t y_size;
-    uint8_t block_size;
-    bool nibble_packed;
-} finger_layout_t;
-
-void elan_i2c_init(void) {
-    gpio_set_direction(RST_IO, GPIO_MODE_OUTPUT);
-    gpio_set_level(RST_IO, 0);
-    vTaskDelay(pdMS_TO_TICKS(50));
-    gpio_set_level(RST_IO, 1);
-    vTaskDelay(pdMS_TO_TICKS(150));
-
-    i2c_master_bus_config_t bus_cfg = {
-        .clk_source = I2C_CLK_SRC_DEFAULT,
-        .i2c_port = I2C_NUM_0,
-        .scl_io_num = 9,
-        .sda_io_num = 8,
-        .glitch_ignore_cnt = 7,
-        .flags.enable_internal_pullup = true,
-    };
-    ESP_ERROR_CHECK(i2c_new_master_bus(&bus_cfg, &bus_handle));
-
+#define ELAN_HID_DESC_REG 0x0001
+
+#define ELAN_LOGICAL_MAX_X 0x0E5F
+#define ELAN_LOGICAL_MAX_Y 0x08D5
+_Static_assert(TP_OUTPUT_FITS(ELAN_LOGICAL_MAX_X) && TP_OUTPUT_FITS(ELAN_LOGICAL_MAX_Y),
+               "CONFIG_TP_SUBPIXEL_BITS too large for the ELAN range");
+
+// ELAN reports one contact per input report (hybrid mode).
+static const hid_tp_layout_t elan_default_layout = {
+    .report_id = 0x04,
+    .finger_count = 1,
+    .report_len = 10,
+    .logical_max_x = ELAN_LOGICAL_MAX_X,
+    .logical_max_y = ELAN_LOGICAL_MAX_Y,
+    .fingers = {
+        {
+            .tip        = HID_FIELD(9, 1),
+            .confidence = HID_FIELD(8, 1),
+            .contact_id = HID_FIELD(12, 4),
+            .x          = HID_FIELD(16, 16),
+            .y          = HID_FIELD(32, 16),
+        },
+    },
+    .scan_time = HID_FIELD(48, 16),
+    .contact_count = HID_FIELD(64, 8),
+    .button = HID_FIELD(72, 1),
+};
+
+static hid_tp_layout_t elan_layout;
+static hid_decoder_plan_t elan_plan;
+static bool elan_layout_builtin = false;
+
+static void elan_i2c_init(void) {
     i2c_device_config_t dev_cfg = {
         .dev_addr_length = I2C_ADDR_BIT_LEN_7,
         .device_address = I2C_ADDR,
@@ -94,179 +93,134 @@ void elan_i2c_init(void) {
 
     uint8_t pwr_on[] = {0x05, 0x00, 0x08, 0x00};
     i2c_master_transmit(dev_handle, pwr_on, 4, 100);
-    vTaskDelay(pdMS_TO_TICKS(20));
-    vTaskDelay(pdMS_TO_TICKS(100));
+    i2c_hid_wait_ready(dev_handle, ELAN_HID_DESC_REG, I2C_HID_POWER_ON_MS);
+
+    uint16_t input_len;
+    elan_layout = elan_default_layout;
+    i2c_hid_load_layout(dev_handle, ELAN_HID_DESC_REG, &elan_layout, &input_len);
+    elan_layout_builtin = memcmp(&elan_layout, &elan_default_layout, sizeof(elan_layout)) == 0;
+    hid_decoder_plan(&elan_layout, &elan_plan);
+    tp_driver_check_layout(&elan_layout);
+    tp_capture_set_source(TP_CAPTURE_MODEL_ELAN_33370A, &elan_layout);
 
     gpio_set_direction(INT_IO, GPIO_MODE_INPUT);
     gpio_set_pull_mode(INT_IO, GPIO_PULLUP_ONLY);
-}
-
-#define TAP_DEADZONE 30
-
-typedef enum {
-    TOUCH_IDLE,
-    TOUCH_TAP_CANDIDATE,
-    TOUCH_DRAG
-} touch_state_t;
-
-uint16_t global_scan_time = 0;
-bool global_watchdog_start = false;
-
-void elan_i2c_task(void *arg) {
-    static uint16_t last_raw_x[5] = {0};
-    static uint16_t last_raw_y[5] = {0};
-    static uint16_t origin_x[5] = {0};
-    static uint16_t origin_y[5] = {0};
-    static bool tap_frozen[5] = {false};
-    static touch_state_t touch_state[5] = {0};
-    static uint32_t filtered_x[5] = {0};
-    static uint32_t filtered_y[5] = {0};
-    static uint8_t finger_life_status = 0;
-
-    #define DUAL_WAIT_TIMEOUT_MS 8
-
-    uint8_t data[64];
-    const uint16_t JUMP_THRESHOLD = 800;
-
-    while (1) {
-        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1)); 
-
-        tp_multi_msg_t tp_current_state = {0}; 
-        mouse_msg_t mouse_current_state = {0};
-        bool has_data = false;
-
-        int safety = 10;
-        while (gpio_get_level(INT_IO) == 0 && safety-- > 0) {
-            if (i2c_master_receive(dev_handle, data, sizeof(data), pdMS_TO_TICKS(5)) == ESP_OK) {
-                has_data = true;
-                tp_current_state.button_mask = (data[11] & 0x01) ? 0x01 : 0x00;
 
-                if (data[2] == 0x04) {
-                    current_mode = PTP_MODE;
-
-                    uint8_t id = (data[3] & 0xF0) >> 4;
-                    finger_life_status = data[3];
-
-                    if (id < 5) {
-                        tp_current_state.scan_time = data[8] | (data[9] << 8);
-                        global_scan_time = tp_current_state.scan_time;
-
-                        uint16_t rx = data[4] | (data[5] << 8);
-                        uint16_t ry = data[6] | (data[7] << 8);
-
-                        if (last_raw_x[id] == 0) {
-                            filtered_x[id] = rx << 8;
-                            filtered_y[id] = ry << 8;
-                        } else {
-                            int vx = rx - last_raw_x[id];
-                            int vy = ry - last_raw_y[id];
-                            int alpha_speed = abs(vx) + abs(vy);
-
-                            uint32_t dynamic_alpha;
-                            if (alpha_speed < 3) dynamic_alpha = 64;
-                            else if (alpha_speed < 12) dynamic_alpha = 115;
-                            else dynamic_alpha = 218;
-
-                            filtered_x[id] = (dynamic_alpha * (rx << 8) + 
-                                                (256 - dynamic_alpha) * filtered_x[id]) >> 8;
-                            filtered_y[id] = (dynamic_alpha * (ry << 8) + 
-                                                (256 - dynamic_alpha) * filtered_y[id]) >> 8;
-                        }
-
-                        uint16_t fx = (uint16_t)(filtered_x[id] >> 8);
-                        uint16_t fy = (uint16_t)(filtered_y[id] >> 8);
+    tp_reader_start(bus_handle, dev_handle, I2C_ADDR, input_len);
+}
 
-                        int dx_raw = rx - last_raw_x[id];
-                        int dy_raw = ry - last_raw_y[id];
-                        if (abs(dx_raw) > abs(dy_raw) * 2 && abs(dy_raw) < 6) ry = last_raw_y[id];
-                        else if (abs(dy_raw) > abs(dx_raw) * 2 && abs(dx_raw) < 6) rx = last_raw_x[id];
+static tp_filter_t elan_filter;
+static tp_assembler_t assembler;
 
-                        int dx = abs((int)rx - (int)origin_x[id]);
-                        int dy = abs((int)ry - (int)origin_y[id]);
+static void elan_send_frame(tp_multi_msg_t *msg) {
+    tp_latency_filter(&msg->trace);
+    tp_pipe_send_touch(msg);
+}
 
-                        if (touch_state[id] == TOUCH_TAP_CANDIDATE && (dx > TAP_DEADZONE || dy > TAP_DEADZONE)) {
-                            touch_state[id] = TOUCH_DRAG;
-                            tap_frozen[id] = false;
-                        }
+// Contacts whose tracks timed out are lifted in a frame of their own,
+// after the scan still being assembled.
+static void elan_expire_contacts(void) {
+    tp_multi_msg_t msg;
+    uint16_t now = tp_capture_ticks();
 
-                        if (touch_state[id] == TOUCH_TAP_CANDIDATE) {
-                            if (!tap_frozen[id]) {
-                                tap_frozen[id] = true;
-                                filtered_x[id] = origin_x[id];
-                                filtered_y[id] = origin_y[id];
-                            }
-                            tp_current_state.fingers[id].x = origin_x[id];
-                            tp_current_state.fingers[id].y = origin_y[id];
-                        } else {
-                            tap_frozen[id] = false;
-                            tp_current_state.fingers[id].x = fx;
-                            tp_current_state.fingers[id].y = fy;
-                        }
+    uint8_t ended = tp_filter_expire_tracks(&elan_filter, now);
+    if (ended == 0) return;
 
-                        int sum_x = 0, sum_y = 0, count = 0;
-                        for (int i = 0; i < 5; i++) {
-                            if (tap_frozen[i]) {
-                                sum_x += origin_x[i];
-                                sum_y += origin_y[i];
-                                count++;
-                            }
-                        }
-                        if (count > 1) {
-                            int avg_x = sum_x / count;
-                            int avg_y = sum_y / count;
-                            for (int i = 0; i < 5; i++) {
-                                if (tap_frozen[i]) {
-                                    origin_x[i] = avg_x;
-                                    origin_y[i] = avg_y;
-                                }
-                            }
-                        }
+    if (tp_assembler_flush(&assembler, &msg)) {
+        elan_send_frame(&msg);
+    }
+    if (tp_assembler_lift(&assembler, ended, tp_tracker_scan_time(&elan_filter.tracker, now), now, &msg)) {
+        tp_pipe_send_touch(&msg);
+    }
+}
 
-                        if (!tap_frozen[id] && last_raw_x[id] != 0 &&
-                            abs((int)rx - (int)last_raw_x[id]) > JUMP_THRESHOLD) {
-                            tp_current_state.fingers[id].x = last_raw_x[id];
-                            tp_current_state.fingers[id].y = last_raw_y[id];
-                        }
+static void elan_i2c_task(void *arg) {
+    tp_raw_frame_t raw;
+    tp_multi_msg_t msg;
 
-                        last_raw_x[id] = rx;
-                        last_raw_y[id] = ry;
+    tp_filter_init(&elan_filter);
+    tp_assembler_init(&assembler);
+    tp_reader_set_consumer(xTaskGetCurrentTaskHandle());
 
-                        if ((finger_life_status & 0x0F) == 0x03) {
-                            tp_current_state.fingers[id].tip_switch = 1;
-                        } else {
-                            tp_current_state.fingers[id].tip_switch = 0;
-                        }
-                        tp_current_state.fingers[id].confidence = 1;
-                        tp_current_state.fingers[id].contact_id = id;
-                    }
-                } else if (data[2] == 0x01) {
-                    has_data = true;
-                    current_mode = MOUSE_MODE;
-                    mouse_current_state.x = (int8_t)data[4];
-                    mouse_current_state.y = (int8_t)data[5];
-                    mouse_current_state.buttons = data[3];
-                } else {
-                    break;
-                }
+    while (1) {
+        // Woken by tp_reader per buffered frame. A scan still missing
+        // contacts is sent as it is after the timeout, and contacts no
+        // longer reported are lifted at their deadline.
+        if (tp_reader_peek() == NULL) {
+            TickType_t wait = tp_driver_expiry_wait(&elan_filter.tracker);
+            bool scan_due = false;
+            if (tp_assembler_pending(&assembler) && wait >= pdMS_TO_TICKS(TP_ASSEMBLER_TIMEOUT_MS)) {
+                wait = pdMS_TO_TICKS(TP_ASSEMBLER_TIMEOUT_MS);
+                scan_due = true;
+            }
+            if (ulTaskNotifyTake(pdTRUE, wait) == 0 && scan_due && tp_assembler_flush(&assembler, &msg)) {
+                elan_send_frame(&msg);
+            }
+            if (tp_reader_peek() == NULL) {
+                elan_expire_contacts();
             }
         }
+        tp_sched_woken(TP_TASK_DRIVER);
+
+        // Touch frames go out per scan through the assembler, mouse frames
+        // one message each; tp_pipe merges them if usbhid_task falls behind
+        const tp_reader_frame_t *frame;
+        for (; (frame = tp_reader_peek()) != NULL; tp_reader_release()) {
+            const uint8_t *data = frame->data;
+            size_t len = frame->len - 2;    // tp_reader drops reports of 2 bytes or less
+
+            bool is_tp = elan_layout_builtin
+                ? hid_decoder_decode_inline(&elan_default_layout, &data[2], len, &raw)
+                : hid_decoder_decode(&elan_plan, &data[2], len, &raw);
+            if (is_tp) {
+                tp_mode_frame(PTP_MODE);
+
+                if (tp_assembler_begin(&assembler, raw.scan_time, frame->capture_ticks, &frame->trace, &msg)) {
+                    elan_send_frame(&msg);
+                }
 
-        if (current_mode == PTP_MODE) {
-            if (has_data || tp_current_state.button_mask) {
-
-                tp_current_state.actual_count = ((finger_life_status >> 4) & 0x0F) + 1;
-                xQueueOverwrite(tp_queue, &tp_current_state);
-
-                if (finger_life_status == 0x11) {
-                    global_watchdog_start = true;
-                    watchdog_x = tp_current_state.fingers[0].x;
-                    watchdog_y = tp_current_state.fingers[0].y;
-                } else {
-                    global_watchdog_start = false;
+                // The same per-contact filter stage as the Goodix driver,
+                // one contact at a time
+                tp_finger_t finger;
+                elan_filter.smoothing = tp_smoothing;
+                bool have = tp_filter_single(&elan_filter, &raw, frame->capture_ticks, &finger);
+                if (tp_assembler_add(&assembler, &raw, have ? &finger : NULL, &msg)) {
+                    elan_send_frame(&msg);
                 }
+            } else if (data[2] == 0x01 && len >= MOUSE_REPORT_LEN) {
+                mouse_msg_t mouse = {
+                    .buttons = data[3],
+                    .x = (int8_t)data[4],
+                    .y = (int8_t)data[5],
+                };
+
+                tp_mode_frame(MOUSE_MODE);
+                tp_pipe_send_mouse(&mouse);
+            } else {
+                tp_reader_release();
+                break;
             }
-        } else if (current_mode == MOUSE_MODE) {
-            xQueueOverwrite(mouse_queue, &mouse_current_state);
         }
     }
-}
\ No newline at end of file
+}
+
+const tp_driver_t elan_33370a_driver = {
+    .name = "ELAN 33370A",
+    .addr = I2C_ADDR,
+    .scl_io = SCL_IO,
+    .sda_io = SDA_IO,
+    .rst_io = RST_IO,
+    .int_io = INT_IO,
+    .controller_max_x = ELAN_LOGICAL_MAX_X,
+    .controller_max_y = ELAN_LOGICAL_MAX_Y,
+    .logical_max_x = TP_OUTPUT_MAX(ELAN_LOGICAL_MAX_X),
+    .logical_max_y = TP_OUTPUT_MAX(ELAN_LOGICAL_MAX_Y),
+    .physical_max_x = 0x2DB4,
+    .physical_max_y = 0x1C20,
+    .unit_exponent = 0x0D,
+    .unit = 0x11,
+    .init = elan_i2c_init,
+    .activate_ptp = elan_activate_ptp,
+    .activate_mouse = elan_activate_mouse,
+    .task = elan_i2c_task,
+};
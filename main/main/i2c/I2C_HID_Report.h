@@ -4,26 +4,16 @@
 #include "driver/i2c_master.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "esp_timer.h"
 
-extern uint16_t watchdog_x;
-extern uint16_t watchdog_y;
+#include "i2c/tp_frame.h"
+#include "usb/ptp_report.h"
+#include "wl_msg.h"
 
-extern uint16_t global_scan_time;
-
-typedef struct {
-    uint16_t x;
-    uint16_t y;
-    uint8_t tip_switch;
-    uint8_t contact_id;
-    uint8_t confidence;
-} tp_finger_t;
-
-typedef struct {
-    tp_finger_t fingers[5];
-    uint8_t actual_count;
-    uint8_t button_mask;
-    uint16_t scan_time;
-} tp_multi_msg_t;
+// esp_timer in the 100 us unit of the PTP scan time, wrapping every 6.5536 s
+static inline uint16_t tp_capture_ticks(void) {
+    return (uint16_t)(esp_timer_get_time() / 100);
+}
 
 typedef struct __attribute__((packed)) {
     uint8_t buttons;
@@ -35,12 +25,6 @@ typedef struct __attribute__((packed)) {
     uint8_t vbus_level;
 } vbus_msg_t;
 
-typedef struct __attribute__((packed)) {
-    uint8_t vbus_level;
-    uint8_t battery_level;
-    uint32_t uptime;
-} alive_msg_t;
-
 typedef struct {
     bool active;
     uint32_t down_time;
@@ -50,10 +34,6 @@ typedef struct {
     bool tap_detected;
 } tp_finger_life_t;
 
-extern QueueHandle_t tp_queue;
-extern QueueHandle_t mouse_queue;
-extern QueueSetHandle_t main_queue_set;
-
 typedef enum {
     MOUSE_MODE = 0,
     PTP_MODE = 1,
@@ -61,77 +41,18 @@ typedef enum {
     ALIVE_MODE = 3
 } input_mode_t;
 
-typedef struct __attribute__((packed)) {
-    uint8_t tip_conf_id;  // Bit0:None, Bit1:Confidence, Bit2:Tip, Bit3:Confidence Tip
-    uint16_t x;           
-    uint16_t y;           
-} finger_t;
-
-typedef struct __attribute__((packed)) {
-    finger_t fingers[5];   // 5 * 5 = 25 bytes
-    uint16_t scan_time;    // 2 bytes
-    uint8_t contact_count; // 1 byte
-    uint8_t buttons;       // 1 byte
-} ptp_report_t;
-
 typedef struct __attribute__((packed)) {
     uint8_t buttons;
     int8_t  x;
     int8_t  y;
 } mouse_hid_report_t;
 
-typedef struct __attribute__((packed)) {
-    input_mode_t type;
-    union {
-        mouse_hid_report_t mouse;
-        ptp_report_t       ptp;
-        vbus_msg_t         vbus;
-        alive_msg_t        alive;
-    } payload;
-} wireless_msg_t;
-
+// Mode the controller was switched to; written by tp_mode only
 extern volatile uint8_t current_mode;
 
 extern i2c_master_dev_handle_t dev_handle; 
 extern i2c_master_bus_handle_t bus_handle;
 
-extern void elan_i2c_task(void *arg);
-extern void goodix_i2c_task(void *arg);
 extern void i2c_tp_int_init(void);
-extern void elan_i2c_init();
-extern void goodix_i2c_init(void);
-
-extern esp_err_t elan_activate_ptp();
-extern esp_err_t elan_activate_mouse();
-extern esp_err_t goodix_activate_ptp();
-extern esp_err_t goodix_activate_mouse();
-
-#if CONFIG_ELAN_LENOVO_33370A
-    #define activate_ptp elan_activate_ptp
-    #define activate_mouse elan_activate_mouse
-    #define LOGICAL_X  0x26, 0x5F, 0x0E
-    #define LOGICAL_Y  0x26, 0xD5, 0x08
-    #define PHYSICAL_X 0x46, 0xB4, 0x2D
-    #define PHYSICAL_Y 0x46, 0x20, 0x1C
-    #define PHYSICAL_UNIT_EXPONENT 0x55, 0x0D
-    #define PHYSICAL_UNIT 0x65, 0x11
-    #define tp_i2c_task elan_i2c_task
-    #define i2c_tp_init elan_i2c_init
-    #define TP_INT_GPIO 7
-#elif CONFIG_MI_GOODIX_HAPTIC_ENGINE
-    #define activate_ptp goodix_activate_ptp
-    #define activate_mouse goodix_activate_mouse
-    #define LOGICAL_X  0x26, 0x7F, 0x0D
-    #define LOGICAL_Y  0x26, 0x6F, 0x08
-    #define PHYSICAL_X 0x46, 0xF0, 0x01
-    #define PHYSICAL_Y 0x46, 0x46, 0x01
-    #define PHYSICAL_UNIT_EXPONENT 0x55, 0x0E
-    #define PHYSICAL_UNIT 0x65, 0x13
-    #define tp_i2c_task goodix_i2c_task
-    #define i2c_tp_init goodix_i2c_init
-    #define TP_INT_GPIO 4
-#endif
-
-#define WATCHDOG_TIMEOUT_US (100 * 100)
 
 #endif
\ No newline at end of file
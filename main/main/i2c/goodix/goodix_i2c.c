@@ -7,30 +7,28 @@
 #include "esp_log.h"
 #include "esp_timer.h"
 
-#include "i2c/goodix/goodix_i2c.h"
 #include "i2c/I2C_HID_Report.h"
+#include "i2c/tp_driver.h"
+#include "i2c/tp_filter.h"
+#include "i2c/i2c_hid.h"
+#include "i2c/tp_pipe.h"
+#include "i2c/tp_reader.h"
+#include "trace/tp_capture.h"
+#include "trace/tp_latency.h"
+#include "trace/tp_sched.h"
 
 #include "usb/usbhid.h"
-
-#include <math.h>
+#include "tp_mode.h"
 
 static const char *TAG = "GOODIX_PTP";
 
-QueueHandle_t tp_queue = NULL;
-QueueHandle_t mouse_queue = NULL;
-QueueSetHandle_t main_queue_set = NULL;
-volatile uint8_t current_mode = MOUSE_MODE;
-
 #define I2C_ADDR 0x2c
 #define RST_IO   3
 #define INT_IO   4
+#define SCL_IO   6
+#define SDA_IO   7
 
-i2c_master_dev_handle_t dev_handle = NULL;
-i2c_master_bus_handle_t bus_handle = NULL;
-
-TaskHandle_t tp_read_task_handle = NULL;
-
-esp_err_t goodix_activate_ptp() {
+static esp_err_t goodix_activate_ptp(void) {
     uint8_t payload[] = {
         0x05, 0x00,             // Command Register
         0x33, 0x03,             // SET_REPORT Feature ID 03
@@ -41,7 +39,7 @@ esp_err_t goodix_activate_ptp() {
     return i2c_master_transmit(dev_handle, payload, sizeof(payload), 200);
 }
 
-esp_err_t goodix_activate_mouse() {
+static esp_err_t goodix_activate_mouse(void) {
     uint8_t payload[] = {
         0x05, 0x00,
         0x33, 0x01,
@@ -52,34 +50,40 @@ esp_err_t goodix_activate_mouse() {
     return i2c_master_transmit(dev_handle, payload, sizeof(payload), 200);
 }
 
-typedef struct {
-    uint8_t tip_offset;
-    uint8_t id_offset;
-    uint8_t x_offset;
-    uint8_t y_offset;
-    uint8_t x_size;
-    uint8_t y_size;
-    uint8_t block_size;
-    bool nibble_packed;
-} finger_layout_t;
+#define GOODIX_HID_DESC_REG 0x0020
 
-void goodix_i2c_init(void) {
-    gpio_set_direction(RST_IO, GPIO_MODE_OUTPUT);
-    gpio_set_level(RST_IO, 0);
-    vTaskDelay(pdMS_TO_TICKS(50));
-    gpio_set_level(RST_IO, 1);
-    vTaskDelay(pdMS_TO_TICKS(150));
+#define GOODIX_LOGICAL_MAX_X 0x0D7F
+#define GOODIX_LOGICAL_MAX_Y 0x086F
+_Static_assert(TP_OUTPUT_FITS(GOODIX_LOGICAL_MAX_X) && TP_OUTPUT_FITS(GOODIX_LOGICAL_MAX_Y),
+               "CONFIG_TP_SUBPIXEL_BITS too large for the Goodix range");
 
-    i2c_master_bus_config_t bus_cfg = {
-        .clk_source = I2C_CLK_SRC_DEFAULT,
-        .i2c_port = I2C_NUM_0,
-        .scl_io_num = 6,
-        .sda_io_num = 7,
-        .glitch_ignore_cnt = 7,
-        .flags.enable_internal_pullup = true,
-    };
-    ESP_ERROR_CHECK(i2c_new_master_bus(&bus_cfg, &bus_handle));
+#define GOODIX_FINGER(i) {                                  \
+    .tip        = HID_FIELD(8 * (1 + 5 * (i)) + 1, 1),      \
+    .confidence = HID_FIELD(8 * (1 + 5 * (i)), 1),          \
+    .contact_id = HID_FIELD(8 * (1 + 5 * (i)) + 2, 6),      \
+    .x          = HID_FIELD(8 * (2 + 5 * (i)), 16),         \
+    .y          = HID_FIELD(8 * (4 + 5 * (i)), 16),         \
+}
 
+// Used when the report descriptor cannot be fetched.
+static const hid_tp_layout_t goodix_default_layout = {
+    .report_id = 0x04,
+    .finger_count = 5,
+    .report_len = 30,
+    .logical_max_x = GOODIX_LOGICAL_MAX_X,
+    .logical_max_y = GOODIX_LOGICAL_MAX_Y,
+    .finger_stride = 5,
+    .fingers = { GOODIX_FINGER(0), GOODIX_FINGER(1), GOODIX_FINGER(2), GOODIX_FINGER(3), GOODIX_FINGER(4) },
+    .scan_time = HID_FIELD(8 * 26, 16),
+    .contact_count = HID_FIELD(8 * 28, 8),
+    .button = HID_FIELD(8 * 29, 1),
+};
+
+static hid_tp_layout_t goodix_layout;
+static hid_decoder_plan_t goodix_plan;
+static bool goodix_layout_builtin = false;
+
+static void goodix_i2c_init(void) {
     i2c_device_config_t dev_cfg = {
         .dev_addr_length = I2C_ADDR_BIT_LEN_7,
         .device_address = I2C_ADDR,
@@ -89,221 +93,96 @@ void goodix_i2c_init(void) {
 
     uint8_t pwr_on[] = {0x05, 0x00, 0x08, 0x00};
     i2c_master_transmit(dev_handle, pwr_on, 4, 100);
-    vTaskDelay(pdMS_TO_TICKS(20));
-    vTaskDelay(pdMS_TO_TICKS(100));
+    i2c_hid_wait_ready(dev_handle, GOODIX_HID_DESC_REG, I2C_HID_POWER_ON_MS);
+
+    uint16_t input_len;
+    goodix_layout = goodix_default_layout;
+    i2c_hid_load_layout(dev_handle, GOODIX_HID_DESC_REG, &goodix_layout, &input_len);
+    goodix_layout_builtin = memcmp(&goodix_layout, &goodix_default_layout, sizeof(goodix_layout)) == 0;
+    hid_decoder_plan(&goodix_layout, &goodix_plan);
+    tp_driver_check_layout(&goodix_layout);
+    tp_capture_set_source(TP_CAPTURE_MODEL_GOODIX_GT7863, &goodix_layout);
 
     gpio_set_direction(INT_IO, GPIO_MODE_INPUT);
     gpio_set_pull_mode(INT_IO, GPIO_PULLUP_ONLY);
-}
-
-#define TAP_DEADZONE 30
-#define FILTER_ALPHA 0.5f
 
-bool global_watchdog_start = false;
-uint16_t global_scan_time = 0;
-
-typedef enum {
-    TOUCH_NONE = 0,
-    TOUCH_IDLE,
-    TOUCH_TAP_CANDIDATE,
-    TOUCH_DRAG
-} touch_state_t;
-
-static uint16_t get_median(uint16_t n1, uint16_t n2, uint16_t n3) {
-    if ((n1 > n2) ^ (n1 > n3)) return n1;
-    else if ((n2 > n1) ^ (n2 > n3)) return n2;
-    else return n3;
+    tp_reader_start(bus_handle, dev_handle, I2C_ADDR, input_len);
 }
 
-void goodix_i2c_task(void *arg) {
-    static uint16_t last_raw_x[5] = {0};
-    static uint16_t last_raw_y[5] = {0};
-    static uint16_t origin_x[5] = {0};
-    static uint16_t origin_y[5] = {0};
-    static bool tap_frozen[5] = {false};
-    static touch_state_t touch_state[5] = {0};
-    static uint32_t filtered_x[5] = {0};
-    static uint32_t filtered_y[5] = {0};
-    static uint8_t finger_life_status = 0;
-    
-    #define HISTORY_LEN 3
-    static uint16_t raw_x_history[5][HISTORY_LEN] = {0};
-    static uint16_t raw_y_history[5][HISTORY_LEN] = {0};
-    static int consecutive_errors[5] = {0}; 
-
-    uint8_t data[64];
-
-    while (1) {
-        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1));
-
-        tp_multi_msg_t tp_current_state = {0};
-        mouse_msg_t mouse_current_state = {0};
-        bool has_data = false;
-
-        int safety = 10;
-        while (gpio_get_level(INT_IO) == 0 && safety-- > 0) {
-            if (i2c_master_receive(dev_handle, data, sizeof(data), pdMS_TO_TICKS(5)) == ESP_OK) {
-                if (data[2] == 0x04) {
-                    has_data = true;
-                    current_mode = PTP_MODE;
-                    tp_current_state.scan_time = data[28] | (data[29] << 8);
-                    global_scan_time = tp_current_state.scan_time;
-                    tp_current_state.button_mask = (data[31] & 0x01) ? 0x01 : 0x00;
-                    tp_current_state.actual_count = data[30];
-                    finger_life_status = data[3];
-
-                    for (int id = 0; id < 5; id++) {
-                        uint8_t *f_ptr = &data[3 + (id * 5)];
-                        tp_current_state.fingers[id].confidence = (f_ptr[0] & 0x01);
-                        uint16_t rx = f_ptr[1] | (f_ptr[2] << 8);
-                        uint16_t ry = f_ptr[3] | (f_ptr[4] << 8);
-
-                        for (int h = 0; h < HISTORY_LEN - 1; h++) {
-                            raw_x_history[id][h] = raw_x_history[id][h+1];
-                            raw_y_history[id][h] = raw_y_history[id][h+1];
-                        }
-                        raw_x_history[id][HISTORY_LEN-1] = rx;
-                        raw_y_history[id][HISTORY_LEN-1] = ry;
+static tp_filter_t goodix_filter;
 
-                        if (raw_x_history[id][0] == 0) continue;
+static void goodix_i2c_task(void *arg) {
+    tp_raw_frame_t raw;
+    tp_multi_msg_t lift;
 
-                        uint16_t mx = get_median(raw_x_history[id][0], raw_x_history[id][1], raw_x_history[id][2]);
-                        uint16_t my = get_median(raw_y_history[id][0], raw_y_history[id][1], raw_y_history[id][2]);
+    tp_filter_init(&goodix_filter);
 
-                        int16_t predict_x = raw_x_history[id][HISTORY_LEN-1];
-                        int16_t predict_y = raw_y_history[id][HISTORY_LEN-1];
-                        int dx_sum = 0, dy_sum = 0, count_valid = 0;
-                        for (int h = 1; h < HISTORY_LEN; h++) {
-                            if (raw_x_history[id][h-1] && raw_x_history[id][h]) {
-                                dx_sum += raw_x_history[id][h] - raw_x_history[id][h-1];
-                                dy_sum += raw_y_history[id][h] - raw_y_history[id][h-1];
-                                count_valid++;
-                            }
-                        }
+    tp_reader_set_consumer(xTaskGetCurrentTaskHandle());
 
-                        if (count_valid > 0) {
-                            predict_x += dx_sum / count_valid;
-                            predict_y += dy_sum / count_valid;
-
-                            const int MAX_JUMP2_STRICT = 300 * 300;
-                            int dx_jump = mx - predict_x;
-                            int dy_jump = my - predict_y;
-
-                            if (dx_jump*dx_jump + dy_jump*dy_jump > MAX_JUMP2_STRICT) {
-                                if (consecutive_errors[id] < 2) { 
-                                    mx = last_raw_x[id] ? last_raw_x[id] : mx;
-                                    my = last_raw_y[id] ? last_raw_y[id] : my;
-                                    consecutive_errors[id]++;
-                                } else {
-                                    consecutive_errors[id] = 0;
-                                }
-                            } else {
-                                consecutive_errors[id] = 0;
-                            }
-                        }
-
-                        if (last_raw_x[id] == 0) {
-                            filtered_x[id] = mx << 8; filtered_y[id] = my << 8;
-                            origin_x[id] = mx; origin_y[id] = my;
-                        } else {
-                            int vx = rx - last_raw_x[id];
-                            int vy = ry - last_raw_y[id];
-                            int alpha_speed = abs(vx) + abs(vy);
-
-                            uint32_t dynamic_alpha;
-                            if (alpha_speed < 3) dynamic_alpha = 64;
-                            else if (alpha_speed < 12) dynamic_alpha = 115;
-                            else dynamic_alpha = 218;
-
-                            filtered_x[id] = (dynamic_alpha * (rx << 8) + 
-                                                (256 - dynamic_alpha) * filtered_x[id]) >> 8;
-                            filtered_y[id] = (dynamic_alpha * (ry << 8) + 
-                                                (256 - dynamic_alpha) * filtered_y[id]) >> 8;
-                        }
-
-                        uint16_t fx = (uint16_t)(filtered_x[id] >> 8);
-                        uint16_t fy = (uint16_t)(filtered_y[id] >> 8);
-
-                        int dx_raw = rx - last_raw_x[id];
-                        int dy_raw = ry - last_raw_y[id];
-                        if (abs(dx_raw) > abs(dy_raw) * 2 && abs(dy_raw) < 6) ry = last_raw_y[id];
-                        else if (abs(dy_raw) > abs(dx_raw) * 2 && abs(dx_raw) < 6) rx = last_raw_x[id];
-
-                        int dx = abs((int)rx - (int)origin_x[id]);
-                        int dy = abs((int)ry - (int)origin_y[id]);
-
-                        int active_deadzone = (tp_current_state.actual_count > 1) ? (TAP_DEADZONE / 2) : TAP_DEADZONE;
-
-
-                        if (dx > active_deadzone || dy > active_deadzone) {
-                            if (touch_state[id] == TOUCH_TAP_CANDIDATE) {
-                                touch_state[id] = TOUCH_DRAG;
-                            }
-                            tap_frozen[id] = false; 
-                        }
-
-                        if (tap_frozen[id]) {
-                            tp_current_state.fingers[id].x = origin_x[id];
-                            tp_current_state.fingers[id].y = origin_y[id];
-                        } else {
-                            tp_current_state.fingers[id].x = fx;
-                            tp_current_state.fingers[id].y = fy;
-                        }
-
-                        int sum_x = 0, sum_y = 0, count = 0;
-                        for (int i = 0; i < 5; i++) {
-                            if (tap_frozen[i]) {
-                                sum_x += origin_x[i];
-                                sum_y += origin_y[i];
-                                count++;
-                            }
-                        }
-
-                        if ((finger_life_status & 0x0F) == 0x03) {
-                            tp_current_state.fingers[id].tip_switch = 1;
-                            last_raw_x[id] = rx;
-                            last_raw_y[id] = ry;
-                        } else {
-                            tp_current_state.fingers[id].tip_switch = 0;
-                            last_raw_x[id] = 0;
-                            last_raw_y[id] = 0;
-                            origin_x[id] = 0;
-                            origin_y[id] = 0;
-                            touch_state[id] = TOUCH_NONE;
-                            tap_frozen[id] = false;
-                            for(int h=0; h<HISTORY_LEN; h++) {
-                                raw_x_history[id][h] = 0;
-                                raw_y_history[id][h] = 0;
-                            }
-                        }
-                        tp_current_state.fingers[id].contact_id = id;
-                    }
-                } else if (data[2] == 0x01) {
-                    current_mode = MOUSE_MODE;
-                    mouse_current_state.x = (int8_t)data[4];
-                    mouse_current_state.y = (int8_t)data[5];
-                    mouse_current_state.buttons = data[3];
-                    has_data = true;
-                }
+    while (1) {
+        // Woken by tp_reader per buffered frame. While contacts are down,
+        // also at the next deadline, to lift the ones no longer reported.
+        if (tp_reader_peek() == NULL) {
+            ulTaskNotifyTake(pdTRUE, tp_driver_expiry_wait(&goodix_filter.tracker));
+            if (tp_reader_peek() == NULL && tp_filter_expire(&goodix_filter, tp_capture_ticks(), &lift)) {
+                tp_pipe_send_touch(&lift);
             }
         }
-
-        if (has_data) {
-            // if (tp_current_state.actual_count == 0) {
-            //     return;
-            // }
-            if (current_mode == PTP_MODE) {
-                xQueueOverwrite(tp_queue, &tp_current_state);
-                if (tp_current_state.actual_count == 2 && finger_life_status == 0x01) {
-                    global_watchdog_start = true;
-                    watchdog_x = tp_current_state.fingers[0].x;
-                    watchdog_y = tp_current_state.fingers[0].y;
-                } else {
-                    global_watchdog_start = false;
-                }
-            } else if (current_mode == MOUSE_MODE) {
-                xQueueOverwrite(mouse_queue, &mouse_current_state);
+        tp_sched_woken(TP_TASK_DRIVER);
+
+        // One message per controller frame, with that frame's capture
+        // time; tp_pipe merges them if usbhid_task falls behind
+        const tp_reader_frame_t *frame;
+        for (; (frame = tp_reader_peek()) != NULL; tp_reader_release()) {
+            const uint8_t *data = frame->data;
+            size_t len = frame->len - 2;    // tp_reader drops reports of 2 bytes or less
+
+            bool is_tp = goodix_layout_builtin
+                ? hid_decoder_decode_inline(&goodix_default_layout, &data[2], len, &raw)
+                : hid_decoder_decode(&goodix_plan, &data[2], len, &raw);
+            // Routed by what the controller sent, which follows the mode
+            // tp_mode switched it to
+            if (is_tp) {
+                tp_multi_msg_t touch;
+
+                tp_mode_frame(PTP_MODE);
+                goodix_filter.smoothing = tp_smoothing;
+                tp_filter_process(&goodix_filter, &raw, frame->capture_ticks, &touch);
+                touch.trace = frame->trace;
+                touch.capture_ticks = frame->capture_ticks;
+                tp_latency_filter(&touch.trace);
+                tp_pipe_send_touch(&touch);
+            } else if (data[2] == 0x01 && len >= MOUSE_REPORT_LEN) {
+                mouse_msg_t mouse = {
+                    .buttons = data[3],
+                    .x = (int8_t)data[4],
+                    .y = (int8_t)data[5],
+                };
+
+                tp_mode_frame(MOUSE_MODE);
+                tp_pipe_send_mouse(&mouse);
             }
         }
     }
-}
\ No newline at end of file
+}
+
+const tp_driver_t goodix_gt7863_driver = {
+    .name = "Goodix GT7863",
+    .addr = I2C_ADDR,
+    .scl_io = SCL_IO,
+    .sda_io = SDA_IO,
+    .rst_io = RST_IO,
+    .int_io = INT_IO,
+    .controller_max_x = GOODIX_LOGICAL_MAX_X,
+    .controller_max_y = GOODIX_LOGICAL_MAX_Y,
+    .logical_max_x = TP_OUTPUT_MAX(GOODIX_LOGICAL_MAX_X),
+    .logical_max_y = TP_OUTPUT_MAX(GOODIX_LOGICAL_MAX_Y),
+    .physical_max_x = 0x01F0,
+    .physical_max_y = 0x0146,
+    .unit_exponent = 0x0E,
+    .unit = 0x13,
+    .init = goodix_i2c_init,
+    .activate_ptp = goodix_activate_ptp,
+    .activate_mouse = goodix_activate_mouse,
+    .task = goodix_i2c_task,
+};
@@ -0,0 +1,324 @@
+#include <string.h>
+
+#include "i2c/hid_decoder.h"
+
+#define USAGE(page, id) (((uint32_t)(page) << 16) | (id))
+
+#define USAGE_TOUCH_PAD     USAGE(0x0D, 0x05)
+#define USAGE_FINGER        USAGE(0x0D, 0x22)
+#define USAGE_TIP_SWITCH    USAGE(0x0D, 0x42)
+#define USAGE_CONFIDENCE    USAGE(0x0D, 0x47)
+#define USAGE_CONTACT_ID    USAGE(0x0D, 0x51)
+#define USAGE_CONTACT_COUNT USAGE(0x0D, 0x54)
+#define USAGE_SCAN_TIME     USAGE(0x0D, 0x56)
+#define USAGE_X             USAGE(0x01, 0x30)
+#define USAGE_Y             USAGE(0x01, 0x31)
+#define USAGE_BUTTON_1      USAGE(0x09, 0x01)
+
+#define MAX_LOCAL_USAGES 16
+#define MAX_GLOBAL_STACK 4
+
+typedef struct {
+    uint32_t usage_page;
+    int32_t logical_min;
+    int32_t logical_max;
+    uint32_t report_size;
+    uint32_t report_count;
+    uint8_t report_id;
+} hid_globals_t;
+
+static void set_field(hid_field_t *f, uint32_t bit_offset, uint32_t bits) {
+    f->byte = bit_offset / 8;
+    f->shift = bit_offset % 8;
+    f->mask = (bits >= 32) ? 0xFFFFFFFFu : ((1u << bits) - 1);
+    f->fill = 0;
+}
+
+static void assign_field(hid_tp_layout_t *out, uint32_t usage, int finger, uint32_t bit_offset,
+                         uint32_t bits, const hid_globals_t *g) {
+    if (bits == 0 || bits + (bit_offset % 8) > 32) return;
+
+    if (finger >= 0) {
+        if (finger >= TP_MAX_CONTACTS) return;
+        hid_finger_layout_t *fl = &out->fingers[finger];
+        uint16_t logical_max = (uint16_t)g->logical_max;
+
+        switch (usage) {
+        case USAGE_TIP_SWITCH: set_field(&fl->tip, bit_offset, bits); break;
+        case USAGE_CONFIDENCE: set_field(&fl->confidence, bit_offset, bits); break;
+        case USAGE_CONTACT_ID: set_field(&fl->contact_id, bit_offset, bits); break;
+        case USAGE_X:
+            set_field(&fl->x, bit_offset, bits);
+            if (logical_max > out->logical_max_x) out->logical_max_x = logical_max;
+            break;
+        case USAGE_Y:
+            set_field(&fl->y, bit_offset, bits);
+            if (logical_max > out->logical_max_y) out->logical_max_y = logical_max;
+            break;
+        default: break;
+        }
+        return;
+    }
+
+    switch (usage) {
+    case USAGE_SCAN_TIME:     set_field(&out->scan_time, bit_offset, bits); break;
+    case USAGE_CONTACT_COUNT: set_field(&out->contact_count, bit_offset, bits); break;
+    case USAGE_BUTTON_1:
+        if (out->button.mask == 0) set_field(&out->button, bit_offset, bits);
+        break;
+    default: break;
+    }
+}
+
+bool hid_decoder_parse(const uint8_t *desc, size_t len, hid_tp_layout_t *layout) {
+    hid_tp_layout_t out;
+    memset(&out, 0, sizeof(out));
+
+    hid_globals_t g = {0};
+    hid_globals_t g_stack[MAX_GLOBAL_STACK];
+    int g_sp = 0;
+
+    uint32_t usages[MAX_LOCAL_USAGES];
+    int n_usages = 0;
+    uint32_t usage_min = 0, usage_max = 0;
+    bool have_range = false;
+
+    int depth = 0;
+    int tp_depth = -1;
+    int finger_depth = -1;
+    int finger_idx = -1;
+    int target_id = -1;
+    uint32_t bit_offset = 0;
+
+    size_t i = 0;
+    while (i < len) {
+        uint8_t prefix = desc[i++];
+
+        if (prefix == 0xFE) {
+            if (i + 1 >= len) break;
+            i += 2 + desc[i];
+            continue;
+        }
+
+        uint8_t size = prefix & 0x03;
+        if (size == 3) size = 4;
+        if (i + size > len) break;
+
+        uint32_t uval = 0;
+        for (uint8_t k = 0; k < size; k++) uval |= (uint32_t)desc[i + k] << (8 * k);
+        int32_t sval = (int32_t)uval;
+        if (size == 1) sval = (int8_t)uval;
+        else if (size == 2) sval = (int16_t)uval;
+        i += size;
+
+        uint8_t type = (prefix >> 2) & 0x03;
+        uint8_t tag = prefix >> 4;
+
+        if (type == 0) {
+            uint32_t first_usage = have_range ? usage_min : (n_usages ? usages[0] : 0);
+
+            if (tag == 0x0A) {
+                depth++;
+                if (first_usage == USAGE_TOUCH_PAD && tp_depth < 0 && target_id < 0) {
+                    tp_depth = depth;
+                } else if (tp_depth >= 0 && finger_depth < 0 &&
+                           (first_usage == USAGE_FINGER || (uval == 0x02 && depth == tp_depth + 1))) {
+                    // Many descriptors reuse Usage 0x22 after switching the
+                    // page to Generic Desktop, so any logical collection
+                    // directly under the touch pad counts as a finger.
+                    finger_depth = depth;
+                    finger_idx++;
+                }
+            } else if (tag == 0x0C) {
+                if (depth == finger_depth) finger_depth = -1;
+                if (depth == tp_depth) tp_depth = -1;
+                if (depth > 0) depth--;
+            } else if (tag == 0x08 && tp_depth >= 0) {
+                if (target_id < 0) {
+                    target_id = g.report_id;
+                    bit_offset = g.report_id ? 8 : 0;
+                }
+                if (g.report_id == target_id) {
+                    bool constant = uval & 0x01;
+                    for (uint32_t n = 0; n < g.report_count; n++) {
+                        uint32_t usage = 0;
+                        if (have_range) {
+                            usage = usage_min + n;
+                            if (usage > usage_max) usage = usage_max;
+                        } else if (n_usages) {
+                            usage = usages[n < (uint32_t)n_usages ? n : (uint32_t)n_usages - 1];
+                        }
+                        if (!constant) {
+                            assign_field(&out, usage, finger_depth >= 0 ? finger_idx : -1,
+                                         bit_offset, g.report_size, &g);
+                        }
+                        bit_offset += g.report_size;
+                    }
+                }
+            }
+
+            n_usages = 0;
+            have_range = false;
+        } else if (type == 1) {
+            switch (tag) {
+            case 0x0: g.usage_page = uval; break;
+            case 0x1: g.logical_min = sval; break;
+            case 0x2: g.logical_max = (g.logical_min >= 0) ? (int32_t)uval : sval; break;
+            case 0x7: g.report_size = uval; break;
+            case 0x8: g.report_id = (uint8_t)uval; break;
+            case 0x9: g.report_count = uval; break;
+            case 0xA: if (g_sp < MAX_GLOBAL_STACK) g_stack[g_sp++] = g; break;
+            case 0xB: if (g_sp > 0) g = g_stack[--g_sp]; break;
+            default: break;
+            }
+        } else if (type == 2) {
+            uint32_t usage = (size == 4) ? uval : ((g.usage_page << 16) | uval);
+            switch (tag) {
+            case 0x0:
+                if (n_usages < MAX_LOCAL_USAGES) usages[n_usages++] = usage;
+                break;
+            case 0x1: usage_min = usage; have_range = true; break;
+            case 0x2: usage_max = usage; break;
+            default: break;
+            }
+        }
+    }
+
+    if (target_id < 0 || finger_idx < 0) return false;
+    if (out.fingers[0].x.mask == 0 || out.fingers[0].y.mask == 0) return false;
+
+    out.report_id = (uint8_t)target_id;
+    out.finger_count = (finger_idx + 1 > TP_MAX_CONTACTS) ? TP_MAX_CONTACTS : finger_idx + 1;
+    out.report_len = (bit_offset + 7) / 8;
+
+    for (int f = 0; f < out.finger_count; f++) {
+        if (out.fingers[f].confidence.mask == 0) out.fingers[f].confidence.fill = 1;
+    }
+    hid_decoder_compile(&out);
+
+    *layout = out;
+    return true;
+}
+
+static bool field_is_shifted(const hid_field_t *a, const hid_field_t *b, int delta) {
+    return b->byte == a->byte + delta && b->shift == a->shift && b->mask == a->mask && b->fill == a->fill;
+}
+
+void hid_decoder_compile(hid_tp_layout_t *layout) {
+    layout->finger_stride = 0;
+    if (layout->finger_count < 2) return;
+
+    const hid_finger_layout_t *f0 = &layout->fingers[0];
+    int stride = layout->fingers[1].x.byte - f0->x.byte;
+    if (stride <= 0) return;
+
+    for (int f = 1; f < layout->finger_count; f++) {
+        const hid_finger_layout_t *fl = &layout->fingers[f];
+        int delta = stride * f;
+        if (!field_is_shifted(&f0->tip, &fl->tip, delta) ||
+            !field_is_shifted(&f0->confidence, &fl->confidence, delta) ||
+            !field_is_shifted(&f0->x, &fl->x, delta) ||
+            !field_is_shifted(&f0->y, &fl->y, delta)) {
+            return;
+        }
+    }
+    layout->finger_stride = (uint16_t)stride;
+}
+
+static bool field_at(const hid_field_t *f, uint32_t byte, uint8_t shift) {
+    return f->byte == byte && f->shift == shift && f->fill == 0;
+}
+
+static bool field_is_word(const hid_field_t *f, uint32_t byte) {
+    return field_at(f, byte, 0) && f->mask != 0 && f->mask <= 0xFFFF;
+}
+
+void hid_decoder_plan(const hid_tp_layout_t *layout, hid_decoder_plan_t *plan) {
+    memset(plan, 0, sizeof(*plan));
+    plan->layout = layout;
+
+    const hid_finger_layout_t *f0 = &layout->fingers[0];
+    uint32_t block = f0->tip.byte;
+    uint32_t stride = layout->finger_count > 1 ? layout->finger_stride : 0;
+    if (layout->finger_count > 1 && stride == 0) return;
+    if (block + stride * (layout->finger_count - 1) > 255 || stride > 255) return;
+
+    // Finger 0 decides; hid_decoder_compile found the others at the stride
+    bool conf_absent = f0->confidence.mask == 0 && f0->confidence.fill == 1;
+    if (!field_at(&f0->tip, block, HID_BLOCK_TIP_BIT) || f0->tip.mask != 1) return;
+    if (!conf_absent && (!field_at(&f0->confidence, block, HID_BLOCK_CONF_BIT) || f0->confidence.mask != 1)) return;
+    if (!field_is_word(&f0->x, block + HID_BLOCK_X) || !field_is_word(&f0->y, block + HID_BLOCK_Y)) return;
+
+    const hid_field_t *scan = &layout->scan_time, *cc = &layout->contact_count, *button = &layout->button;
+    if (!field_at(scan, scan->byte, 0) || scan->mask != 0xFFFF || scan->byte > 254) return;
+    if (!field_at(cc, cc->byte, 0) || cc->mask != 0xFF || cc->byte > 255) return;
+    if (!field_at(button, button->byte, 0) || button->mask != 1 || button->byte > 255) return;
+
+    plan->block = (uint8_t)block;
+    plan->stride = (uint8_t)stride;
+    plan->conf_mask = conf_absent ? 0 : 1;
+    plan->x_mask = (uint16_t)f0->x.mask;
+    plan->y_mask = (uint16_t)f0->y.mask;
+    plan->scan_time_byte = (uint8_t)scan->byte;
+    plan->contact_count_byte = (uint8_t)cc->byte;
+    plan->button_byte = (uint8_t)button->byte;
+    plan->fixed = true;
+}
+
+static inline uint16_t load16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline void decode_block(const uint8_t *restrict block, uint8_t conf_mask, uint16_t x_mask, uint16_t y_mask,
+                                tp_raw_contact_t *restrict c) {
+    c->tip_switch = (block[0] >> HID_BLOCK_TIP_BIT) & 1;
+    c->confidence = ((block[0] >> HID_BLOCK_CONF_BIT) & conf_mask) | (conf_mask ^ 1);
+    c->x = load16(&block[HID_BLOCK_X]) & x_mask;
+    c->y = load16(&block[HID_BLOCK_Y]) & y_mask;
+}
+
+// Out of line so the planned decode stays a leaf with few registers live
+__attribute__((noinline)) static bool decode_table(const hid_tp_layout_t *layout, const uint8_t *report, size_t len,
+                                                   tp_raw_frame_t *raw) {
+    return hid_decoder_decode_inline(layout, report, len, raw);
+}
+
+bool hid_decoder_decode(const hid_decoder_plan_t *restrict plan, const uint8_t *restrict report, size_t len,
+                        tp_raw_frame_t *restrict raw) {
+    const hid_tp_layout_t *layout = plan->layout;
+    if (!plan->fixed) return decode_table(layout, report, len, raw);
+
+    if (len < layout->report_len) return false;
+    if (layout->report_id && report[0] != layout->report_id) return false;
+
+    // Everything needed from the plan and layout, read before the first
+    // store: uint8_t stores into raw may alias them otherwise.
+    uint8_t count = layout->finger_count;
+    uint8_t stride = plan->stride;
+    uint8_t conf_mask = plan->conf_mask;
+    uint16_t x_mask = plan->x_mask, y_mask = plan->y_mask;
+    const uint8_t *block = report + plan->block;
+    uint16_t scan_time = load16(&report[plan->scan_time_byte]);
+    uint8_t contact_count = report[plan->contact_count_byte];
+    uint8_t button_mask = report[plan->button_byte] & 1;
+    uint32_t slot = count == 1 ? hid_field_get(&layout->fingers[0].contact_id, report) : 0;
+
+    memset(raw, 0, sizeof(*raw));
+    raw->scan_time = scan_time;
+    raw->contact_count = contact_count;
+    raw->button_mask = button_mask;
+
+    if (count == 1) {
+        if (slot < TP_MAX_CONTACTS) {
+            decode_block(block, conf_mask, x_mask, y_mask, &raw->contacts[slot]);
+            raw->slot_mask = 1u << slot;
+        }
+        return true;
+    }
+
+    for (uint8_t f = 0; f < count; f++, block += stride) {
+        decode_block(block, conf_mask, x_mask, y_mask, &raw->contacts[f]);
+    }
+    raw->slot_mask = (uint8_t)((1u << count) - 1);
+    return true;
+}
@@ -0,0 +1,167 @@
+#ifndef HID_DECODER_H
+#define HID_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "i2c/tp_frame.h"
+
+// A report field compiled to a single unaligned 32-bit load:
+//   value = ((load32(report + byte) >> shift) & mask) | fill
+// Offsets count from the report ID byte. Absent fields have mask 0 and
+// decode to their fill value.
+typedef struct {
+    uint16_t byte;
+    uint8_t shift;
+    uint32_t mask;
+    uint32_t fill;
+} hid_field_t;
+
+#define HID_FIELD(bit_offset, bits) \
+    { .byte = (bit_offset) / 8, .shift = (bit_offset) % 8, .mask = (uint32_t)((1ull << (bits)) - 1), .fill = 0 }
+#define HID_FIELD_CONST(value) \
+    { .byte = 0, .shift = 0, .mask = 0, .fill = (value) }
+
+typedef struct {
+    hid_field_t tip;
+    hid_field_t confidence;
+    hid_field_t contact_id;
+    hid_field_t x;
+    hid_field_t y;
+} hid_finger_layout_t;
+
+typedef struct {
+    uint8_t report_id;
+    uint8_t finger_count;       // finger collections per report (1 = one contact per report)
+    uint16_t report_len;        // bytes including the report ID
+    uint16_t logical_max_x;
+    uint16_t logical_max_y;
+    uint16_t finger_stride;     // bytes between finger blocks when they are evenly spaced, else 0
+    hid_finger_layout_t fingers[TP_MAX_CONTACTS];
+    hid_field_t scan_time;
+    hid_field_t contact_count;
+    hid_field_t button;
+} hid_tp_layout_t;
+
+// Build a layout from a HID report descriptor. Returns false when no
+// touch pad input report with X/Y could be found; *layout is untouched then.
+bool hid_decoder_parse(const uint8_t *desc, size_t len, hid_tp_layout_t *layout);
+
+// Precompute the fast-path data (finger stride) of a layout. Called by
+// hid_decoder_parse; built-in layouts fill .finger_stride themselves.
+void hid_decoder_compile(hid_tp_layout_t *layout);
+
+// A layout compiled for decoding at run time. Finger blocks shaped like
+// the PTP sample descriptor (which ELAN and Goodix follow): confidence in
+// bit 0 and tip switch in bit 1 of the first byte, then 16-bit X and Y.
+// Those offsets are constants of the decoder, so only the first block, the
+// stride and the X/Y masks come from the plan. Scan time (16 bits),
+// contact count (8 bits) and the button bit must be byte aligned too.
+// Other layouts decode through the layout's hid_field_t table.
+//
+// The plan is there for generality, so a controller whose descriptor does
+// not match a built-in table still decodes without walking fields. It is
+// not faster than the hand-written or built-in decode; drivers keep the
+// built-in table whenever the descriptor matches it.
+#define HID_BLOCK_CONF_BIT  0
+#define HID_BLOCK_TIP_BIT   1
+#define HID_BLOCK_X         1
+#define HID_BLOCK_Y         3
+
+typedef struct {
+    const hid_tp_layout_t *layout;  // must outlive the plan
+    bool fixed;                     // finger blocks have the shape above
+    uint8_t block;                  // byte of finger 0's block
+    uint8_t stride;                 // bytes between blocks
+    uint8_t conf_mask;              // 0 when there is no confidence bit
+    uint16_t x_mask;
+    uint16_t y_mask;
+    uint8_t scan_time_byte;
+    uint8_t contact_count_byte;
+    uint8_t button_byte;
+} hid_decoder_plan_t;
+
+// Compiles after hid_decoder_parse (or on a built-in layout); never fails,
+// a layout of another shape just gets fixed = false.
+void hid_decoder_plan(const hid_tp_layout_t *layout, hid_decoder_plan_t *plan);
+
+// Decode one input report (starting at the report ID byte). Contacts land
+// in tp_raw_frame_t slots by finger index, or by contact ID when the
+// controller sends a single finger per report. len is the report's length
+// as received; the buffer must stay readable HID_DECODER_SLACK bytes past
+// it. Returns false if the report is not the touch pad report or is
+// shorter than the layout's report_len.
+bool hid_decoder_decode(const hid_decoder_plan_t *restrict plan, const uint8_t *restrict report, size_t len,
+                        tp_raw_frame_t *restrict raw);
+
+// Bytes a decode may read past the end of the report (one 32-bit load at
+// the last field); report buffers are sized with it.
+#define HID_DECODER_SLACK 3
+
+static inline uint32_t hid_field_get(const hid_field_t *f, const uint8_t *report) {
+    uint32_t w;
+    memcpy(&w, report + f->byte, sizeof(w));
+    return ((w >> f->shift) & f->mask) | f->fill;
+}
+
+// Decodes straight from the layout's hid_field_t table. Called with a
+// model's static const layout the compiler folds every offset, shift and
+// mask into the code, which is as fast as a hand-written decode; drivers
+// use it when the controller's descriptor matches their built-in table.
+// hid_decoder_decode falls back to it for layouts the plan cannot take.
+static inline bool hid_decoder_decode_inline(const hid_tp_layout_t *restrict layout, const uint8_t *restrict report,
+                                             size_t len, tp_raw_frame_t *restrict raw) {
+    if (len < layout->report_len) return false;
+    if (layout->report_id && report[0] != layout->report_id) return false;
+
+    // restrict: the uint8_t stores below must not force the layout or the
+    // report to be reloaded after every field.
+    tp_raw_frame_t *restrict out = raw;
+    memset(out, 0, sizeof(*out));
+
+    out->scan_time = (uint16_t)hid_field_get(&layout->scan_time, report);
+    out->contact_count = (uint8_t)hid_field_get(&layout->contact_count, report);
+    out->button_mask = (uint8_t)hid_field_get(&layout->button, report);
+
+    if (layout->finger_count == 1) {
+        const hid_finger_layout_t *fl = &layout->fingers[0];
+        uint32_t slot = hid_field_get(&fl->contact_id, report);
+        if (slot < TP_MAX_CONTACTS) {
+            out->contacts[slot].tip_switch = (uint8_t)hid_field_get(&fl->tip, report);
+            out->contacts[slot].confidence = (uint8_t)hid_field_get(&fl->confidence, report);
+            out->contacts[slot].x = (uint16_t)hid_field_get(&fl->x, report);
+            out->contacts[slot].y = (uint16_t)hid_field_get(&fl->y, report);
+            out->slot_mask = 1u << slot;
+        }
+    } else if (layout->finger_stride) {
+        // Evenly spaced finger blocks: keep finger 0's shifts and masks in
+        // registers and walk the report by stride.
+        const hid_finger_layout_t *fl = &layout->fingers[0];
+        const hid_field_t tip = fl->tip, conf = fl->confidence, x = fl->x, y = fl->y;
+        const uint8_t *block = report;
+        uint8_t count = layout->finger_count;
+        uint16_t stride = layout->finger_stride;
+
+        for (uint8_t f = 0; f < count; f++, block += stride) {
+            out->contacts[f].tip_switch = (uint8_t)hid_field_get(&tip, block);
+            out->contacts[f].confidence = (uint8_t)hid_field_get(&conf, block);
+            out->contacts[f].x = (uint16_t)hid_field_get(&x, block);
+            out->contacts[f].y = (uint16_t)hid_field_get(&y, block);
+        }
+        out->slot_mask = (uint8_t)((1u << count) - 1);
+    } else {
+        uint8_t count = layout->finger_count;
+        for (uint8_t f = 0; f < count; f++) {
+            const hid_finger_layout_t *fl = &layout->fingers[f];
+            out->contacts[f].tip_switch = (uint8_t)hid_field_get(&fl->tip, report);
+            out->contacts[f].confidence = (uint8_t)hid_field_get(&fl->confidence, report);
+            out->contacts[f].x = (uint16_t)hid_field_get(&fl->x, report);
+            out->contacts[f].y = (uint16_t)hid_field_get(&fl->y, report);
+        }
+        out->slot_mask = (uint8_t)((1u << count) - 1);
+    }
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,82 @@
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/i2c_master.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "i2c/i2c_hid.h"
+
+static const char *TAG = "I2C_HID";
+
+#define I2C_HID_MAX_REPORT_DESC_LEN 1024
+
+esp_err_t i2c_hid_read_desc(i2c_master_dev_handle_t dev, uint16_t desc_reg, i2c_hid_desc_t *desc) {
+    uint8_t raw[I2C_HID_DESC_LEN] = {0};
+    uint8_t req[2] = { desc_reg & 0xFF, desc_reg >> 8 };
+
+    esp_err_t ret = i2c_master_transmit_receive(dev, req, sizeof(req), raw, sizeof(raw), pdMS_TO_TICKS(200));
+    if (ret != ESP_OK) return ret;
+    if ((raw[0] | (raw[1] << 8)) != I2C_HID_DESC_LEN) return ESP_ERR_INVALID_RESPONSE;
+
+    desc->report_desc_len = raw[4] | (raw[5] << 8);
+    desc->report_desc_reg = raw[6] | (raw[7] << 8);
+    desc->input_reg       = raw[8] | (raw[9] << 8);
+    desc->max_input_len   = raw[10] | (raw[11] << 8);
+    desc->command_reg     = raw[16] | (raw[17] << 8);
+    desc->data_reg        = raw[18] | (raw[19] << 8);
+    desc->vendor_id       = raw[20] | (raw[21] << 8);
+    desc->product_id      = raw[22] | (raw[23] << 8);
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_hid_wait_ready(i2c_master_dev_handle_t dev, uint16_t desc_reg, uint32_t timeout_ms) {
+    i2c_hid_desc_t desc;
+    int64_t deadline = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    esp_err_t ret;
+
+    while ((ret = i2c_hid_read_desc(dev, desc_reg, &desc)) != ESP_OK) {
+        if (esp_timer_get_time() > deadline) return ret;
+        vTaskDelay(1);
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2c_hid_load_layout(i2c_master_dev_handle_t dev, uint16_t desc_reg, hid_tp_layout_t *layout,
+                              uint16_t *max_input_len) {
+    i2c_hid_desc_t desc;
+    *max_input_len = 0;
+    esp_err_t ret = i2c_hid_read_desc(dev, desc_reg, &desc);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "HID descriptor read failed (%s)", esp_err_to_name(ret));
+        return ret;
+    }
+    *max_input_len = desc.max_input_len;
+
+    if (desc.report_desc_len == 0 || desc.report_desc_len > I2C_HID_MAX_REPORT_DESC_LEN) {
+        ESP_LOGW(TAG, "Invalid report descriptor length %u", desc.report_desc_len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint8_t *report_desc = malloc(desc.report_desc_len);
+    if (!report_desc) return ESP_ERR_NO_MEM;
+
+    uint8_t reg[2] = { desc.report_desc_reg & 0xFF, desc.report_desc_reg >> 8 };
+    ret = i2c_master_transmit_receive(dev, reg, sizeof(reg), report_desc, desc.report_desc_len, pdMS_TO_TICKS(500));
+    if (ret == ESP_OK && !hid_decoder_parse(report_desc, desc.report_desc_len, layout)) {
+        ret = ESP_ERR_NOT_FOUND;
+    }
+    free(report_desc);
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Report descriptor unusable (%s), keeping built-in layout", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "VID:%04X PID:%04X report 0x%02X, %d finger(s)/report, %u bytes (input max %u), X max %u, Y max %u",
+             desc.vendor_id, desc.product_id, layout->report_id, layout->finger_count,
+             layout->report_len, desc.max_input_len, layout->logical_max_x, layout->logical_max_y);
+    return ESP_OK;
+}
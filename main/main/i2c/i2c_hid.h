@@ -0,0 +1,36 @@
+#ifndef I2C_HID_H
+#define I2C_HID_H
+
+#include "driver/i2c_master.h"
+#include "i2c/hid_decoder.h"
+
+#define I2C_HID_DESC_LEN 30
+#define I2C_HID_POWER_ON_MS 120     // longest a device takes to answer after SET_POWER ON
+
+// Fields of the HID-over-I2C HID descriptor we care about.
+typedef struct {
+    uint16_t report_desc_len;
+    uint16_t report_desc_reg;
+    uint16_t input_reg;
+    uint16_t max_input_len;
+    uint16_t command_reg;
+    uint16_t data_reg;
+    uint16_t vendor_id;
+    uint16_t product_id;
+} i2c_hid_desc_t;
+
+// Fails with ESP_ERR_INVALID_RESPONSE while the device is still booting
+// (the descriptor's own length field is wrong).
+esp_err_t i2c_hid_read_desc(i2c_master_dev_handle_t dev, uint16_t desc_reg, i2c_hid_desc_t *desc);
+
+// Polls the HID descriptor until it reads back valid, for at most
+// timeout_ms. Used after power-on instead of a fixed delay.
+esp_err_t i2c_hid_wait_ready(i2c_master_dev_handle_t dev, uint16_t desc_reg, uint32_t timeout_ms);
+
+// Fetch the report descriptor and compile it into *layout. On failure the
+// caller's layout (normally the model's built-in default) is left as is.
+// *max_input_len is the descriptor's wMaxInputLength, 0 when unknown.
+esp_err_t i2c_hid_load_layout(i2c_master_dev_handle_t dev, uint16_t desc_reg, hid_tp_layout_t *layout,
+                              uint16_t *max_input_len);
+
+#endif
@@ -2,22 +2,30 @@
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "driver/gpio.h"
-#include "esp_timer.h"
 #include "esp_log.h"
 #include "driver/i2c_master.h"
-#include "i2c/goodix/goodix_i2c.h"
 
 #include "i2c/I2C_HID_Report.h"
+#include "i2c/tp_driver.h"
+#include "trace/tp_latency.h"
+#include "trace/tp_sched.h"
 
 #define TAG "TP_INT"
 
 extern i2c_master_dev_handle_t dev_handle;
 extern TaskHandle_t tp_read_task_handle;
 
+// arg is the INT GPIO number, so the ISR does not touch the driver table
+// in flash. The interrupt is on the low level and stays masked until the
+// reader task has drained INT and arms it again.
 static void IRAM_ATTR tp_gpio_isr_handler(void* arg) {
-    uint8_t level = gpio_get_level(TP_INT_GPIO);
+    int int_gpio = (int)(intptr_t)arg;
+    gpio_intr_disable(int_gpio);
+
+    uint8_t level = gpio_get_level(int_gpio);
     if (level == 0) {
-        esp_timer_stop(timeout_watchdog_timer);
+        tp_latency_isr();
+        tp_sched_signal(TP_TASK_READER);
         BaseType_t xHigherPriorityTaskWoken = pdFALSE;
         if (tp_read_task_handle != NULL) {
             vTaskNotifyGiveFromISR(tp_read_task_handle, &xHigherPriorityTaskWoken);
@@ -25,28 +33,21 @@ static void IRAM_ATTR tp_gpio_isr_handler(void* arg) {
         if (xHigherPriorityTaskWoken) {
             portYIELD_FROM_ISR();
         }
-    } else {
-        esp_timer_start_once(timeout_watchdog_timer, WATCHDOG_TIMEOUT_US);
     }
 }
 
 void i2c_tp_int_init(void) {
-
-    const esp_timer_create_args_t timer_args = {
-        .callback = &watchdog_timeout_callback,
-        .name = "touch_timeout_timer"
-    };
-    esp_timer_create(&timer_args, &timeout_watchdog_timer);
+    int int_gpio = tp_driver->int_io;
 
     gpio_config_t io_conf = {
-        .intr_type = GPIO_INTR_ANYEDGE,
+        .intr_type = GPIO_INTR_LOW_LEVEL,
         .mode = GPIO_MODE_INPUT,
-        .pin_bit_mask = (1ULL << TP_INT_GPIO),
+        .pin_bit_mask = (1ULL << int_gpio),
         .pull_up_en = GPIO_PULLUP_DISABLE,
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
     };
     gpio_config(&io_conf);
 
     gpio_install_isr_service(0); 
-    gpio_isr_handler_add(TP_INT_GPIO, tp_gpio_isr_handler, NULL);
+    gpio_isr_handler_add(int_gpio, tp_gpio_isr_handler, (void *)(intptr_t)int_gpio);
 }
\ No newline at end of file
@@ -0,0 +1,73 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+
+// Lock-free single-producer / single-consumer ring of fixed-size elements.
+// The producer only writes head, the consumer only writes tail, so no
+// critical section is needed. Capacity must be a power of two.
+
+typedef struct {
+    uint8_t *slots;
+    uint16_t elem_size;
+    uint16_t mask;
+    atomic_uint head;           // next slot the producer fills
+    atomic_uint tail;           // next slot the consumer reads
+} spsc_ring_t;
+
+static inline void spsc_ring_init(spsc_ring_t *r, void *storage, uint16_t elem_size, uint16_t capacity) {
+    r->slots = storage;
+    r->elem_size = elem_size;
+    r->mask = capacity - 1;
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+}
+
+static inline unsigned spsc_ring_count(spsc_ring_t *r) {
+    return atomic_load_explicit(&r->head, memory_order_acquire) -
+           atomic_load_explicit(&r->tail, memory_order_acquire);
+}
+
+// Producer side. Returns false (and copies nothing) when the ring is full.
+static inline bool spsc_ring_push(spsc_ring_t *r, const void *elem) {
+    unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    if (head - tail > r->mask) return false;
+
+    memcpy(r->slots + (head & r->mask) * r->elem_size, elem, r->elem_size);
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return true;
+}
+
+// Producer side, in place: the free slot to fill, or NULL when full. The
+// slot becomes visible to the consumer on spsc_ring_commit().
+static inline void *spsc_ring_peek_free(spsc_ring_t *r) {
+    unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    if (head - tail > r->mask) return NULL;
+    return r->slots + (head & r->mask) * r->elem_size;
+}
+
+static inline void spsc_ring_commit(spsc_ring_t *r) {
+    unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+
+// Consumer side: the n-th queued element in place, or NULL. Stays valid
+// until it is popped.
+static inline void *spsc_ring_peek(spsc_ring_t *r, unsigned n) {
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&r->head, memory_order_acquire);
+    if (head - tail <= n) return NULL;
+    return r->slots + ((tail + n) & r->mask) * r->elem_size;
+}
+
+static inline void spsc_ring_pop(spsc_ring_t *r) {
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+}
+
+#endif
@@ -0,0 +1,83 @@
+#include <string.h>
+
+#include "i2c/tp_assembler.h"
+
+void tp_assembler_init(tp_assembler_t *as) {
+    memset(as, 0, sizeof(*as));
+}
+
+bool tp_assembler_begin(tp_assembler_t *as, uint16_t scan_time, uint16_t capture_ticks,
+                        const tp_trace_t *trace, tp_multi_msg_t *out) {
+    bool closed = false;
+
+    if (as->open && scan_time != as->frame.scan_time) {
+        closed = tp_assembler_flush(as, out);
+    }
+
+    if (!as->open) {
+        memset(&as->frame, 0, sizeof(as->frame));
+        as->frame.scan_time = scan_time;
+        as->frame.capture_ticks = capture_ticks;
+        as->frame.trace = *trace;
+        as->seen_mask = 0;
+        as->received = 0;
+        as->expected = 0;
+        as->open = true;
+    }
+    return closed;
+}
+
+bool tp_assembler_add(tp_assembler_t *as, const tp_raw_frame_t *raw, const tp_finger_t *finger,
+                      tp_multi_msg_t *out) {
+    as->frame.button_mask = raw->button_mask ? 0x01 : 0x00;
+    if (raw->contact_count > as->expected) as->expected = raw->contact_count;
+    as->received++;
+
+    if (finger) {
+        uint8_t id = finger->contact_id;
+        uint8_t bit = 1u << id;
+
+        as->last[id] = *finger;
+        as->seen_mask |= bit;
+        if (finger->tip_switch) as->down_mask |= bit;
+        else as->down_mask &= ~bit;
+    }
+
+    if (as->expected == 0 || as->received < as->expected) return false;
+    return tp_assembler_flush(as, out);
+}
+
+bool tp_assembler_flush(tp_assembler_t *as, tp_multi_msg_t *out) {
+    if (!as->open) return false;
+
+    *out = as->frame;
+
+    // Only the contacts sent, packed; contact_id keeps the track
+    uint8_t mask = as->down_mask | as->seen_mask;
+    uint8_t n = 0;
+    for (int i = 0; i < TP_MAX_CONTACTS; i++) {
+        if (mask & (1u << i)) out->fingers[n++] = as->last[i];
+    }
+    out->actual_count = n;
+
+    as->open = false;
+    return true;
+}
+
+bool tp_assembler_lift(tp_assembler_t *as, uint8_t ids, uint16_t scan_time, uint16_t capture_ticks,
+                       tp_multi_msg_t *out) {
+    ids &= as->down_mask;
+    if (ids == 0) return false;
+
+    memset(&as->frame, 0, sizeof(as->frame));
+    as->frame.scan_time = scan_time;
+    as->frame.capture_ticks = capture_ticks;
+
+    for (int i = 0; i < TP_MAX_CONTACTS; i++) {
+        if (ids & (1u << i)) as->last[i].tip_switch = 0;
+    }
+    as->down_mask &= ~ids;
+    as->seen_mask = ids;
+    as->open = true;
+    return tp_assembler_flush(as, out);
+}
@@ -0,0 +1,56 @@
+#ifndef TP_ASSEMBLER_H
+#define TP_ASSEMBLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c/tp_frame.h"
+
+// Builds whole frames for a controller that sends one contact per input
+// report (hybrid mode, ELAN). All reports of a scan share its scan time;
+// the first one carries the number of contacts in the scan, the rest 0.
+//
+// A scan is sent once its announced contacts have arrived. A report with a
+// newer scan time, or TP_ASSEMBLER_TIMEOUT_MS without any report, sends an
+// incomplete scan as it is. Contacts that are down but missing from a scan
+// keep their last known state; a lifted contact is sent once with tip up.
+
+#define TP_ASSEMBLER_TIMEOUT_MS 8
+
+typedef struct {
+    tp_multi_msg_t frame;               // scan being assembled (meta only)
+    tp_finger_t last[TP_MAX_CONTACTS];  // last known state per slot
+    uint8_t down_mask;                  // slots whose last state is tip down
+    uint8_t seen_mask;                  // slots reported in the open scan
+    uint8_t received;                   // reports in the open scan
+    uint8_t expected;                   // contacts announced for the open scan
+    bool open;
+} tp_assembler_t;
+
+void tp_assembler_init(tp_assembler_t *as);
+
+// Starts or continues the scan of the next report. Returns true with the
+// previous scan in *out when this report belongs to a newer one.
+bool tp_assembler_begin(tp_assembler_t *as, uint16_t scan_time, uint16_t capture_ticks,
+                        const tp_trace_t *trace, tp_multi_msg_t *out);
+
+// Adds a decoded report to the open scan. finger is the (filtered) state of
+// the report's contact, contact_id its track; NULL when the
+// report carries none or the filter holds it back. Either way the report
+// counts towards the scan's announced contacts. Returns true with the frame in *out when the scan
+// is complete.
+bool tp_assembler_add(tp_assembler_t *as, const tp_raw_frame_t *raw, const tp_finger_t *finger,
+                      tp_multi_msg_t *out);
+
+// Sends the open scan as it is (timeout). Returns false when none is open.
+bool tp_assembler_flush(tp_assembler_t *as, tp_multi_msg_t *out);
+
+// Frame of its own reporting contacts (by contact_id mask) lifted at their
+// last position, e.g. when their tracks timed out. Flush an open scan first.
+bool tp_assembler_lift(tp_assembler_t *as, uint8_t ids, uint16_t scan_time, uint16_t capture_ticks,
+                       tp_multi_msg_t *out);
+
+static inline bool tp_assembler_pending(const tp_assembler_t *as) {
+    return as->open;
+}
+
+#endif
@@ -0,0 +1,164 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/i2c_master.h"
+#include "driver/gpio.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "sdkconfig.h"
+#include "i2c/I2C_HID_Report.h"
+#include "i2c/tp_driver.h"
+#include "tp_boot.h"
+#include "tp_mode.h"
+
+static const char *TAG = "TP_DRIVER";
+
+#define PROBE_TIMEOUT_MS 50
+#define RESET_PULSE_MS   10
+#define RESET_BOOT_MS    150    // longest a controller takes to answer after reset or power on
+
+// Shared by whichever driver is in use
+i2c_master_dev_handle_t dev_handle = NULL;
+i2c_master_bus_handle_t bus_handle = NULL;
+volatile uint8_t current_mode = MOUSE_MODE;
+volatile uint8_t tp_smoothing = CONFIG_TP_SMOOTHING_MODE;
+
+const tp_driver_t *tp_driver = NULL;
+
+// Probe order matters: a probe clocks the candidate's SCL and SDA, and
+// Goodix's (6, 7) are ELAN's reset and INT lines, while ELAN's bus (9, 8)
+// is on pins the Goodix board leaves alone. Goodix's bus is only built
+// once ELAN has not answered.
+static const tp_driver_t *const candidates[] = {
+#if CONFIG_TP_MODEL_AUTODETECT || CONFIG_ELAN_LENOVO_33370A
+    &elan_33370a_driver,
+#endif
+#if CONFIG_TP_MODEL_AUTODETECT || CONFIG_MI_GOODIX_HAPTIC_ENGINE
+    &goodix_gt7863_driver,
+#endif
+};
+
+#define CANDIDATE_COUNT (sizeof(candidates) / sizeof(candidates[0]))
+
+static int64_t reset_at_us;
+static bool reset_done = false;
+
+static void reset_assert(const tp_driver_t *drv) {
+    gpio_set_direction(drv->rst_io, GPIO_MODE_OUTPUT);
+    gpio_set_level(drv->rst_io, 0);
+    reset_at_us = esp_timer_get_time();
+}
+
+// Ends the reset pulse, then polls the controller's address until it
+// acknowledges instead of waiting a fixed boot time. The bus must exist.
+static bool reset_release(const tp_driver_t *drv) {
+    int64_t left_us = reset_at_us + RESET_PULSE_MS * 1000 - esp_timer_get_time();
+    if (left_us > 0) vTaskDelay(pdMS_TO_TICKS((left_us + 999) / 1000));
+    gpio_set_level(drv->rst_io, 1);
+
+    int64_t deadline = esp_timer_get_time() + RESET_BOOT_MS * 1000;
+    while (i2c_master_probe(bus_handle, drv->addr, PROBE_TIMEOUT_MS) != ESP_OK) {
+        if (esp_timer_get_time() > deadline) return false;
+        vTaskDelay(1);
+    }
+    reset_done = true;
+    tp_boot_mark(TP_BOOT_TOUCH_RESET);
+    return true;
+}
+
+static void create_bus(const tp_driver_t *drv) {
+    i2c_master_bus_config_t bus_cfg = {
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .i2c_port = I2C_NUM_0,
+        .scl_io_num = drv->scl_io,
+        .sda_io_num = drv->sda_io,
+        .glitch_ignore_cnt = 7,
+        .flags.enable_internal_pullup = true,
+    };
+    ESP_ERROR_CHECK(i2c_new_master_bus(&bus_cfg, &bus_handle));
+}
+
+// The boards wire the models to different pins (one model's reset line is
+// another's SCL), so each candidate gets its own bus and is released again
+// when it does not answer. No reset line is driven before the model is
+// known: the controllers run from power on, so the probe only addresses
+// them, and a missing one costs a single NAK.
+static bool probe(const tp_driver_t *drv) {
+    create_bus(drv);
+    if (i2c_master_probe(bus_handle, drv->addr, PROBE_TIMEOUT_MS) == ESP_OK) {
+        return true;
+    }
+
+    i2c_del_master_bus(bus_handle);
+    bus_handle = NULL;
+    return false;
+}
+
+void tp_driver_select(void) {
+    if (CANDIDATE_COUNT == 1) {
+        tp_driver = candidates[0];
+        reset_assert(tp_driver);
+        create_bus(tp_driver);
+        return;
+    }
+
+    // Reset and INT lines stay inputs, so a probe drives none of them
+    for (size_t i = 0; i < CANDIDATE_COUNT; i++) {
+        gpio_set_direction(candidates[i]->rst_io, GPIO_MODE_INPUT);
+        gpio_set_direction(candidates[i]->int_io, GPIO_MODE_INPUT);
+    }
+
+    // Each candidate is probed once, so the slowest controller must have
+    // booted by then: a controller that is still silent would be taken for
+    // absent, and the next candidate's bus clocked over its reset line
+    int64_t left_us = RESET_BOOT_MS * 1000 - esp_timer_get_time();
+    if (left_us > 0) vTaskDelay(pdMS_TO_TICKS((left_us + 999) / 1000));
+
+    for (size_t i = 0; i < CANDIDATE_COUNT && tp_driver == NULL; i++) {
+        if (probe(candidates[i])) tp_driver = candidates[i];
+    }
+
+    if (tp_driver != NULL) {
+        // Booted and answering: a reset pulse would only start it again.
+        // Its reset line is held released from here on.
+        gpio_set_level(tp_driver->rst_io, 1);
+        gpio_set_direction(tp_driver->rst_io, GPIO_MODE_OUTPUT);
+        reset_done = true;
+        tp_boot_mark(TP_BOOT_TOUCH_RESET);
+        return;
+    }
+
+    tp_driver = candidates[0];
+    ESP_LOGE(TAG, "No touch pad answered, assuming %s", tp_driver->name);
+    reset_assert(tp_driver);
+    create_bus(tp_driver);
+}
+
+void tp_driver_init(void) {
+    if (!reset_done && !reset_release(tp_driver)) {
+        ESP_LOGW(TAG, "%s not answering %d ms after reset", tp_driver->name, RESET_BOOT_MS);
+    }
+
+    ESP_LOGI(TAG, "%s at 0x%02X", tp_driver->name, tp_driver->addr);
+    tp_driver->init();
+    tp_mode_controller_reset();
+    tp_boot_mark(TP_BOOT_TOUCH_READY);
+}
+
+void tp_driver_check_layout(const hid_tp_layout_t *layout) {
+    if (layout->logical_max_x != tp_driver->controller_max_x ||
+        layout->logical_max_y != tp_driver->controller_max_y) {
+        ESP_LOGW(TAG, "Controller range %ux%u, reporting for %ux%u",
+                 layout->logical_max_x + 1, layout->logical_max_y + 1,
+                 tp_driver->controller_max_x + 1, tp_driver->controller_max_y + 1);
+    }
+}
+
+TickType_t tp_driver_expiry_wait(const tp_tracker_t *tracker) {
+    int32_t left = tp_tracker_ticks_left(tracker, tp_capture_ticks());
+    if (left < 0) return portMAX_DELAY;
+
+    // Capture ticks are 100 us; round up so the deadline has passed on wake
+    TickType_t ticks = pdMS_TO_TICKS((left + 9) / 10);
+    return ticks > 0 ? ticks : 1;
+}
@@ -0,0 +1,90 @@
+#ifndef TP_DRIVER_H
+#define TP_DRIVER_H
+
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "driver/i2c_master.h"
+#include "esp_err.h"
+
+#include "i2c/hid_decoder.h"
+#include "i2c/tp_tracker.h"
+#include "i2c/tp_smooth.h"
+
+// One touch pad controller model. Both drivers are linked in; the model is
+// picked at boot by probing each candidate's I2C address on its own pins
+// (CONFIG_TP_MODEL_AUTODETECT) or fixed in menuconfig.
+//
+// Everything model specific stays in the driver: its report layout is a
+// static const table decoded inline, so the per-frame path has no
+// indirection beyond the task entry point.
+
+// Controller mouse mode input report: ID 0x01, buttons, x, y
+#define MOUSE_REPORT_LEN 4
+
+typedef struct {
+    const char *name;
+    uint8_t addr;               // 7-bit address, probed at boot
+    uint8_t scl_io;
+    uint8_t sda_io;
+    uint8_t rst_io;
+    uint8_t int_io;
+
+    // Controller coordinate range the filters and the scaler expect
+    uint16_t controller_max_x;
+    uint16_t controller_max_y;
+
+    // PTP report descriptor ranges (see ptp_report_desc_set_model). The
+    // logical range is TP_OUTPUT_MAX of the controller's; the physical one
+    // is the pad's size and does not change with TP_SUBPIXEL_BITS.
+    uint16_t logical_max_x;
+    uint16_t logical_max_y;
+    uint16_t physical_max_x;
+    uint16_t physical_max_y;
+    uint8_t unit_exponent;
+    uint8_t unit;
+
+    // Called with bus_handle created and the controller out of reset: adds
+    // dev_handle, loads the report layout and starts tp_reader.
+    void (*init)(void);
+    esp_err_t (*activate_ptp)(void);
+    esp_err_t (*activate_mouse)(void);
+    // Decodes the frames tp_reader delivers, never returns
+    void (*task)(void *arg);
+} tp_driver_t;
+
+extern const tp_driver_t elan_33370a_driver;
+extern const tp_driver_t goodix_gt7863_driver;
+
+// The model in use, set by tp_driver_select()
+extern const tp_driver_t *tp_driver;
+
+// Position smoothing of the per-contact filter (tp_smooth_mode_t), from
+// CONFIG_TP_SMOOTHING_MODE at boot; the generic HID filter page changes it
+// at run time. Read once per report by the driver task.
+extern volatile uint8_t tp_smoothing;
+
+// Picks the model and creates the I2C bus, so the USB descriptor can be
+// set before enumeration. With several candidates it polls each one's
+// address on its own pins, without touching any reset line, for at most
+// a controller's boot time. Falls back to the first candidate when none
+// answers. Either way it returns with the selected model's reset asserted.
+void tp_driver_select(void);
+
+// Waits for the selected controller to leave reset and runs the driver's
+// init. Blocks for as long as the controller takes to boot.
+void tp_driver_init(void);
+
+// Descriptor logical maxima are 16-bit signed items
+#define TP_OUTPUT_FITS(max) (TP_OUTPUT_MAX(max) <= 0x7FFF)
+
+// Warns when the controller's own report descriptor (the loaded layout)
+// has another range than the driver was built for: reports would then
+// not span, or overrun, the PTP descriptor's range.
+void tp_driver_check_layout(const hid_tp_layout_t *layout);
+
+// How long a driver task may wait for frames before the next contact
+// deadline of its tracker is due (portMAX_DELAY when nothing is down).
+TickType_t tp_driver_expiry_wait(const tp_tracker_t *tracker);
+
+#endif
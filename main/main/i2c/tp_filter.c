@@ -0,0 +1,238 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "i2c/tp_filter.h"
+
+#define TP_MAX_JUMP2_STRICT (300 * 300)
+#define TP_MAX_JUMP_ERRORS  2
+
+static uint16_t get_median(uint16_t n1, uint16_t n2, uint16_t n3) {
+    if ((n1 > n2) ^ (n1 > n3)) return n1;
+    else if ((n2 > n1) ^ (n2 > n3)) return n2;
+    else return n3;
+}
+
+void tp_filter_init(tp_filter_t *filter) {
+    memset(filter->contacts, 0, sizeof(filter->contacts));
+    tp_tracker_init(&filter->tracker);
+    filter->smoothing = TP_SMOOTH_IIR;
+}
+
+void tp_filter_reset_contact(tp_filter_t *filter, uint8_t id) {
+    if (id >= TP_MAX_CONTACTS) return;
+    memset(&filter->contacts[id], 0, sizeof(filter->contacts[id]));
+}
+
+static bool filter_contact(tp_filter_contact_t *c, const tp_raw_contact_t *raw, tp_smooth_mode_t smoothing,
+                           uint16_t scan_time, tp_finger_t *out) {
+    uint16_t rx = raw->x;
+    uint16_t ry = raw->y;
+
+    for (int h = 0; h < TP_FILTER_HISTORY - 1; h++) {
+        c->hist_x[h] = c->hist_x[h + 1];
+        c->hist_y[h] = c->hist_y[h + 1];
+    }
+    c->hist_x[TP_FILTER_HISTORY - 1] = rx;
+    c->hist_y[TP_FILTER_HISTORY - 1] = ry;
+
+    // Not enough history yet: report nothing for this slot.
+    if (c->hist_x[0] == 0) return false;
+
+    uint16_t mx = get_median(c->hist_x[0], c->hist_x[1], c->hist_x[2]);
+    uint16_t my = get_median(c->hist_y[0], c->hist_y[1], c->hist_y[2]);
+
+    // Linear prediction from the last deltas, reject implausible jumps.
+    int predict_x = c->hist_x[TP_FILTER_HISTORY - 1];
+    int predict_y = c->hist_y[TP_FILTER_HISTORY - 1];
+    int dx_sum = 0, dy_sum = 0, count_valid = 0;
+    bool jumped = false;
+    for (int h = 1; h < TP_FILTER_HISTORY; h++) {
+        if (c->hist_x[h - 1] && c->hist_x[h]) {
+            dx_sum += c->hist_x[h] - c->hist_x[h - 1];
+            dy_sum += c->hist_y[h] - c->hist_y[h - 1];
+            count_valid++;
+        }
+    }
+
+    if (count_valid > 0) {
+        predict_x = (int16_t)(predict_x + dx_sum / count_valid);
+        predict_y = (int16_t)(predict_y + dy_sum / count_valid);
+
+        int dx_jump = mx - predict_x;
+        int dy_jump = my - predict_y;
+
+        if (dx_jump * dx_jump + dy_jump * dy_jump > TP_MAX_JUMP2_STRICT) {
+            if (c->consecutive_errors < TP_MAX_JUMP_ERRORS) {
+                mx = c->last_raw_x ? c->last_raw_x : mx;
+                my = c->last_raw_y ? c->last_raw_y : my;
+                c->consecutive_errors++;
+                jumped = true;
+            } else {
+                c->consecutive_errors = 0;
+            }
+        } else {
+            c->consecutive_errors = 0;
+        }
+    }
+
+    if (smoothing != TP_SMOOTH_IIR) {
+        // A rejected jump is fed as the last accepted position
+        if (c->last_raw_x == 0) tp_smooth_start(&c->smooth, smoothing, mx, my, scan_time);
+        else tp_smooth_step(&c->smooth, smoothing, jumped ? mx : rx, jumped ? my : ry, scan_time);
+
+        // Keep the IIR state in step for a switch back
+        c->filtered_x = (uint32_t)c->smooth.x;
+        c->filtered_y = (uint32_t)c->smooth.y;
+    } else if (c->last_raw_x == 0) {
+        // Speed-adaptive IIR, seeded from the median on touch down.
+        c->filtered_x = (uint32_t)mx << 8;
+        c->filtered_y = (uint32_t)my << 8;
+    } else {
+        int vx = rx - c->last_raw_x;
+        int vy = ry - c->last_raw_y;
+        int alpha_speed = abs(vx) + abs(vy);
+
+        uint32_t dynamic_alpha;
+        if (alpha_speed < 3) dynamic_alpha = 64;
+        else if (alpha_speed < 12) dynamic_alpha = 115;
+        else dynamic_alpha = 218;
+
+        c->filtered_x = (dynamic_alpha * ((uint32_t)rx << 8) +
+                            (256 - dynamic_alpha) * c->filtered_x) >> 8;
+        c->filtered_y = (dynamic_alpha * ((uint32_t)ry << 8) +
+                            (256 - dynamic_alpha) * c->filtered_y) >> 8;
+    }
+
+    out->x = tp_output_from_q8(c->filtered_x);
+    out->y = tp_output_from_q8(c->filtered_y);
+
+    // Axis lock: a mostly-horizontal or mostly-vertical move does not
+    // update the minor axis of the velocity reference.
+    int dx_raw = rx - c->last_raw_x;
+    int dy_raw = ry - c->last_raw_y;
+    if (abs(dx_raw) > abs(dy_raw) * 2 && abs(dy_raw) < 6) ry = c->last_raw_y;
+    else if (abs(dy_raw) > abs(dx_raw) * 2 && abs(dx_raw) < 6) rx = c->last_raw_x;
+
+    if (raw->tip_switch) {
+        out->tip_switch = 1;
+        c->last_raw_x = rx;
+        c->last_raw_y = ry;
+    } else {
+        out->tip_switch = 0;
+        memset(c, 0, sizeof(*c));
+    }
+    return true;
+}
+
+// Ended contacts are lifted where they were last seen. Returns the
+// contacts reported.
+static uint8_t lift_ended(tp_filter_t *filter, uint8_t ended, tp_multi_msg_t *out) {
+    uint8_t reported = 0;
+
+    for (uint8_t id = 0; id < TP_MAX_CONTACTS; id++) {
+        if (!(ended & (1u << id))) continue;
+
+        tp_filter_contact_t *c = &filter->contacts[id];
+        if (c->last_raw_x != 0) {
+            tp_finger_t *f = &out->fingers[id];
+            f->x = tp_output_from_q8(c->filtered_x);
+            f->y = tp_output_from_q8(c->filtered_y);
+            f->tip_switch = 0;
+            f->confidence = 1;
+            f->contact_id = id;
+            reported |= 1u << id;
+        }
+        tp_filter_reset_contact(filter, id);
+    }
+    return reported;
+}
+
+// Moves the contacts in mask (track indexes) to the front of the message
+// and clears what is left behind them.
+static void pack_contacts(tp_multi_msg_t *out, uint8_t mask) {
+    uint8_t n = 0;
+    for (uint8_t id = 0; id < TP_MAX_CONTACTS; id++) {
+        if (mask & (1u << id)) out->fingers[n++] = out->fingers[id];
+    }
+    out->actual_count = n;
+    memset(&out->fingers[n], 0, (TP_MAX_CONTACTS - n) * sizeof(out->fingers[0]));
+}
+
+void tp_filter_process(tp_filter_t *filter, const tp_raw_frame_t *in, uint16_t now, tp_multi_msg_t *out) {
+    tp_track_update_t update;
+
+    memset(out, 0, sizeof(*out));
+
+    out->scan_time = in->scan_time;
+    out->button_mask = in->button_mask;
+
+    tp_tracker_update(&filter->tracker, in, now, &update);
+
+    uint8_t reported = 0;
+    for (uint8_t slot = 0; slot < TP_MAX_CONTACTS; slot++) {
+        uint8_t id = update.track[slot];
+        if (id == TP_TRACK_NONE) continue;
+
+        if (update.started & (1u << id)) tp_filter_reset_contact(filter, id);
+
+        tp_finger_t *f = &out->fingers[id];
+        f->confidence = in->contacts[slot].confidence;
+
+        if (filter_contact(&filter->contacts[id], &in->contacts[slot], filter->smoothing, in->scan_time, f)) {
+            f->contact_id = id;
+            reported |= 1u << id;
+        }
+    }
+
+    reported |= lift_ended(filter, update.ended, out);
+    pack_contacts(out, reported);
+}
+
+bool tp_filter_expire(tp_filter_t *filter, uint16_t now, tp_multi_msg_t *out) {
+    tp_track_update_t update;
+
+    if (!tp_tracker_expire(&filter->tracker, now, &update)) return false;
+
+    memset(out, 0, sizeof(*out));
+    out->scan_time = tp_tracker_scan_time(&filter->tracker, now);
+    out->capture_ticks = now;
+
+    uint8_t reported = lift_ended(filter, update.ended, out);
+
+    for (uint8_t id = 0; id < TP_MAX_CONTACTS; id++) {
+        tp_filter_contact_t *c = &filter->contacts[id];
+        if (!(filter->tracker.active_mask & (1u << id)) || c->last_raw_x == 0) continue;
+
+        tp_finger_t *f = &out->fingers[id];
+        f->x = tp_output_from_q8(c->filtered_x);
+        f->y = tp_output_from_q8(c->filtered_y);
+        f->tip_switch = 1;
+        f->confidence = 1;
+        f->contact_id = id;
+        reported |= 1u << id;
+    }
+
+    pack_contacts(out, reported);
+    return true;
+}
+
+bool tp_filter_single(tp_filter_t *filter, const tp_raw_frame_t *in, uint16_t now, tp_finger_t *finger) {
+    tp_multi_msg_t out;
+
+    // A one-contact report only ends its own track, so the frame holds at
+    // most that contact
+    tp_filter_process(filter, in, now, &out);
+    if (out.actual_count == 0) return false;
+    *finger = out.fingers[0];
+    return true;
+}
+
+uint8_t tp_filter_expire_tracks(tp_filter_t *filter, uint16_t now) {
+    tp_track_update_t update;
+
+    if (!tp_tracker_expire(&filter->tracker, now, &update)) return 0;
+    for (uint8_t id = 0; id < TP_MAX_CONTACTS; id++) {
+        if (update.ended & (1u << id)) tp_filter_reset_contact(filter, id);
+    }
+    return update.ended;
+}
@@ -0,0 +1,53 @@
+#ifndef TP_FILTER_H
+#define TP_FILTER_H
+
+#include <stdint.h>
+#include "i2c/tp_frame.h"
+#include "i2c/tp_tracker.h"
+#include "i2c/tp_smooth.h"
+
+#define TP_FILTER_HISTORY 3
+
+// Per-contact filter state: 3-tap median history, jump rejection and the
+// position smoothing (speed-adaptive IIR, or tp_smooth's One-Euro or
+// Kalman filter). Positions are kept with 8 fractional bits.
+typedef struct {
+    uint16_t hist_x[TP_FILTER_HISTORY];
+    uint16_t hist_y[TP_FILTER_HISTORY];
+    uint16_t last_raw_x;
+    uint16_t last_raw_y;
+    uint32_t filtered_x;
+    uint32_t filtered_y;
+    uint8_t consecutive_errors;
+    tp_smooth_t smooth;
+} tp_filter_contact_t;
+
+// Contacts are indexed by tracker track, not by controller slot, so a slot
+// the controller reuses or swaps does not inherit another finger's history.
+typedef struct {
+    tp_filter_contact_t contacts[TP_MAX_CONTACTS];
+    tp_tracker_t tracker;
+    tp_smooth_mode_t smoothing;     // may change between frames
+} tp_filter_t;
+
+// Starts with TP_SMOOTH_IIR
+void tp_filter_init(tp_filter_t *filter);
+void tp_filter_reset_contact(tp_filter_t *filter, uint8_t id);
+// now: capture ticks of the report (see tp_tracker.h)
+void tp_filter_process(tp_filter_t *filter, const tp_raw_frame_t *in, uint16_t now, tp_multi_msg_t *out);
+
+// One-contact reports (hybrid mode, ELAN) through the same stage. Returns
+// true with the report's contact in *finger, contact_id its track; false
+// for a report without a contact or while the contact has too little
+// history to filter.
+bool tp_filter_single(tp_filter_t *filter, const tp_raw_frame_t *in, uint16_t now, tp_finger_t *finger);
+
+// Ends the tracks that timed out and clears their filter state. Returns the
+// ended tracks (0 when none), to be lifted by whoever holds the frame.
+uint8_t tp_filter_expire_tracks(tp_filter_t *filter, uint16_t now);
+
+// Lifts the contacts whose tracks timed out. Returns true with a frame in
+// *out that reports them tip up and every other contact still down.
+bool tp_filter_expire(tp_filter_t *filter, uint16_t now, tp_multi_msg_t *out);
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef TP_FRAME_H
+#define TP_FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+// Plain frame types shared by the touch pipeline. Nothing in here may depend
+// on ESP-IDF so the pipeline can be built and benchmarked on a host.
+
+#define TP_MAX_CONTACTS 5
+
+// Reported coordinates keep TP_SUBPIXEL_BITS of the filters' 8 fractional
+// bits, so a controller range 0..max is sent as 0..TP_OUTPUT_MAX(max) and
+// slow moves do not step a whole controller unit at a time. 0 reports the
+// controller's own resolution. The host build sets it with -D.
+#ifdef CONFIG_TP_SUBPIXEL_BITS
+#define TP_SUBPIXEL_BITS CONFIG_TP_SUBPIXEL_BITS
+#else
+#define TP_SUBPIXEL_BITS 0
+#endif
+
+#define TP_OUTPUT_MAX(max) ((((max) + 1) << TP_SUBPIXEL_BITS) - 1)
+
+// Filter position with 8 fractional bits to report units
+static inline uint16_t tp_output_from_q8(uint32_t v) {
+    return (uint16_t)(v >> (8 - TP_SUBPIXEL_BITS));
+}
+
+// Controller coordinate to report units
+static inline uint16_t tp_output_from_raw(uint16_t v) {
+    return (uint16_t)(v << TP_SUBPIXEL_BITS);
+}
+
+// Report units back to controller coordinates (wireless link)
+static inline uint16_t tp_output_to_raw(uint16_t v) {
+    return v >> TP_SUBPIXEL_BITS;
+}
+
+typedef struct {
+    uint16_t x;                 // report units, see TP_SUBPIXEL_BITS
+    uint16_t y;
+    uint8_t tip_switch;
+    uint8_t contact_id;
+    uint8_t confidence;
+} tp_finger_t;
+
+// Latency trace stamps (esp_timer microseconds, low 32 bits) carried with a
+// frame from the touch pad task to the USB task. 0 = not stamped.
+typedef struct {
+    uint32_t isr;               // INT asserted
+    uint32_t read;              // first I2C read of the frame complete
+    uint32_t filter;            // frame ready to queue
+} tp_trace_t;
+
+// One frame for the host. fingers[0..actual_count) are the frame's
+// contacts in track order, each with its track index as contact_id; the
+// rest are zero.
+typedef struct {
+    tp_finger_t fingers[TP_MAX_CONTACTS];
+    uint8_t actual_count;
+    uint8_t button_mask;
+    uint16_t scan_time;
+    uint16_t capture_ticks;     // first I2C read, esp_timer in 100 us ticks (low 16 bits)
+    tp_trace_t trace;
+} tp_multi_msg_t;
+
+// One decoded controller report, contacts indexed by controller slot.
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+    uint8_t tip_switch;
+    uint8_t confidence;
+} tp_raw_contact_t;
+
+typedef struct {
+    tp_raw_contact_t contacts[TP_MAX_CONTACTS];
+    uint8_t contact_count;
+    uint8_t button_mask;
+    uint8_t slot_mask;          // slots carried by this report
+    uint16_t scan_time;
+} tp_raw_frame_t;
+
+#endif
@@ -0,0 +1,129 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "i2c/tp_pipe.h"
+#include "i2c/spsc_ring.h"
+#include "trace/tp_sched.h"
+#include "trace/tp_counters.h"
+#include "trace/tp_log.h"
+
+static const char *TAG = "TP_PIPE";
+
+static tp_multi_msg_t touch_slots[TP_PIPE_TOUCH_DEPTH];
+static mouse_msg_t mouse_slots[TP_PIPE_MOUSE_DEPTH];
+static spsc_ring_t touch_ring;
+static spsc_ring_t mouse_ring;
+
+static TaskHandle_t consumer_task = NULL;
+static tp_pipe_stats_t stats;
+
+// Contact state of the last touch frame handed to the consumer
+static tp_multi_msg_t last_sent;
+
+void tp_pipe_init(void) {
+    spsc_ring_init(&touch_ring, touch_slots, sizeof(tp_multi_msg_t), TP_PIPE_TOUCH_DEPTH);
+    spsc_ring_init(&mouse_ring, mouse_slots, sizeof(mouse_msg_t), TP_PIPE_MOUSE_DEPTH);
+    memset(&stats, 0, sizeof(stats));
+    memset(&last_sent, 0, sizeof(last_sent));
+}
+
+void tp_pipe_set_consumer(TaskHandle_t task) {
+    consumer_task = task;
+}
+
+static void wake_consumer(void) {
+    if (consumer_task != NULL) {
+        tp_sched_signal(TP_TASK_HID);
+        xTaskNotifyGive(consumer_task);
+    }
+}
+
+bool tp_pipe_send_touch(const tp_multi_msg_t *msg) {
+    if (!spsc_ring_push(&touch_ring, msg)) {
+        tp_count(TP_CNT_PIPE_DROPPED);
+        if (stats.touch_dropped++ == 0) {
+            TP_LOGW(TAG, "Touch ring full, dropping frames");
+        }
+        return false;
+    }
+    wake_consumer();
+    return true;
+}
+
+bool tp_pipe_send_mouse(const mouse_msg_t *msg) {
+    if (!spsc_ring_push(&mouse_ring, msg)) {
+        stats.mouse_dropped++;
+        return false;
+    }
+    wake_consumer();
+    return true;
+}
+
+static bool same_contact_state(const tp_multi_msg_t *a, const tp_multi_msg_t *b) {
+    if (a->actual_count != b->actual_count || a->button_mask != b->button_mask) return false;
+    for (int i = 0; i < TP_MAX_CONTACTS; i++) {
+        if (a->fingers[i].contact_id != b->fingers[i].contact_id ||
+            a->fingers[i].tip_switch != b->fingers[i].tip_switch ||
+            a->fingers[i].confidence != b->fingers[i].confidence) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool tp_pipe_next_touch(tp_multi_msg_t *msg) {
+    tp_multi_msg_t *m = spsc_ring_peek(&touch_ring, 0);
+    if (m == NULL) return false;
+
+    // A queued frame that changes nothing but positions can be skipped
+    // when a newer one is already waiting: the host still sees every
+    // tip/confidence transition.
+    while (spsc_ring_peek(&touch_ring, 1) != NULL && same_contact_state(m, &last_sent)) {
+        spsc_ring_pop(&touch_ring);
+        stats.touch_coalesced++;
+        tp_count(TP_CNT_PIPE_COALESCED);
+        m = spsc_ring_peek(&touch_ring, 0);
+    }
+
+    *msg = *m;
+    spsc_ring_pop(&touch_ring);
+    last_sent = *msg;
+    return true;
+}
+
+bool tp_pipe_next_mouse(mouse_msg_t *msg) {
+    mouse_msg_t *m = spsc_ring_peek(&mouse_ring, 0);
+    if (m == NULL) return false;
+
+    int x = m->x, y = m->y;
+    uint8_t buttons = m->buttons;
+    spsc_ring_pop(&mouse_ring);
+
+    // Merge queued deltas while the buttons stay the same
+    while ((m = spsc_ring_peek(&mouse_ring, 0)) != NULL && m->buttons == buttons) {
+        int nx = x + m->x, ny = y + m->y;
+        if (nx < -127 || nx > 127 || ny < -127 || ny > 127) break;
+        x = nx;
+        y = ny;
+        spsc_ring_pop(&mouse_ring);
+        stats.mouse_coalesced++;
+    }
+
+    msg->x = (int8_t)x;
+    msg->y = (int8_t)y;
+    msg->buttons = buttons;
+    return true;
+}
+
+bool tp_pipe_touch_pending(void) {
+    return spsc_ring_count(&touch_ring) > 0;
+}
+
+bool tp_pipe_mouse_pending(void) {
+    return spsc_ring_count(&mouse_ring) > 0;
+}
+
+void tp_pipe_get_stats(tp_pipe_stats_t *out) {
+    *out = stats;
+}
@@ -0,0 +1,39 @@
+#ifndef TP_PIPE_H
+#define TP_PIPE_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "i2c/I2C_HID_Report.h"
+
+// Frames from the touch pad task (single producer) to usbhid_task (single
+// consumer). Nothing is overwritten: when the consumer falls behind, only
+// move frames that do not change any contact's tip/confidence state are
+// merged, and a full ring counts a drop.
+
+#define TP_PIPE_TOUCH_DEPTH 32
+#define TP_PIPE_MOUSE_DEPTH 16
+
+typedef struct {
+    uint32_t touch_dropped;     // ring full, frame lost
+    uint32_t touch_coalesced;   // queued move frame superseded by a newer one
+    uint32_t mouse_dropped;
+    uint32_t mouse_coalesced;   // mouse deltas merged into one report
+} tp_pipe_stats_t;
+
+void tp_pipe_init(void);
+void tp_pipe_set_consumer(TaskHandle_t task);
+
+// Producer side
+bool tp_pipe_send_touch(const tp_multi_msg_t *msg);
+bool tp_pipe_send_mouse(const mouse_msg_t *msg);
+
+// Consumer side
+bool tp_pipe_next_touch(tp_multi_msg_t *msg);
+bool tp_pipe_next_mouse(mouse_msg_t *msg);
+bool tp_pipe_touch_pending(void);
+bool tp_pipe_mouse_pending(void);
+
+void tp_pipe_get_stats(tp_pipe_stats_t *stats);
+
+#endif
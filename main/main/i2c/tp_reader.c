@@ -0,0 +1,199 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "driver/i2c_master.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "sdkconfig.h"
+#include "i2c/I2C_HID_Report.h"
+#include "i2c/tp_driver.h"
+#include "i2c/tp_reader.h"
+#include "i2c/spsc_ring.h"
+#include "trace/tp_capture.h"
+#include "trace/tp_latency.h"
+#include "trace/tp_sched.h"
+#include "trace/tp_counters.h"
+#include "trace/tp_log.h"
+#include "tp_tasks.h"
+
+static const char *TAG = "TP_READER";
+
+// Woken by tp_gpio_isr_handler (i2c_int.c)
+TaskHandle_t tp_read_task_handle = NULL;
+
+static tp_reader_frame_t frames[TP_READER_DEPTH];
+static spsc_ring_t ring;
+
+static i2c_master_dev_handle_t std_dev;
+static i2c_master_dev_handle_t fast_dev = NULL;
+static i2c_master_dev_handle_t read_dev;
+static TaskHandle_t consumer_task = NULL;
+static int int_gpio;
+static uint16_t max_report_len;     // wMaxInputLength, or no limit
+
+static tp_reader_stats_t stats;
+static uint16_t window_reads;
+static uint16_t window_errors;
+static uint32_t log_at;
+
+void tp_reader_set_consumer(TaskHandle_t task) {
+    consumer_task = task;
+}
+
+void tp_reader_wake_consumer(void) {
+    if (consumer_task != NULL) {
+        tp_sched_signal(TP_TASK_DRIVER);
+        xTaskNotifyGive(consumer_task);
+    }
+}
+
+const tp_reader_frame_t *tp_reader_peek(void) {
+    return spsc_ring_peek(&ring, 0);
+}
+
+void tp_reader_release(void) {
+    spsc_ring_pop(&ring);
+}
+
+void tp_reader_get_stats(tp_reader_stats_t *out) {
+    *out = stats;
+}
+
+static void log_bus_time(void) {
+    if (stats.frames == 0) return;
+    TP_LOGI(TAG, "%u byte reads at %s: avg %lu us, max %u us per frame",
+             stats.read_len, stats.fast ? "1 MHz" : "400 kHz",
+             (unsigned long)(stats.bus_us_total / stats.frames), stats.bus_us_max);
+}
+
+static void reset_bus_time(void) {
+    stats.frames = 0;
+    stats.bus_us_total = 0;
+    stats.bus_us_max = 0;
+    log_at = TP_READER_LOG_AFTER;
+}
+
+// Fast-mode Plus is given up for good once a window of reads sees too
+// many errors; the same address stays registered at 400 kHz.
+static void check_error_rate(bool failed) {
+    if (failed) window_errors++;
+    if (++window_reads < TP_READER_ERR_WINDOW && window_errors <= TP_READER_ERR_MAX) return;
+
+    if (read_dev == fast_dev && window_errors > TP_READER_ERR_MAX) {
+        TP_LOGW(TAG, "%u errors in %u reads at 1 MHz, falling back to 400 kHz", window_errors, window_reads);
+        log_bus_time();
+        read_dev = std_dev;
+        stats.fast = false;
+        i2c_master_bus_rm_device(fast_dev);
+        fast_dev = NULL;
+        reset_bus_time();
+    }
+    window_reads = 0;
+    window_errors = 0;
+}
+
+// Reads into the next free slot in place and publishes it.
+static void read_frame(void) {
+    uint8_t discard[TP_READER_FRAME_LEN];
+    tp_reader_frame_t *f = spsc_ring_peek_free(&ring);
+    uint8_t *buf = f ? f->data : discard;
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = i2c_master_receive(read_dev, buf, stats.read_len, pdMS_TO_TICKS(5));
+    uint32_t bus_us = (uint32_t)(esp_timer_get_time() - start);
+
+    uint16_t len = buf[0] | (buf[1] << 8);
+    bool bad = ret != ESP_OK || (len > max_report_len && len != 0xFFFF);
+    check_error_rate(bad);
+    if (bad) {
+        stats.errors++;
+        tp_count(TP_CNT_I2C_ERRORS);
+        return;
+    }
+
+    // 0 (and 0xFFFF on some controllers): no report pending, or a reset
+    if (len <= 2 || len == 0xFFFF) {
+        stats.empty++;
+        tp_count(TP_CNT_I2C_EMPTY);
+        return;
+    }
+
+    if (f == NULL) {
+        tp_count(TP_CNT_READER_DROPPED);
+        if (stats.dropped++ == 0) {
+            TP_LOGW(TAG, "Frame ring full, dropping frames");
+        }
+        return;
+    }
+
+    f->len = len < stats.read_len ? len : stats.read_len;
+    f->capture_ticks = tp_capture_ticks();
+    f->trace = (tp_trace_t){0};
+    tp_latency_read(&f->trace);
+    tp_capture_frame(f->data, stats.read_len);
+
+    spsc_ring_commit(&ring);
+    tp_reader_wake_consumer();
+
+    tp_count(TP_CNT_FRAMES);
+    stats.frames++;
+    stats.bus_us_total += bus_us;
+    if (bus_us > stats.bus_us_max) stats.bus_us_max = bus_us;
+    if (stats.frames == log_at) {
+        log_bus_time();
+        log_at = 0;
+    }
+}
+
+static void tp_reader_task(void *arg) {
+    while (1) {
+        // The ISR masks the level interrupt once it fires. Armed again, it
+        // fires at once if INT is still low after a full burst.
+        gpio_intr_enable(int_gpio);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        tp_sched_woken(TP_TASK_READER);
+
+        int safety = 10;
+        while (gpio_get_level(int_gpio) == 0 && safety-- > 0) {
+            read_frame();
+        }
+        if (safety < 0) tp_count(TP_CNT_BURST_LIMIT);
+    }
+}
+
+void tp_reader_start(i2c_master_bus_handle_t bus, i2c_master_dev_handle_t dev, uint16_t addr,
+                     uint16_t max_input_len) {
+    std_dev = dev;
+    read_dev = dev;
+    int_gpio = tp_driver->int_io;
+    spsc_ring_init(&ring, frames, sizeof(tp_reader_frame_t), TP_READER_DEPTH);
+
+    stats.read_len = TP_READER_FRAME_LEN;
+    max_report_len = 0xFFFE;
+    if (max_input_len > 2) {
+        max_report_len = max_input_len;
+        if (max_input_len < TP_READER_FRAME_LEN) stats.read_len = max_input_len;
+    }
+
+#if CONFIG_TP_I2C_FAST_MODE_PLUS
+    i2c_device_config_t fast_cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = addr,
+        .scl_speed_hz = TP_READER_FAST_HZ,
+    };
+    if (i2c_master_bus_add_device(bus, &fast_cfg, &fast_dev) == ESP_OK) {
+        read_dev = fast_dev;
+        stats.fast = true;
+    } else {
+        ESP_LOGW(TAG, "Fast-mode Plus device not added, reading at 400 kHz");
+        fast_dev = NULL;
+    }
+#else
+    (void)bus;
+    (void)addr;
+#endif
+    reset_bus_time();
+
+    tp_task_create(TP_TASK_READER, tp_reader_task, NULL, &tp_read_task_handle);
+}
@@ -0,0 +1,67 @@
+#ifndef TP_READER_H
+#define TP_READER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/i2c_master.h"
+
+#include "i2c/tp_frame.h"
+#include "i2c/hid_decoder.h"
+
+// INT-driven touch pad read engine. tp_gpio_isr_handler wakes the reader
+// task on the INT low level and masks it; the task reads frames while INT
+// stays low into a ring, wakes the driver task once per complete frame and
+// re-arms the interrupt. Neither task polls INT or waits on the bus.
+//
+// The ESP32-S2 I2C controller has no DMA and the IDF master driver cannot
+// start a transfer from an ISR, so the transfer runs in this task (which
+// sleeps on the driver's transfer-done interrupt meanwhile).
+//
+// Each read is wMaxInputLength bytes from the HID descriptor instead of
+// the whole buffer. A single read cannot be cut short by the length prefix
+// it returns, so the prefix only drops empty reports and bad reads.
+
+#define TP_READER_FRAME_LEN 64
+#define TP_READER_DEPTH     8           // power of two
+
+#define TP_READER_FAST_HZ   1000000     // CONFIG_TP_I2C_FAST_MODE_PLUS
+#define TP_READER_ERR_WINDOW 256        // reads per error rate check
+#define TP_READER_ERR_MAX   4           // errors per window that end Fast-mode Plus
+#define TP_READER_LOG_AFTER 1024        // frames before the bus time is logged
+
+typedef struct {
+    // [0..1] length prefix, then the report; the slack is never read into
+    uint8_t data[TP_READER_FRAME_LEN + HID_DECODER_SLACK];
+    uint8_t len;                // bytes valid, length prefix included
+    uint16_t capture_ticks;     // read complete, see tp_capture_ticks()
+    tp_trace_t trace;           // isr and read stamps
+} tp_reader_frame_t;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t empty;             // zero length reports
+    uint32_t errors;            // failed reads and bad length prefixes
+    uint32_t dropped;           // frame ring full
+    uint32_t bus_us_total;      // time spent in reads of delivered frames
+    uint16_t bus_us_max;
+    uint8_t read_len;
+    bool fast;                  // reading at TP_READER_FAST_HZ
+} tp_reader_stats_t;
+
+// max_input_len is the HID descriptor's wMaxInputLength, 0 when unknown.
+// addr is only used to add the Fast-mode Plus device.
+void tp_reader_start(i2c_master_bus_handle_t bus, i2c_master_dev_handle_t dev, uint16_t addr,
+                     uint16_t max_input_len);
+
+// Driver task side
+void tp_reader_set_consumer(TaskHandle_t task);
+void tp_reader_wake_consumer(void);
+const tp_reader_frame_t *tp_reader_peek(void);
+void tp_reader_release(void);
+
+void tp_reader_get_stats(tp_reader_stats_t *stats);
+
+#endif
@@ -0,0 +1,98 @@
+#include <stdlib.h>
+
+#include "i2c/tp_smooth.h"
+
+// One-Euro parameters. Cutoffs in mHz, BETA in mHz per unit/s of speed.
+#define EURO_MIN_CUTOFF     1500
+#define EURO_BETA           16
+#define EURO_D_CUTOFF       1000
+#define EURO_TAU_NUM        1591549     // 1e7 / (2 pi): tau in 100 us ticks = EURO_TAU_NUM / fc_mHz
+
+// Kalman noise, units^2 with 8 fractional bits: R of the controller's
+// coordinates, Q of the acceleration per report.
+#define KALMAN_R            (4 << 8)
+#define KALMAN_Q            (1 << 4)
+#define KALMAN_P11_START    (256 << 8)  // velocity unknown at touch down, up to 16 units/report
+
+#define DT_DEFAULT          80          // 8 ms when the scan time does not advance
+#define DT_MAX              500
+
+void tp_smooth_start(tp_smooth_t *s, tp_smooth_mode_t mode, uint16_t x, uint16_t y, uint16_t scan_time) {
+    s->x = (int32_t)x << 8;
+    s->y = (int32_t)y << 8;
+    s->vx = 0;
+    s->vy = 0;
+    s->p00 = KALMAN_R;
+    s->p01 = 0;
+    s->p11 = KALMAN_P11_START;
+    s->scan_time = scan_time;
+    s->mode = mode;
+}
+
+// Smoothing factor of a first order low pass, 16 fractional bits
+static int32_t euro_alpha(int32_t cutoff_mhz, int32_t dt) {
+    int32_t tau = EURO_TAU_NUM / (cutoff_mhz > 0 ? cutoff_mhz : 1);
+    return (int32_t)(((int64_t)dt << 16) / (dt + tau));
+}
+
+static void euro_axis(int32_t *pos, int32_t *vel, uint16_t raw, int32_t dt) {
+    int32_t err = ((int32_t)raw << 8) - *pos;
+
+    // Speed from the last filtered position, low passed at a fixed cutoff
+    int32_t rate = (int32_t)((int64_t)err * 10000 / dt);
+    *vel += (int32_t)(((int64_t)euro_alpha(EURO_D_CUTOFF, dt) * (rate - *vel)) >> 16);
+
+    int32_t cutoff = EURO_MIN_CUTOFF + ((EURO_BETA * (abs(*vel) >> 4)) >> 4);
+    *pos += (int32_t)(((int64_t)euro_alpha(cutoff, dt) * err) >> 16);
+}
+
+static void kalman_step(tp_smooth_t *s, uint16_t x, uint16_t y) {
+    // Predict
+    s->x += s->vx;
+    s->y += s->vy;
+    s->p00 += 2 * s->p01 + s->p11 + KALMAN_Q / 4;
+    s->p01 += s->p11 + KALMAN_Q / 2;
+    s->p11 += KALMAN_Q;
+
+    // Update, gains with 16 fractional bits
+    int32_t sum = s->p00 + KALMAN_R;
+    int32_t k0 = (int32_t)(((int64_t)s->p00 << 16) / sum);
+    int32_t k1 = (int32_t)(((int64_t)s->p01 << 16) / sum);
+
+    int32_t ex = ((int32_t)x << 8) - s->x;
+    int32_t ey = ((int32_t)y << 8) - s->y;
+    s->x += (int32_t)(((int64_t)k0 * ex) >> 16);
+    s->y += (int32_t)(((int64_t)k0 * ey) >> 16);
+    s->vx += (int32_t)(((int64_t)k1 * ex) >> 16);
+    s->vy += (int32_t)(((int64_t)k1 * ey) >> 16);
+
+    s->p11 -= (int32_t)(((int64_t)k1 * s->p01) >> 16);
+    s->p01 -= (int32_t)(((int64_t)k0 * s->p01) >> 16);
+    s->p00 -= (int32_t)(((int64_t)k0 * s->p00) >> 16);
+}
+
+void tp_smooth_step(tp_smooth_t *s, tp_smooth_mode_t mode, uint16_t x, uint16_t y, uint16_t scan_time) {
+    if (s->mode != mode) {
+        tp_smooth_start(s, mode, x, y, scan_time);
+        return;
+    }
+
+    int32_t dt = (uint16_t)(scan_time - s->scan_time);
+    if (dt == 0) dt = DT_DEFAULT;
+    if (dt > DT_MAX) dt = DT_MAX;
+    s->scan_time = scan_time;
+
+    switch (mode) {
+    case TP_SMOOTH_ONE_EURO:
+        euro_axis(&s->x, &s->vx, x, dt);
+        euro_axis(&s->y, &s->vy, y, dt);
+        break;
+    case TP_SMOOTH_KALMAN:
+        kalman_step(s, x, y);
+        break;
+    default:
+        s->x = (int32_t)x << 8;
+        s->y = (int32_t)y << 8;
+        break;
+    }
+}
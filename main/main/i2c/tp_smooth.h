@@ -0,0 +1,45 @@
+#ifndef TP_SMOOTH_H
+#define TP_SMOOTH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Position smoothing of one contact, the last stage of the per-contact
+// filter. TP_SMOOTH_IIR is the speed-adaptive IIR kept inline in
+// tp_filter, which both drivers use; the other two live here. Both use
+// integers only
+// (positions with 8 fractional bits) and no allocation.
+//
+// One-Euro: a low pass whose cutoff rises with the contact's speed, so a
+// resting finger is held still and a moving one lags little. dt comes from
+// the scan time (100 us units).
+//
+// Kalman: constant-velocity model, one step per report. Both axes share one
+// covariance since they have the same noise.
+
+typedef enum {
+    TP_SMOOTH_IIR = 0,
+    TP_SMOOTH_ONE_EURO = 1,
+    TP_SMOOTH_KALMAN = 2,
+    TP_SMOOTH_COUNT
+} tp_smooth_mode_t;
+
+typedef struct {
+    int32_t x;                  // filtered position, 8 fractional bits
+    int32_t y;
+    int32_t vx;                 // One-Euro: units/s; Kalman: units/report (8 fractional bits)
+    int32_t vy;
+    int32_t p00;                // Kalman covariance, units^2 with 8 fractional bits
+    int32_t p01;
+    int32_t p11;
+    uint16_t scan_time;
+    uint8_t mode;               // mode of the last step, TP_SMOOTH_IIR before the first
+} tp_smooth_t;
+
+// Seeds the state at touch down (or when the mode changes).
+void tp_smooth_start(tp_smooth_t *s, tp_smooth_mode_t mode, uint16_t x, uint16_t y, uint16_t scan_time);
+
+// Filters one raw position. Restarts from it when the mode changed.
+void tp_smooth_step(tp_smooth_t *s, tp_smooth_mode_t mode, uint16_t x, uint16_t y, uint16_t scan_time);
+
+#endif
@@ -0,0 +1,219 @@
+#include <string.h>
+
+#include "i2c/tp_tracker.h"
+
+#define GATE2       ((uint32_t)TP_TRACKER_GATE * TP_TRACKER_GATE)
+#define COST_NONE   UINT32_MAX
+#define TRACK_SETS  (1u << TP_MAX_CONTACTS)
+
+void tp_tracker_init(tp_tracker_t *tracker) {
+    memset(tracker, 0, sizeof(*tracker));
+}
+
+static uint32_t match_cost(const tp_track_t *t, const tp_raw_contact_t *c) {
+    int dx = (int)c->x - ((int)t->x + t->vx);
+    int dy = (int)c->y - ((int)t->y + t->vy);
+
+    if (dx <= -TP_TRACKER_GATE || dx >= TP_TRACKER_GATE ||
+        dy <= -TP_TRACKER_GATE || dy >= TP_TRACKER_GATE) return COST_NONE;
+
+    uint32_t d2 = (uint32_t)(dx * dx + dy * dy);
+    return d2 < GATE2 ? d2 : COST_NONE;
+}
+
+// Minimum total cost assignment of n contacts to the candidate tracks.
+// Leaving a contact unmatched costs GATE2, so any match inside the gate
+// beats starting a new track. match[k] is the track of contact k or -1.
+static void assign(const uint32_t cost[][TP_MAX_CONTACTS], uint8_t n, uint8_t candidates, int8_t *match) {
+    uint32_t best[TRACK_SETS], next[TRACK_SETS];
+    int8_t choice[TP_MAX_CONTACTS][TRACK_SETS];
+
+    for (uint32_t m = 0; m < TRACK_SETS; m++) best[m] = COST_NONE;
+    best[0] = 0;
+
+    // Only subsets of the candidate tracks are ever used
+    for (uint8_t k = 0; k < n; k++) {
+        for (uint32_t m = 0; m < TRACK_SETS; m++) next[m] = COST_NONE;
+
+        uint32_t m = candidates;
+        do {
+            if (best[m] != COST_NONE) {
+                if (best[m] + GATE2 < next[m]) {
+                    next[m] = best[m] + GATE2;
+                    choice[k][m] = -1;
+                }
+
+                uint8_t free = candidates & ~m;
+                for (int8_t t = 0; t < TP_MAX_CONTACTS; t++) {
+                    if (!(free & (1u << t)) || cost[k][t] == COST_NONE) continue;
+
+                    uint32_t c = best[m] + cost[k][t];
+                    uint32_t nm = m | (1u << t);
+                    if (c < next[nm]) {
+                        next[nm] = c;
+                        choice[k][nm] = t;
+                    }
+                }
+            }
+            m = (m - 1) & candidates;
+        } while (m != candidates);
+        memcpy(best, next, sizeof(best));
+    }
+
+    uint32_t m = 0;
+    for (uint32_t s = 1; s < TRACK_SETS; s++) {
+        if (best[s] < best[m]) m = s;
+    }
+    for (int k = n - 1; k >= 0; k--) {
+        match[k] = choice[k][m];
+        if (match[k] >= 0) m &= ~(1u << match[k]);
+    }
+}
+
+static void end_track(tp_tracker_t *tracker, uint8_t t, tp_track_update_t *update) {
+    tracker->active_mask &= ~(1u << t);
+    update->ended |= 1u << t;
+}
+
+static void move_track(tp_track_t *t, const tp_raw_contact_t *c, uint16_t scan_time, uint16_t now, uint8_t slot) {
+    t->vx = (int16_t)(c->x - t->x);
+    t->vy = (int16_t)(c->y - t->y);
+    t->x = c->x;
+    t->y = c->y;
+    t->scan_time = scan_time;
+    t->deadline = now + TP_TRACKER_TIMEOUT;
+    t->slot = slot;
+}
+
+void tp_tracker_update(tp_tracker_t *tracker, const tp_raw_frame_t *raw, uint16_t now,
+                       tp_track_update_t *update) {
+    bool full = (raw->slot_mask & (raw->slot_mask - 1)) != 0;
+    uint8_t slots[TP_MAX_CONTACTS];
+    uint8_t n = 0;
+
+    memset(update->track, TP_TRACK_NONE, sizeof(update->track));
+    update->started = 0;
+    update->ended = 0;
+
+    tracker->scan_time = raw->scan_time;
+    tracker->ticks = now;
+
+    for (uint8_t s = 0; s < TP_MAX_CONTACTS; s++) {
+        if (!(raw->slot_mask & (1u << s))) continue;
+
+        if (raw->contacts[s].tip_switch) {
+            slots[n++] = s;
+        } else if (!full) {
+            for (uint8_t t = 0; t < TP_MAX_CONTACTS; t++) {
+                if ((tracker->active_mask & (1u << t)) && tracker->tracks[t].slot == s) {
+                    update->track[s] = t;
+                    end_track(tracker, t, update);
+                    break;
+                }
+            }
+        }
+    }
+
+    uint8_t candidates = 0;
+    for (uint8_t t = 0; t < TP_MAX_CONTACTS; t++) {
+        if (!(tracker->active_mask & (1u << t))) continue;
+        if (full || tracker->tracks[t].scan_time != raw->scan_time) candidates |= 1u << t;
+    }
+
+    uint32_t cost[TP_MAX_CONTACTS][TP_MAX_CONTACTS];
+    int8_t match[TP_MAX_CONTACTS];
+    for (uint8_t k = 0; k < n; k++) {
+        for (uint8_t t = 0; t < TP_MAX_CONTACTS; t++) {
+            cost[k][t] = (candidates & (1u << t))
+                ? match_cost(&tracker->tracks[t], &raw->contacts[slots[k]]) : COST_NONE;
+        }
+    }
+    assign(cost, n, candidates, match);
+
+    // A contact that jumped out of the gate (a coordinate spike) stays on
+    // the unmatched track its slot fed last; the filters reject the spike,
+    // and the prediction does not follow it.
+    uint8_t taken = 0, jumped = 0;
+    for (uint8_t k = 0; k < n; k++) {
+        if (match[k] >= 0) taken |= 1u << match[k];
+    }
+    for (uint8_t k = 0; k < n; k++) {
+        if (match[k] >= 0) continue;
+        for (uint8_t t = 0; t < TP_MAX_CONTACTS; t++) {
+            if ((candidates & ~taken & (1u << t)) && tracker->tracks[t].slot == slots[k]) {
+                match[k] = t;
+                taken |= 1u << t;
+                jumped |= 1u << t;
+                break;
+            }
+        }
+    }
+
+    uint8_t matched = 0;
+    for (uint8_t k = 0; k < n; k++) {
+        if (match[k] < 0) continue;
+        tp_track_t *track = &tracker->tracks[match[k]];
+        move_track(track, &raw->contacts[slots[k]], raw->scan_time, now, slots[k]);
+        if (jumped & (1u << match[k])) {
+            track->vx = 0;
+            track->vy = 0;
+        }
+        update->track[slots[k]] = match[k];
+        matched |= 1u << match[k];
+    }
+
+    if (full) {
+        for (uint8_t t = 0; t < TP_MAX_CONTACTS; t++) {
+            if ((candidates & ~matched) & (1u << t)) end_track(tracker, t, update);
+        }
+    }
+
+    // New contacts take the lowest track that is neither in use nor being
+    // reported as lifted in this frame.
+    for (uint8_t k = 0; k < n; k++) {
+        if (match[k] >= 0) continue;
+
+        uint8_t busy = tracker->active_mask | update->ended;
+        if (busy == (1u << TP_MAX_CONTACTS) - 1) break;
+
+        uint8_t t = __builtin_ctz(~busy);
+        tp_track_t *track = &tracker->tracks[t];
+        track->x = raw->contacts[slots[k]].x;
+        track->y = raw->contacts[slots[k]].y;
+        track->vx = 0;
+        track->vy = 0;
+        track->scan_time = raw->scan_time;
+        track->deadline = now + TP_TRACKER_TIMEOUT;
+        track->slot = slots[k];
+
+        tracker->active_mask |= 1u << t;
+        update->started |= 1u << t;
+        update->track[slots[k]] = t;
+    }
+}
+
+bool tp_tracker_expire(tp_tracker_t *tracker, uint16_t now, tp_track_update_t *update) {
+    memset(update->track, TP_TRACK_NONE, sizeof(update->track));
+    update->started = 0;
+    update->ended = 0;
+
+    for (uint8_t t = 0; t < TP_MAX_CONTACTS; t++) {
+        if ((tracker->active_mask & (1u << t)) && (int16_t)(now - tracker->tracks[t].deadline) >= 0) {
+            end_track(tracker, t, update);
+        }
+    }
+    return update->ended != 0;
+}
+
+int32_t tp_tracker_ticks_left(const tp_tracker_t *tracker, uint16_t now) {
+    int32_t left = -1;
+
+    for (uint8_t t = 0; t < TP_MAX_CONTACTS; t++) {
+        if (!(tracker->active_mask & (1u << t))) continue;
+
+        int32_t d = (int16_t)(tracker->tracks[t].deadline - now);
+        if (d < 0) d = 0;
+        if (left < 0 || d < left) left = d;
+    }
+    return left;
+}
@@ -0,0 +1,75 @@
+#ifndef TP_TRACKER_H
+#define TP_TRACKER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c/tp_frame.h"
+
+// Follows contacts across reports independently of the controller's slot
+// numbers. Each touching contact is matched to the track whose predicted
+// position (last position + last step) is nearest, as one minimum-cost
+// assignment over all contacts of the report; a contact further than
+// TP_TRACKER_GATE from every free track starts a new one. The solver is a
+// dynamic program over the set of used tracks, (contacts + 1) * 2^N states
+// for N = TP_MAX_CONTACTS, so a report costs the same bounded time however
+// the fingers move.
+//
+// A track's index is its contact ID for the whole touch: filters keep their
+// state per track and the frame reports the contact in fingers[track].
+//
+// A report carrying several slots is taken as the full contact list, and
+// tracks without a touching contact in it end. A one-contact report (hybrid
+// mode) only updates its own contact; tracks already updated in the same
+// scan are not matched again, and a tip-up contact ends the track last fed
+// by its slot.
+//
+// Every update moves a track's deadline TP_TRACKER_TIMEOUT ticks ahead.
+// A contact the controller stops reporting without a tip-up (lost INT,
+// missed report) ends at its deadline through tp_tracker_expire. Times are
+// capture ticks (100 us, see tp_capture_ticks), compared modulo 2^16.
+
+#define TP_TRACKER_GATE     400         // logical units per report
+#define TP_TRACKER_TIMEOUT  250         // 25 ms, three reports at 125 Hz
+#define TP_TRACK_NONE       0xFF
+
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+    int16_t vx;                 // last step, per update
+    int16_t vy;
+    uint16_t scan_time;         // scan of the last update
+    uint16_t deadline;          // capture ticks
+    uint8_t slot;               // controller slot of the last update
+} tp_track_t;
+
+typedef struct {
+    tp_track_t tracks[TP_MAX_CONTACTS];
+    uint8_t active_mask;
+    uint16_t scan_time;         // last report
+    uint16_t ticks;
+} tp_tracker_t;
+
+typedef struct {
+    uint8_t track[TP_MAX_CONTACTS];     // track per controller slot, TP_TRACK_NONE if none
+    uint8_t started;                    // tracks that began with this report
+    uint8_t ended;                      // tracks that ended, to be reported tip up once
+} tp_track_update_t;
+
+void tp_tracker_init(tp_tracker_t *tracker);
+void tp_tracker_update(tp_tracker_t *tracker, const tp_raw_frame_t *raw, uint16_t now,
+                       tp_track_update_t *update);
+
+// Ends the tracks whose deadline has passed (update->ended). Returns false
+// when none did.
+bool tp_tracker_expire(tp_tracker_t *tracker, uint16_t now, tp_track_update_t *update);
+
+// Ticks until the next deadline (0 when one is due), or -1 when no contact
+// is tracked.
+int32_t tp_tracker_ticks_left(const tp_tracker_t *tracker, uint16_t now);
+
+// Scan time for a frame built at now, continuing the controller's clock
+static inline uint16_t tp_tracker_scan_time(const tp_tracker_t *tracker, uint16_t now) {
+    return tracker->scan_time + (uint16_t)(now - tracker->ticks);
+}
+
+#endif
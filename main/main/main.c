@@ -3,6 +3,7 @@
 #include "usb/usbhid.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_task.h"
 #include "tinyusb.h"
 #include "nvs/ptp_nvs.h"
 #include "wireless/wireless.h"
@@ -10,37 +11,48 @@
 #include "sdkconfig.h"
 
 #include "i2c/I2C_HID_Report.h"
+#include "i2c/tp_driver.h"
+#include "i2c/tp_pipe.h"
+#include "trace/tp_capture.h"
+#include "trace/tp_log.h"
+#include "tp_boot.h"
+#include "tp_mode.h"
+#include "tp_tasks.h"
 
 void app_main(void) {
 
-    i2c_tp_init();
+    tp_boot_init();
+    tp_log_init();
+
+    // The model decides the USB descriptor. Probing only addresses the
+    // candidates and keeps the one that answers running; without a probe,
+    // the reset pulse starts here and ends in tp_driver_init
+    tp_driver_select();
+    ptp_report_desc_set_model(tp_driver);
     i2c_tp_int_init();
 
-    ESP_ERROR_CHECK(nvs_mode_init());
-    
-    current_mode = MOUSE_MODE;
-    
-    tp_queue = xQueueCreate(1, sizeof(tp_multi_msg_t));
-    mouse_queue = xQueueCreate(1, sizeof(mouse_msg_t));
-
-    main_queue_set = xQueueCreateSet(1 + 1);
-    xQueueAddToSet(mouse_queue, main_queue_set);
-    xQueueAddToSet(tp_queue, main_queue_set);
-
-    usb_event_group = xEventGroupCreate();
-    
-    xTaskCreate(usb_mount_task, "mode_sel", 4096, NULL, 11, NULL);
-    
-    vbus_det_init();
+    tp_pipe_init();
+
+    // Before USB and the radio, which post mode events
+    tp_mode_init();
 
     usbhid_init();
 
-    xTaskCreate(tp_i2c_task, "i2c_task", 4096, NULL, 10, NULL);
+    ESP_ERROR_CHECK(nvs_mode_init());
+
+    vbus_det_init();
+
+    tp_capture_init();
 
-    xTaskCreate(usbhid_task, "hid", 4096, NULL, 12, NULL);
+    TaskHandle_t hid_task_handle = NULL;
+    tp_task_create(TP_TASK_HID, usbhid_task, NULL, &hid_task_handle);
+    tp_pipe_set_consumer(hid_task_handle);
 
-    while (1) {
-        tud_task(); 
-        vTaskDelay(pdMS_TO_TICKS(1)); 
-    }
-}
\ No newline at end of file
+    // The controller boots while the host enumerates and Wi-Fi starts.
+    // Its bring-up mostly polls, but runs above the vbus task so the
+    // radio init only fills the gaps.
+    vTaskPrioritySet(NULL, tp_tasks[TP_TASK_DRIVER].priority);
+    tp_driver_init();
+    tp_task_create(TP_TASK_DRIVER, tp_driver->task, NULL, NULL);
+    vTaskPrioritySet(NULL, ESP_TASK_MAIN_PRIO);
+}
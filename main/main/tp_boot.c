@@ -0,0 +1,62 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+
+#include "tp_boot.h"
+#include "trace/tp_log.h"
+
+static const char *TAG = "TP_BOOT";
+
+_Static_assert(4 + TP_BOOT_STEP_COUNT * 4 <= TP_BOOT_REPORT_LEN, "boot timeline does not fit the feature report");
+
+static const char *const step_names[TP_BOOT_STEP_COUNT] = {
+    [TP_BOOT_APP_MAIN]    = "app_main",
+    [TP_BOOT_USB_STARTED] = "USB started",
+    [TP_BOOT_TOUCH_RESET] = "touch reset",
+    [TP_BOOT_TOUCH_READY] = "touch ready",
+    [TP_BOOT_USB_MOUNTED] = "USB mounted",
+    [TP_BOOT_RADIO_READY] = "radio ready",
+};
+
+// Each step is marked from one place only
+static uint32_t step_us[TP_BOOT_STEP_COUNT];
+static StaticEventGroup_t events_buf;
+static EventGroupHandle_t events;
+
+void tp_boot_init(void) {
+    events = xEventGroupCreateStatic(&events_buf);
+    tp_boot_mark(TP_BOOT_APP_MAIN);
+}
+
+void tp_boot_mark(tp_boot_step_t step) {
+    if (step_us[step] != 0) return;
+
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    step_us[step] = now ? now : 1;
+    xEventGroupSetBits(events, 1 << step);
+    TP_LOGI(TAG, "%s at %lu us", step_names[step], (unsigned long)step_us[step]);
+}
+
+void tp_boot_wait(tp_boot_step_t step) {
+    xEventGroupWaitBits(events, 1 << step, pdFALSE, pdTRUE, portMAX_DELAY);
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+uint16_t tp_boot_get_report(uint8_t *buffer, uint16_t reqlen) {
+    if (reqlen < TP_BOOT_REPORT_LEN) return 0;
+
+    memset(buffer, 0, TP_BOOT_REPORT_LEN);
+    buffer[1] = TP_BOOT_REPORT_VERSION;
+    buffer[2] = TP_BOOT_STEP_COUNT;
+    for (int s = 0; s < TP_BOOT_STEP_COUNT; s++) {
+        put32(&buffer[4 + s * 4], step_us[s]);
+    }
+    return TP_BOOT_REPORT_LEN;
+}
@@ -0,0 +1,40 @@
+#ifndef TP_BOOT_H
+#define TP_BOOT_H
+
+#include <stdint.h>
+
+// Boot timeline. app_main starts USB enumeration, the radio (brought up by
+// the vbus task) and the touch controller without one waiting for the
+// other; each marks its step here when done. Work that needs a step, like
+// switching the controller's mode, waits for it with tp_boot_wait().
+// Times are from esp_timer start, after the ROM and second stage
+// bootloader.
+typedef enum {
+    TP_BOOT_APP_MAIN = 0,       // app_main entered
+    TP_BOOT_USB_STARTED,        // TinyUSB installed, the host may enumerate
+    TP_BOOT_TOUCH_RESET,        // controller answers, at the probe or after its reset pulse
+    TP_BOOT_TOUCH_READY,        // layout loaded, reader running
+    TP_BOOT_USB_MOUNTED,        // host configured the device
+    TP_BOOT_RADIO_READY,        // Wi-Fi and ESP-NOW up
+    TP_BOOT_STEP_COUNT
+} tp_boot_step_t;
+
+// Feature report page (generic HID instance 0), little endian:
+//   [0]     page (GENERIC_FEATURE_PAGE_BOOT)
+//   [1]     TP_BOOT_REPORT_VERSION
+//   [2]     TP_BOOT_STEP_COUNT
+//   [3]     reserved
+//   [4..]   uint32 us per step, tp_boot_step_t order, 0 = not reached
+#define TP_BOOT_REPORT_VERSION 1
+#define TP_BOOT_REPORT_LEN     64
+
+// First thing in app_main; marks TP_BOOT_APP_MAIN
+void tp_boot_init(void);
+
+// Only the first mark of a step counts
+void tp_boot_mark(tp_boot_step_t step);
+void tp_boot_wait(tp_boot_step_t step);
+
+uint16_t tp_boot_get_report(uint8_t *buffer, uint16_t reqlen);
+
+#endif
@@ -0,0 +1,218 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "esp_now.h"
+
+#include "i2c/I2C_HID_Report.h"
+#include "i2c/tp_driver.h"
+#include "wireless/wireless.h"
+#include "wl_proto.h"
+#include "trace/tp_log.h"
+#include "tp_boot.h"
+#include "tp_mode.h"
+#include "tp_tasks.h"
+
+static const char *TAG = "TP_MODE";
+
+#define TP_MODE_QUEUE_LEN   8
+#define HOST_INPUT_MODE_PTP 0x03
+#define MODE_UNKNOWN        0xFF
+
+typedef struct {
+    uint8_t source;             // tp_mode_source_t
+    uint8_t value;
+    uint8_t token;
+    uint32_t at_us;
+} tp_mode_event_t;
+
+static QueueHandle_t events;
+
+// mode_sel task only
+static uint8_t host_mode = 0x00;
+static uint8_t radio_mode = MOUSE_MODE;
+// Mode the controller was last switched to. current_mode starts as mouse
+// for the USB and radio side, but nothing has told the controller yet.
+static uint8_t controller_mode = MODE_UNKNOWN;
+
+volatile uint8_t tp_mode_frame_mode = MOUSE_MODE;
+
+// Written by mode_sel; switch_at_us is cleared by the driver task once
+// the first frame of the new mode arrives
+static uint32_t switch_at_us;
+static portMUX_TYPE switch_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t last_source = TP_MODE_SRC_NONE;
+static uint32_t switches, failures;
+static uint32_t command_us, command_max_us;
+static uint32_t frame_us, frame_max_us;
+
+static void post(uint8_t source, uint8_t value, uint8_t token) {
+    if (events == NULL) return;
+
+    tp_mode_event_t ev = {
+        .source = source,
+        .value = value,
+        .token = token,
+        .at_us = (uint32_t)esp_timer_get_time(),
+    };
+    if (xQueueSend(events, &ev, 0) != pdTRUE) {
+        TP_LOGW(TAG, "Event queue full, source %u dropped", source);
+    }
+}
+
+void tp_mode_host(uint8_t input_mode) {
+    post(TP_MODE_SRC_HOST, input_mode, 0);
+}
+
+void tp_mode_radio(uint8_t mode, uint8_t token) {
+    post(TP_MODE_SRC_RADIO, mode, token);
+}
+
+void tp_mode_vbus(void) {
+    post(TP_MODE_SRC_VBUS, 0, 0);
+}
+
+void tp_mode_controller_reset(void) {
+    post(TP_MODE_SRC_RESET, 0, 0);
+}
+
+void tp_mode_frame_changed(uint8_t mode) {
+    uint32_t now = (uint32_t)esp_timer_get_time();
+
+    portENTER_CRITICAL(&switch_lock);
+    tp_mode_frame_mode = mode;
+    if (switch_at_us != 0 && mode == current_mode) {
+        frame_us = now - switch_at_us;
+        if (frame_us > frame_max_us) frame_max_us = frame_us;
+        switch_at_us = 0;
+    }
+    portEXIT_CRITICAL(&switch_lock);
+}
+
+static uint8_t target_mode(void) {
+    if (wireless_mode == 1) {
+        return host_mode == HOST_INPUT_MODE_PTP ? PTP_MODE : MOUSE_MODE;
+    }
+    return radio_mode;
+}
+
+static void send_ack(uint8_t token, bool ok) {
+    mode_ack_msg_t ack = {
+        .mode = current_mode,
+        .token = token,
+        .ok = ok,
+    };
+    uint8_t pkt[WL_PROTO_MAX_PACKET];
+    size_t len = wl_encode_status(WL_PKT_MODE_ACK, &ack, sizeof(ack), pkt);
+    esp_now_send(receiver_mac, pkt, len);
+}
+
+// Switches the controller, then publishes the mode. A failed command
+// leaves current_mode alone and the controller's mode unknown, so the next
+// event tries again.
+static bool apply(uint8_t target, const tp_mode_event_t *ev) {
+    if (target == controller_mode) return true;
+
+    esp_err_t ret = target == PTP_MODE ? tp_driver->activate_ptp() : tp_driver->activate_mouse();
+    uint32_t took = (uint32_t)esp_timer_get_time() - ev->at_us;
+
+    if (ret != ESP_OK) {
+        controller_mode = MODE_UNKNOWN;
+        failures++;
+        TP_LOGW(TAG, "Switch to mode %u failed: %s", target, esp_err_to_name(ret));
+        return false;
+    }
+
+    controller_mode = target;
+    portENTER_CRITICAL(&switch_lock);
+    current_mode = target;
+    if (tp_mode_frame_mode == target) {
+        // Frames of the new mode were decoded while the command ran
+        frame_us = took;
+        if (frame_us > frame_max_us) frame_max_us = frame_us;
+        switch_at_us = 0;
+    } else {
+        switch_at_us = ev->at_us ? ev->at_us : 1;
+    }
+    portEXIT_CRITICAL(&switch_lock);
+
+    switches++;
+    last_source = ev->source;
+    command_us = took;
+    if (took > command_max_us) command_max_us = took;
+
+    TP_LOGI(TAG, "%s mode (source %u) in %lu us", target == PTP_MODE ? "PTP" : "Mouse",
+            ev->source, (unsigned long)took);
+    return true;
+}
+
+static void tp_mode_task(void *arg) {
+    // The host and the receiver may set a mode while the controller is
+    // still booting; the queue keeps it until then
+    tp_boot_wait(TP_BOOT_TOUCH_READY);
+
+    tp_mode_event_t ev;
+    while (1) {
+        xQueueReceive(events, &ev, portMAX_DELAY);
+
+        switch (ev.source) {
+        case TP_MODE_SRC_HOST:
+            host_mode = ev.value;
+            break;
+        case TP_MODE_SRC_RADIO:
+            if (ev.value == PTP_MODE || ev.value == MOUSE_MODE) radio_mode = ev.value;
+            break;
+        case TP_MODE_SRC_RESET:
+            controller_mode = MODE_UNKNOWN;
+            break;
+        default:
+            break;
+        }
+
+        bool ok = apply(target_mode(), &ev);
+
+        if (ev.source == TP_MODE_SRC_RADIO) {
+            send_ack(ev.token, ok);
+        }
+    }
+}
+
+void tp_mode_init(void) {
+    events = xQueueCreate(TP_MODE_QUEUE_LEN, sizeof(tp_mode_event_t));
+    tp_task_create(TP_TASK_MODE_SEL, tp_mode_task, NULL, NULL);
+}
+
+void tp_mode_reset(void) {
+    switches = 0;
+    failures = 0;
+    command_us = 0;
+    command_max_us = 0;
+    frame_us = 0;
+    frame_max_us = 0;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+uint16_t tp_mode_get_report(uint8_t *buffer, uint16_t reqlen) {
+    if (reqlen < TP_MODE_REPORT_LEN) return 0;
+
+    memset(buffer, 0, TP_MODE_REPORT_LEN);
+    buffer[1] = TP_MODE_REPORT_VERSION;
+    buffer[2] = current_mode;
+    buffer[3] = host_mode;
+    buffer[4] = radio_mode;
+    buffer[5] = last_source;
+    put32(&buffer[8], switches);
+    put32(&buffer[12], failures);
+    put32(&buffer[16], command_us);
+    put32(&buffer[20], command_max_us);
+    put32(&buffer[24], frame_us);
+    put32(&buffer[28], frame_max_us);
+    return TP_MODE_REPORT_LEN;
+}
@@ -0,0 +1,64 @@
+#ifndef TP_MODE_H
+#define TP_MODE_H
+
+#include <stdint.h>
+
+// Input mode state machine. The host's SET_REPORT, VBUS edges and the
+// receiver's mode commands only post events; the mode_sel task is the
+// one place that switches the controller and writes current_mode, so a
+// transition is the controller command and the new mode together. Wired
+// the host's input mode decides, wireless the receiver's last command.
+//
+// Each switch is timed from the event to the controller accepting the
+// command, and to the first frame of the new mode the driver decodes
+// (this one needs a finger on the pad to mean anything).
+typedef enum {
+    TP_MODE_SRC_NONE = 0,
+    TP_MODE_SRC_HOST,           // SET_REPORT input mode, attach or detach
+    TP_MODE_SRC_RADIO,          // receiver mode command
+    TP_MODE_SRC_VBUS,           // cable plugged or unplugged
+    TP_MODE_SRC_RESET,          // controller (re)initialised, mode unknown
+} tp_mode_source_t;
+
+// Feature report page (generic HID instance 0), little endian:
+//   [0]      page (GENERIC_FEATURE_PAGE_MODE)
+//   [1]      TP_MODE_REPORT_VERSION
+//   [2]      current_mode (input_mode_t)
+//   [3]      host input mode (0x03 = PTP)
+//   [4]      receiver's mode (input_mode_t)
+//   [5]      source of the last switch (tp_mode_source_t)
+//   [6..7]   reserved
+//   [8..11]  switches
+//   [12..15] failed switches
+//   [16..19] last event to controller accepted, us
+//   [20..23] max of the above, us
+//   [24..27] last event to first frame of the new mode, us
+//   [28..31] max of the above, us
+#define TP_MODE_REPORT_VERSION 1
+#define TP_MODE_REPORT_LEN     64
+
+// Creates the mode_sel task; switches wait for TP_BOOT_TOUCH_READY
+void tp_mode_init(void);
+
+// Event sources. Safe from any task; they never block.
+void tp_mode_host(uint8_t input_mode);
+void tp_mode_radio(uint8_t mode, uint8_t token);
+void tp_mode_vbus(void);
+
+// The driver (re)initialised the controller, which is back in its own
+// default mode: the mode is sent again even if it did not change.
+void tp_mode_controller_reset(void);
+
+// Mode of the frames the driver task last decoded, written by it only
+extern volatile uint8_t tp_mode_frame_mode;
+void tp_mode_frame_changed(uint8_t mode);
+
+// Driver tasks, per decoded frame (PTP_MODE or MOUSE_MODE)
+static inline void tp_mode_frame(uint8_t mode) {
+    if (mode != tp_mode_frame_mode) tp_mode_frame_changed(mode);
+}
+
+void tp_mode_reset(void);
+uint16_t tp_mode_get_report(uint8_t *buffer, uint16_t reqlen);
+
+#endif
@@ -0,0 +1,38 @@
+#include "tp_tasks.h"
+
+#if CONFIG_TP_TASK_PLAN_LEGACY
+
+const tp_task_config_t tp_tasks[TP_TASK_COUNT] = {
+    [TP_TASK_READER]    = { "tp_reader",  11, 3072, 500 },
+    [TP_TASK_DRIVER]    = { "i2c_task",   10, 4096, 500 },
+    [TP_TASK_HID]       = { "hid",        12, 4096, 500 },
+    [TP_TASK_USB]       = { "TinyUSB",    13, 4096, 0 },
+    [TP_TASK_MODE_SEL]  = { "mode_sel",   11, 4096, 0 },
+    [TP_TASK_VBUS]      = { "vbus_task",   5, 4096, 0 },
+    [TP_TASK_CAPTURE]   = { "tp_capture",  3, 3072, 0 },
+    [TP_TASK_HEARTBEAT] = { "heartbeat",   2, 2048, 0 },
+    [TP_TASK_LOG]       = { "tp_log",      1, 3072, 0 },
+    [TP_TASK_STRESS]    = { "stress",      9, 2560, 0 },
+};
+
+#else
+
+const tp_task_config_t tp_tasks[TP_TASK_COUNT] = {
+    [TP_TASK_READER]    = { "tp_reader",  15, 3072, 500 },
+    [TP_TASK_DRIVER]    = { "i2c_task",   13, 4096, 500 },
+    [TP_TASK_HID]       = { "hid",        14, 4096, 500 },
+    [TP_TASK_USB]       = { "TinyUSB",    12, 4096, 0 },
+    [TP_TASK_MODE_SEL]  = { "mode_sel",   11, 4096, 0 },
+    [TP_TASK_VBUS]      = { "vbus_task",   5, 4096, 0 },
+    [TP_TASK_CAPTURE]   = { "tp_capture",  3, 3072, 0 },
+    [TP_TASK_HEARTBEAT] = { "heartbeat",   2, 2048, 0 },
+    [TP_TASK_LOG]       = { "tp_log",      1, 3072, 0 },
+    [TP_TASK_STRESS]    = { "stress",      9, 2560, 0 },
+};
+
+#endif
+
+BaseType_t tp_task_create(tp_task_id_t id, TaskFunction_t fn, void *arg, TaskHandle_t *handle) {
+    const tp_task_config_t *t = &tp_tasks[id];
+    return xTaskCreate(fn, t->name, t->stack, arg, t->priority, handle);
+}
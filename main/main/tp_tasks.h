@@ -0,0 +1,59 @@
+#ifndef TP_TASKS_H
+#define TP_TASKS_H
+
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "sdkconfig.h"
+
+// Every task of the firmware with its priority, stack and timing budget, in
+// one table (tp_tasks.c). The ESP32-S2 has a single core, so the priorities
+// alone decide who waits for whom.
+//
+// The touch path comes first: tp_reader (I2C read after the INT edge),
+// usbhid_task (USB / ESP-NOW submit) and the driver task (decode and
+// filter), each woken by the stage before it. usbhid_task is ranked above
+// the driver so a queued frame is submitted before the next one is
+// filtered. TinyUSB, VBUS, capture, heartbeat and log work can wait a few
+// hundred microseconds. mode_sel (tp_mode.h) sleeps until an event and
+// sits right under TinyUSB, so a mode the host sets is applied before the
+// next frame. The Wi-Fi task (23), esp_timer (22) and the event loop (20)
+// belong to IDF and stay above everything here: a busy radio still
+// preempts the touch path, which is why each touch stage has a budget for
+// how long it may wait after being woken (see trace/tp_sched.h).
+//
+// CONFIG_TP_TASK_PLAN_LEGACY restores the old ad-hoc priorities, for
+// before/after runs of main/host/tp_sched.py --stress.
+
+typedef enum {
+    // Touch path stages, measured by tp_sched
+    TP_TASK_READER = 0,
+    TP_TASK_DRIVER,
+    TP_TASK_HID,
+    TP_TASK_STAGE_COUNT,
+
+    TP_TASK_USB = TP_TASK_STAGE_COUNT,  // created by esp_tinyusb
+    TP_TASK_MODE_SEL,
+    TP_TASK_VBUS,
+    TP_TASK_CAPTURE,
+    TP_TASK_HEARTBEAT,
+    TP_TASK_LOG,                // trace/tp_log.h drain
+    TP_TASK_STRESS,             // CONFIG_TP_SCHED_STRESS radio load
+    TP_TASK_COUNT
+} tp_task_id_t;
+
+typedef struct {
+    const char *name;
+    UBaseType_t priority;
+    uint32_t stack;             // bytes
+    uint16_t budget_us;         // longest wake delay of a touch stage, 0 = none
+} tp_task_config_t;
+
+extern const tp_task_config_t tp_tasks[TP_TASK_COUNT];
+
+// xTaskCreate with the table's name, priority and stack
+BaseType_t tp_task_create(tp_task_id_t id, TaskFunction_t fn, void *arg, TaskHandle_t *handle);
+
+#endif
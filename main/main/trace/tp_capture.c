@@ -0,0 +1,155 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/stream_buffer.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "sdkconfig.h"
+
+#if CONFIG_TP_CAPTURE_TRANSPORT_UART
+#include "driver/uart.h"
+#else
+#include "tusb.h"
+#endif
+
+#include "trace/tp_capture.h"
+#include "tp_tasks.h"
+
+static const char *TAG = "TP_CAPTURE";
+
+volatile bool tp_capture_running = false;
+
+static StreamBufferHandle_t capture_stream = NULL;
+static tp_capture_model_t capture_model = TP_CAPTURE_MODEL_UNKNOWN;
+static const hid_tp_layout_t *capture_layout = NULL;
+static volatile bool header_pending = false;
+static uint32_t capture_frames = 0;
+static uint32_t capture_dropped = 0;
+
+// Only the touch pad task writes to the stream buffer (it has a single
+// writer), so the header is queued from there on the first frame.
+static bool write_header(void) {
+    uint8_t buf[sizeof(tp_capture_header_t) + sizeof(hid_tp_layout_t)] = {0};
+    tp_capture_header_t hdr = {
+        .magic = TP_CAPTURE_MAGIC,
+        .version = TP_CAPTURE_VERSION,
+        .model = capture_model,
+        .layout_size = sizeof(hid_tp_layout_t),
+    };
+    memcpy(buf, &hdr, sizeof(hdr));
+    if (capture_layout) memcpy(buf + sizeof(hdr), capture_layout, sizeof(hid_tp_layout_t));
+
+    if (xStreamBufferSpacesAvailable(capture_stream) < sizeof(buf)) return false;
+    xStreamBufferSend(capture_stream, buf, sizeof(buf), 0);
+    return true;
+}
+
+void tp_capture_record(const uint8_t *data, size_t len) {
+    int64_t now = esp_timer_get_time();
+
+    if (header_pending) {
+        if (!write_header()) {
+            capture_dropped++;
+            return;
+        }
+        header_pending = false;
+    }
+
+    // Keep only the bytes the controller announced in the HID-over-I2C
+    // length prefix; fall back to the whole buffer if it looks wrong.
+    size_t n = data[0] | (data[1] << 8);
+    if (len > TP_CAPTURE_FRAME_MAX) len = TP_CAPTURE_FRAME_MAX;
+    if (n < 2 || n > len) n = len;
+
+    uint8_t buf[sizeof(tp_capture_record_t) + TP_CAPTURE_FRAME_MAX];
+    tp_capture_record_t rec = {
+        .sync = TP_CAPTURE_SYNC,
+        .len = (uint8_t)n,
+        .timestamp_us = (uint32_t)now,
+    };
+    memcpy(buf, &rec, sizeof(rec));
+    memcpy(buf + sizeof(rec), data, n);
+
+    if (xStreamBufferSpacesAvailable(capture_stream) < sizeof(rec) + n) {
+        capture_dropped++;
+        return;
+    }
+    xStreamBufferSend(capture_stream, buf, sizeof(rec) + n, 0);
+    capture_frames++;
+}
+
+static void tp_capture_task(void *arg) {
+    uint8_t chunk[1 + TP_CAPTURE_HID_CHUNK];
+
+    while (1) {
+        size_t n = xStreamBufferReceive(capture_stream, &chunk[1], TP_CAPTURE_HID_CHUNK, portMAX_DELAY);
+        if (n == 0) continue;
+
+#if CONFIG_TP_CAPTURE_TRANSPORT_UART
+        uart_write_bytes(CONFIG_TP_CAPTURE_UART_NUM, &chunk[1], n);
+#else
+        chunk[0] = (uint8_t)n;
+        memset(&chunk[1 + n], 0, TP_CAPTURE_HID_CHUNK - n);
+
+        while (tud_mounted() && !tud_hid_n_ready(0)) {
+            vTaskDelay(pdMS_TO_TICKS(1));
+        }
+        if (tud_mounted()) {
+            tud_hid_n_report(0, 0, chunk, sizeof(chunk));
+        }
+#endif
+    }
+}
+
+void tp_capture_set_source(tp_capture_model_t model, const hid_tp_layout_t *layout) {
+    capture_model = model;
+    capture_layout = layout;
+}
+
+void tp_capture_start(void) {
+    if (capture_stream == NULL || tp_capture_running) return;
+
+    capture_frames = 0;
+    capture_dropped = 0;
+    header_pending = true;
+    tp_capture_running = true;
+    ESP_LOGI(TAG, "Capture started (model %d)", capture_model);
+}
+
+void tp_capture_stop(void) {
+    if (!tp_capture_running) return;
+
+    tp_capture_running = false;
+    ESP_LOGI(TAG, "Capture stopped: %lu frames, %lu dropped",
+             (unsigned long)capture_frames, (unsigned long)capture_dropped);
+}
+
+void tp_capture_init(void) {
+    capture_stream = xStreamBufferCreate(CONFIG_TP_CAPTURE_BUFFER_SIZE, 1);
+    if (capture_stream == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate %d byte capture buffer", CONFIG_TP_CAPTURE_BUFFER_SIZE);
+        return;
+    }
+
+#if CONFIG_TP_CAPTURE_TRANSPORT_UART
+    uart_config_t uart_cfg = {
+        .baud_rate = CONFIG_TP_CAPTURE_UART_BAUD,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_SCLK_DEFAULT,
+    };
+    ESP_ERROR_CHECK(uart_driver_install(CONFIG_TP_CAPTURE_UART_NUM, 256, 2048, 0, NULL, 0));
+    ESP_ERROR_CHECK(uart_param_config(CONFIG_TP_CAPTURE_UART_NUM, &uart_cfg));
+    ESP_ERROR_CHECK(uart_set_pin(CONFIG_TP_CAPTURE_UART_NUM, CONFIG_TP_CAPTURE_UART_TX_GPIO,
+                                 UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
+#endif
+
+    tp_task_create(TP_TASK_CAPTURE, tp_capture_task, NULL, NULL);
+
+#if CONFIG_TP_CAPTURE_AUTOSTART
+    tp_capture_start();
+#endif
+}
@@ -0,0 +1,36 @@
+#ifndef TP_CAPTURE_H
+#define TP_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "sdkconfig.h"
+#include "trace/tp_capture_format.h"
+
+#if CONFIG_TP_CAPTURE
+
+extern volatile bool tp_capture_running;
+
+void tp_capture_init(void);
+void tp_capture_set_source(tp_capture_model_t model, const hid_tp_layout_t *layout);
+void tp_capture_start(void);
+void tp_capture_stop(void);
+void tp_capture_record(const uint8_t *data, size_t len);
+
+// Called by the touch pad task right after every successful I2C read.
+static inline void tp_capture_frame(const uint8_t *data, size_t len) {
+    if (tp_capture_running) tp_capture_record(data, len);
+}
+
+#else
+
+static inline void tp_capture_init(void) {}
+static inline void tp_capture_set_source(tp_capture_model_t model, const hid_tp_layout_t *layout) { (void)model; (void)layout; }
+static inline void tp_capture_start(void) {}
+static inline void tp_capture_stop(void) {}
+static inline void tp_capture_frame(const uint8_t *data, size_t len) { (void)data; (void)len; }
+
+#endif
+
+#endif
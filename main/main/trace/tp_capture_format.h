@@ -0,0 +1,45 @@
+#ifndef TP_CAPTURE_FORMAT_H
+#define TP_CAPTURE_FORMAT_H
+
+#include <stdint.h>
+#include "i2c/hid_decoder.h"
+
+// Raw I2C capture stream, shared with the host replay tool:
+//
+//   tp_capture_header_t, hid_tp_layout_t (layout_size bytes)
+//   { tp_capture_record_t, len bytes of the i2c_master_receive buffer } ...
+//
+// All fields little endian. Over HID the stream is cut into 64-byte input
+// reports on the generic interface: byte 0 is the number of stream bytes
+// that follow (at most TP_CAPTURE_HID_CHUNK), the rest is padding.
+
+#define TP_CAPTURE_MAGIC        0x50414354u     // "TCAP"
+#define TP_CAPTURE_VERSION      1
+#define TP_CAPTURE_SYNC         0xA5
+#define TP_CAPTURE_FRAME_MAX    64
+#define TP_CAPTURE_HID_CHUNK    63
+
+typedef enum {
+    TP_CAPTURE_MODEL_UNKNOWN = 0,
+    TP_CAPTURE_MODEL_ELAN_33370A = 1,
+    TP_CAPTURE_MODEL_GOODIX_GT7863 = 2,
+} tp_capture_model_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t model;              // tp_capture_model_t
+    uint16_t layout_size;       // sizeof(hid_tp_layout_t) following the header
+} tp_capture_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t sync;
+    uint8_t len;                // buffer bytes following the record header
+    uint32_t timestamp_us;      // esp_timer_get_time() after the read, wraps after ~71 min
+} tp_capture_record_t;
+
+// The layout is embedded as raw struct bytes; the firmware and the host
+// must agree on its shape.
+_Static_assert(sizeof(hid_tp_layout_t) == 348, "hid_tp_layout_t changed, bump TP_CAPTURE_VERSION");
+
+#endif
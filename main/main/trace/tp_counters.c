@@ -0,0 +1,29 @@
+#include <string.h>
+#include "esp_timer.h"
+
+#include "trace/tp_counters.h"
+
+_Static_assert(8 + TP_CNT_COUNT * 4 <= TP_COUNTERS_REPORT_LEN, "counters do not fit the feature report");
+
+volatile uint32_t tp_counters[TP_CNT_COUNT];
+
+static void put32(uint8_t *p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+uint16_t tp_counters_get_report(uint8_t *buffer, uint16_t reqlen) {
+    if (reqlen < TP_COUNTERS_REPORT_LEN) return 0;
+
+    memset(buffer, 0, TP_COUNTERS_REPORT_LEN);
+    buffer[1] = TP_COUNTERS_REPORT_VERSION;
+    buffer[2] = TP_CNT_COUNT;
+    put32(&buffer[4], (uint32_t)(esp_timer_get_time() / 1000));
+
+    for (int c = 0; c < TP_CNT_COUNT; c++) {
+        put32(&buffer[8 + c * 4], tp_counters[c]);
+    }
+    return TP_COUNTERS_REPORT_LEN;
+}
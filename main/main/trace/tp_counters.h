@@ -0,0 +1,43 @@
+#ifndef TP_COUNTERS_H
+#define TP_COUNTERS_H
+
+#include <stdint.h>
+
+// Event counters of the hot paths, always on. Each counter has a single
+// writer (the task or callback named below), so a plain increment of an
+// aligned 32-bit word needs no lock; readers may see a value one event old.
+// Counters only grow and wrap at 2^32: the host takes rates from deltas.
+typedef enum {
+    TP_CNT_FRAMES = 0,          // tp_reader: frames delivered to the driver
+    TP_CNT_I2C_ERRORS,          // tp_reader: failed reads, bad length prefixes
+    TP_CNT_I2C_EMPTY,           // tp_reader: zero length reports
+    TP_CNT_BURST_LIMIT,         // tp_reader: burst ended with INT still low
+    TP_CNT_READER_DROPPED,      // tp_reader: frame ring full
+    TP_CNT_PIPE_DROPPED,        // driver task: touch ring full
+    TP_CNT_PIPE_COALESCED,      // usbhid_task: move frame superseded
+    TP_CNT_HID_BUSY,            // usbhid_task: frames waiting, endpoint not ready
+    TP_CNT_HID_REJECTED,        // usbhid_task: tud_hid_n_report refused a report
+    TP_CNT_ESPNOW_SEND_FAILED,  // usbhid_task: esp_now_send returned an error
+    TP_CNT_ESPNOW_NO_ACK,       // Wi-Fi task: packet not acknowledged
+    TP_CNT_COUNT
+} tp_counter_t;
+
+// Feature report page (generic HID instance 0), little endian:
+//   [0]     page (GENERIC_FEATURE_PAGE_COUNTERS)
+//   [1]     TP_COUNTERS_REPORT_VERSION
+//   [2]     TP_CNT_COUNT
+//   [3]     reserved
+//   [4..7]  uptime (ms)
+//   [8..]   uint32 per counter, tp_counter_t order
+#define TP_COUNTERS_REPORT_VERSION 1
+#define TP_COUNTERS_REPORT_LEN     64
+
+extern volatile uint32_t tp_counters[TP_CNT_COUNT];
+
+static inline void tp_count(tp_counter_t c) {
+    tp_counters[c]++;
+}
+
+uint16_t tp_counters_get_report(uint8_t *buffer, uint16_t reqlen);
+
+#endif
@@ -0,0 +1,149 @@
+#include <string.h>
+#include "esp_log.h"
+
+#include "trace/tp_latency.h"
+
+static const char *TAG = "TP_LATENCY";
+
+volatile uint32_t tp_latency_isr_us = 0;
+
+// An INT edge older than this belongs to an earlier frame (the read was
+// triggered by the 1 ms poll instead).
+#define ISR_STALE_US 100000
+
+typedef struct {
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint16_t window[TP_LATENCY_WINDOW];
+} lat_stage_t;
+
+// Written only by usbhid_task; the USB stack reads a snapshot.
+static lat_stage_t stages[TP_LAT_STAGE_COUNT];
+static uint32_t frames = 0;
+static uint16_t window_pos = 0;
+static uint16_t window_fill = 0;
+static volatile bool reset_pending = true;
+
+static const uint16_t hist_limits[TP_LATENCY_HIST_BUCKETS - 1] = {
+    250, 500, 1000, 2000, 4000, 8000, 16000
+};
+
+static void clear_stats(void) {
+    memset(stages, 0, sizeof(stages));
+    for (int s = 0; s < TP_LAT_STAGE_COUNT; s++) stages[s].min = UINT32_MAX;
+    frames = 0;
+    window_pos = 0;
+    window_fill = 0;
+}
+
+void tp_latency_record(const tp_trace_t *trace, uint32_t dequeue_us, uint32_t submit_us) {
+    if (trace->read == 0 || trace->filter == 0) return;
+
+    if (reset_pending) {
+        clear_stats();
+        reset_pending = false;
+    }
+
+    uint32_t isr = trace->isr;
+    if (isr == 0 || trace->read - isr > ISR_STALE_US) isr = trace->read;
+
+    uint32_t d[TP_LAT_STAGE_COUNT] = {
+        [TP_LAT_ISR_TO_READ] = trace->read - isr,
+        [TP_LAT_READ_TO_FILTER] = trace->filter - trace->read,
+        [TP_LAT_FILTER_TO_DEQUEUE] = dequeue_us - trace->filter,
+        [TP_LAT_DEQUEUE_TO_SUBMIT] = submit_us - dequeue_us,
+        [TP_LAT_TOTAL] = submit_us - isr,
+    };
+
+    for (int s = 0; s < TP_LAT_STAGE_COUNT; s++) {
+        lat_stage_t *st = &stages[s];
+        uint32_t v = d[s] > UINT16_MAX ? UINT16_MAX : d[s];
+        if (v < st->min) st->min = v;
+        if (v > st->max) st->max = v;
+        st->sum += v;
+        st->window[window_pos] = (uint16_t)v;
+    }
+
+    window_pos = (window_pos + 1) % TP_LATENCY_WINDOW;
+    if (window_fill < TP_LATENCY_WINDOW) window_fill++;
+    frames++;
+}
+
+// k-th smallest of v[0..n), reorders v.
+static uint16_t select_kth(uint16_t *v, int n, int k) {
+    int lo = 0, hi = n - 1;
+    while (lo < hi) {
+        uint16_t pivot = v[(lo + hi) / 2];
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (v[i] < pivot) i++;
+            while (v[j] > pivot) j--;
+            if (i <= j) {
+                uint16_t t = v[i];
+                v[i] = v[j];
+                v[j] = t;
+                i++;
+                j--;
+            }
+        }
+        if (k <= j) hi = j;
+        else if (k >= i) lo = i;
+        else break;
+    }
+    return v[k];
+}
+
+static void put16(uint8_t *p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+uint16_t tp_latency_get_report(uint8_t *buffer, uint16_t reqlen) {
+    if (reqlen < TP_LATENCY_REPORT_LEN) return 0;
+
+    uint16_t tmp[TP_LATENCY_WINDOW];
+    uint32_t n_frames = reset_pending ? 0 : frames;
+    int fill = reset_pending ? 0 : window_fill;
+
+    memset(buffer, 0, TP_LATENCY_REPORT_LEN);
+    buffer[1] = TP_LATENCY_REPORT_VERSION;
+    buffer[2] = TP_LAT_STAGE_COUNT;
+    buffer[4] = n_frames & 0xFF;
+    buffer[5] = (n_frames >> 8) & 0xFF;
+    buffer[6] = (n_frames >> 16) & 0xFF;
+    buffer[7] = (n_frames >> 24) & 0xFF;
+
+    if (n_frames == 0) return TP_LATENCY_REPORT_LEN;
+
+    for (int s = 0; s < TP_LAT_STAGE_COUNT; s++) {
+        const lat_stage_t *st = &stages[s];
+        uint8_t *p = &buffer[8 + s * 8];
+
+        memcpy(tmp, st->window, fill * sizeof(uint16_t));
+        int k = (fill * 99) / 100;
+        if (k >= fill) k = fill - 1;
+
+        put16(p + 0, st->min);
+        put16(p + 2, (uint32_t)(st->sum / n_frames));
+        put16(p + 4, select_kth(tmp, fill, k));
+        put16(p + 6, st->max);
+
+        if (s == TP_LAT_TOTAL) {
+            uint16_t hist[TP_LATENCY_HIST_BUCKETS] = {0};
+            for (int i = 0; i < fill; i++) {
+                int b = 0;
+                while (b < TP_LATENCY_HIST_BUCKETS - 1 && st->window[i] >= hist_limits[b]) b++;
+                hist[b]++;
+            }
+            for (int b = 0; b < TP_LATENCY_HIST_BUCKETS; b++) put16(&buffer[48 + b * 2], hist[b]);
+        }
+    }
+
+    return TP_LATENCY_REPORT_LEN;
+}
+
+void tp_latency_reset(void) {
+    reset_pending = true;
+    ESP_LOGI(TAG, "Latency statistics cleared");
+}
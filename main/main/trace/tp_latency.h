@@ -0,0 +1,78 @@
+#ifndef TP_LATENCY_H
+#define TP_LATENCY_H
+
+#include <stdint.h>
+#include "esp_timer.h"
+
+#include "sdkconfig.h"
+#include "i2c/tp_frame.h"
+
+// Per-stage touch-to-USB latency. Stages between the tp_trace_t stamps,
+// the dequeue in usbhid_task and the USB / ESP-NOW submit:
+typedef enum {
+    TP_LAT_ISR_TO_READ = 0,
+    TP_LAT_READ_TO_FILTER,
+    TP_LAT_FILTER_TO_DEQUEUE,
+    TP_LAT_DEQUEUE_TO_SUBMIT,
+    TP_LAT_TOTAL,
+    TP_LAT_STAGE_COUNT
+} tp_lat_stage_t;
+
+#define TP_LATENCY_WINDOW       256     // samples kept for p99 and the histogram
+#define TP_LATENCY_HIST_BUCKETS 8       // total latency: <250us, <500us, ... <16ms, >=16ms
+
+// Feature report page (generic HID instance 0), little endian:
+//   [0]     page (GENERIC_FEATURE_PAGE_LATENCY)
+//   [1]     TP_LATENCY_REPORT_VERSION
+//   [2]     TP_LAT_STAGE_COUNT
+//   [3]     reserved
+//   [4..7]  frames recorded since reset
+//   [8..47] per stage: min, avg, p99, max (uint16 us; p99 over the window)
+//   [48..63] total latency histogram over the window (uint16 counts)
+#define TP_LATENCY_REPORT_VERSION 1
+#define TP_LATENCY_REPORT_LEN     64
+
+#if CONFIG_TP_LATENCY_TRACE
+
+extern volatile uint32_t tp_latency_isr_us;
+
+static inline uint32_t tp_latency_now(void) {
+    return (uint32_t)esp_timer_get_time();
+}
+
+// INT asserted, called from tp_gpio_isr_handler.
+static inline void tp_latency_isr(void) {
+    tp_latency_isr_us = tp_latency_now();
+}
+
+// First I2C read of a frame: picks up the last INT edge as well.
+static inline void tp_latency_read(tp_trace_t *trace) {
+    if (trace->read == 0) {
+        trace->read = tp_latency_now();
+        trace->isr = tp_latency_isr_us;
+    }
+}
+
+static inline void tp_latency_filter(tp_trace_t *trace) {
+    trace->filter = tp_latency_now();
+}
+
+void tp_latency_record(const tp_trace_t *trace, uint32_t dequeue_us, uint32_t submit_us);
+uint16_t tp_latency_get_report(uint8_t *buffer, uint16_t reqlen);
+void tp_latency_reset(void);
+
+#else
+
+static inline uint32_t tp_latency_now(void) { return 0; }
+static inline void tp_latency_isr(void) {}
+static inline void tp_latency_read(tp_trace_t *trace) { (void)trace; }
+static inline void tp_latency_filter(tp_trace_t *trace) { (void)trace; }
+static inline void tp_latency_record(const tp_trace_t *trace, uint32_t dequeue_us, uint32_t submit_us) {
+    (void)trace; (void)dequeue_us; (void)submit_us;
+}
+static inline uint16_t tp_latency_get_report(uint8_t *buffer, uint16_t reqlen) { (void)buffer; (void)reqlen; return 0; }
+static inline void tp_latency_reset(void) {}
+
+#endif
+
+#endif
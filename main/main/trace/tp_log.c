@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+
+#include "trace/tp_log.h"
+#include "tp_tasks.h"
+
+#define TP_LOG_RING_SIZE CONFIG_TP_LOG_RING_SIZE
+#define TP_LOG_DRAIN_MS  20
+
+_Static_assert((TP_LOG_RING_SIZE & (TP_LOG_RING_SIZE - 1)) == 0, "log ring size must be a power of two");
+_Static_assert(sizeof(tp_log_record_t) == 28, "host decoder expects 28 byte records");
+
+// Any task or ISR writes; the drain (tp_log task or the USB stack) is the
+// only reader. The ESP32-S2 has a single core, so one ring and a short
+// interrupt-off section are enough.
+static tp_log_record_t ring[TP_LOG_RING_SIZE];
+static atomic_uint head, tail;
+static uint32_t dropped;
+static portMUX_TYPE ring_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void IRAM_ATTR tp_log_write(const char *fmt, const char *tag, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3) {
+    uint32_t now = (uint32_t)esp_timer_get_time();
+
+    portENTER_CRITICAL_SAFE(&ring_lock);
+    unsigned h = atomic_load_explicit(&head, memory_order_relaxed);
+    if (h - atomic_load_explicit(&tail, memory_order_acquire) >= TP_LOG_RING_SIZE) {
+        dropped++;
+    } else {
+        tp_log_record_t *r = &ring[h & (TP_LOG_RING_SIZE - 1)];
+        r->timestamp_us = now;
+        r->fmt = (uint32_t)(uintptr_t)fmt;
+        r->tag = (uint32_t)(uintptr_t)tag;
+        r->args[0] = a0;
+        r->args[1] = a1;
+        r->args[2] = a2;
+        r->args[3] = a3;
+        atomic_store_explicit(&head, h + 1, memory_order_release);
+    }
+    portEXIT_CRITICAL_SAFE(&ring_lock);
+}
+
+static bool pop(tp_log_record_t *out) {
+    unsigned t = atomic_load_explicit(&tail, memory_order_relaxed);
+    if (t == atomic_load_explicit(&head, memory_order_acquire)) return false;
+    *out = ring[t & (TP_LOG_RING_SIZE - 1)];
+    atomic_store_explicit(&tail, t + 1, memory_order_release);
+    return true;
+}
+
+static uint32_t take_dropped(void) {
+    portENTER_CRITICAL(&ring_lock);
+    uint32_t n = dropped;
+    dropped = 0;
+    portEXIT_CRITICAL(&ring_lock);
+    return n;
+}
+
+#if CONFIG_TP_LOG_TRANSPORT_HID
+
+uint16_t tp_log_get_report(uint8_t *buffer, uint16_t reqlen) {
+    if (reqlen < TP_LOG_REPORT_LEN) return 0;
+
+    memset(buffer, 0, TP_LOG_REPORT_LEN);
+    buffer[1] = TP_LOG_REPORT_VERSION;
+
+    uint32_t lost = take_dropped();
+    buffer[3] = lost > 255 ? 255 : lost;
+
+    uint8_t n = 0;
+    tp_log_record_t r;
+    while (8 + (n + 1) * sizeof(r) <= TP_LOG_REPORT_LEN && pop(&r)) {
+        memcpy(&buffer[8 + n * sizeof(r)], &r, sizeof(r));
+        n++;
+    }
+    buffer[2] = n;
+    return TP_LOG_REPORT_LEN;
+}
+
+void tp_log_init(void) {}
+
+#else
+
+uint16_t tp_log_get_report(uint8_t *buffer, uint16_t reqlen) {
+    (void)buffer;
+    (void)reqlen;
+    return 0;
+}
+
+// One console line per record, so the log can be captured together with
+// the regular ESP_LOGx output.
+static void tp_log_task(void *arg) {
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(TP_LOG_DRAIN_MS));
+
+        uint32_t lost = take_dropped();
+        if (lost) printf("#TPL ! %lu\n", (unsigned long)lost);
+
+        tp_log_record_t r;
+        while (pop(&r)) {
+            const uint8_t *p = (const uint8_t *)&r;
+            char line[6 + 2 * sizeof(r) + 2];
+            int n = sprintf(line, "#TPL ");
+            for (int i = 0; i < sizeof(r); i++) n += sprintf(&line[n], "%02x", p[i]);
+            line[n++] = '\n';
+            fwrite(line, 1, n, stdout);
+        }
+    }
+}
+
+void tp_log_init(void) {
+    tp_task_create(TP_TASK_LOG, tp_log_task, NULL, NULL);
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef TP_LOG_H
+#define TP_LOG_H
+
+#include <stdint.h>
+
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+// Deferred binary log for hot paths and ISRs. TP_LOGx records the address
+// of the format string, the tag pointer, a timestamp and up to four raw
+// 32-bit arguments into a ring; nothing is formatted on the calling task.
+// The tp_log task (lowest priority) drains the ring as "#TPL <hex>" lines
+// on the console, or the host polls it from the generic HID interface.
+// main/host/tp_log.py looks the format strings up in the application ELF
+// and prints the messages.
+//
+// Arguments must be integers or pointers of at most 32 bits; %s only
+// decodes for strings that live in the ELF (literals, TAGs). Without
+// CONFIG_TP_LOG the macros are plain ESP_LOGx.
+//
+// Feature report page (generic HID instance 0), little endian:
+//   [0]     page (GENERIC_FEATURE_PAGE_LOG)
+//   [1]     TP_LOG_REPORT_VERSION
+//   [2]     records in this report
+//   [3]     records dropped since the last report (saturates at 255)
+//   [4..7]  reserved
+//   [8..]   tp_log_record_t each
+#define TP_LOG_REPORT_VERSION 1
+#define TP_LOG_REPORT_LEN     64
+#define TP_LOG_MAX_ARGS       4
+
+typedef struct {
+    uint32_t timestamp_us;
+    uint32_t fmt;               // level letter followed by the format
+    uint32_t tag;
+    uint32_t args[TP_LOG_MAX_ARGS];
+} tp_log_record_t;
+
+#if CONFIG_TP_LOG
+
+void tp_log_init(void);
+void tp_log_write(const char *fmt, const char *tag, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+uint16_t tp_log_get_report(uint8_t *buffer, uint16_t reqlen);
+
+#define TP_LOG_NARGS_(_0, _1, _2, _3, _4, _5, n, ...) n
+#define TP_LOG_NARGS(...) TP_LOG_NARGS_(0, ##__VA_ARGS__, 5, 4, 3, 2, 1, 0)
+#define TP_LOG_ARGS_(_, a, b, c, d, ...) \
+    (uint32_t)(uintptr_t)(a), (uint32_t)(uintptr_t)(b), (uint32_t)(uintptr_t)(c), (uint32_t)(uintptr_t)(d)
+
+#define TP_LOG_AT(level, tag, fmt, ...) do { \
+        _Static_assert(TP_LOG_NARGS(__VA_ARGS__) <= TP_LOG_MAX_ARGS, "too many TP_LOG arguments"); \
+        tp_log_write(level fmt, tag, TP_LOG_ARGS_(0, ##__VA_ARGS__, 0, 0, 0, 0)); \
+    } while (0)
+
+#define TP_LOGE(tag, fmt, ...) TP_LOG_AT("E", tag, fmt, ##__VA_ARGS__)
+#define TP_LOGW(tag, fmt, ...) TP_LOG_AT("W", tag, fmt, ##__VA_ARGS__)
+#define TP_LOGI(tag, fmt, ...) TP_LOG_AT("I", tag, fmt, ##__VA_ARGS__)
+
+#else
+
+static inline void tp_log_init(void) {}
+static inline uint16_t tp_log_get_report(uint8_t *buffer, uint16_t reqlen) { (void)buffer; (void)reqlen; return 0; }
+
+#define TP_LOGE(tag, fmt, ...) ESP_LOGE(tag, fmt, ##__VA_ARGS__)
+#define TP_LOGW(tag, fmt, ...) ESP_LOGW(tag, fmt, ##__VA_ARGS__)
+#define TP_LOGI(tag, fmt, ...) ESP_LOGI(tag, fmt, ##__VA_ARGS__)
+
+#endif
+
+#endif
@@ -0,0 +1,177 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#if CONFIG_TP_SCHED_STRESS
+#include "esp_now.h"
+#include "esp_wifi.h"
+#endif
+
+#include "trace/tp_sched.h"
+
+static const char *TAG = "TP_SCHED";
+
+_Static_assert(32 + (TP_TASK_COUNT + 1) * 2 + TP_TASK_COUNT <= TP_SCHED_REPORT_LEN,
+               "task plan does not fit the feature report");
+
+volatile uint32_t tp_sched_signal_us[TP_TASK_STAGE_COUNT];
+
+typedef struct {
+    uint32_t count;
+    uint32_t max;
+    uint32_t over;
+    uint64_t sum;
+} sched_stage_t;
+
+// Each stage is written only by its own task; the USB stack reads a
+// snapshot and asks the task to clear it through reset_pending.
+static sched_stage_t stages[TP_TASK_STAGE_COUNT];
+static volatile bool reset_pending[TP_TASK_STAGE_COUNT];
+
+// Run-time counters at the last reset (since boot until then). Used by
+// the USB stack only.
+static uint32_t base_run[TP_TASK_COUNT];
+static uint32_t base_idle;
+static int64_t base_us;
+
+void tp_sched_woken(tp_task_id_t stage) {
+    // A signal landing between the read and the clear is lost, which only
+    // drops that sample.
+    uint32_t signal = tp_sched_signal_us[stage];
+    if (signal == 0) return;
+    tp_sched_signal_us[stage] = 0;
+
+    uint32_t d = (uint32_t)esp_timer_get_time() - signal;
+    sched_stage_t *st = &stages[stage];
+
+    if (reset_pending[stage]) {
+        memset(st, 0, sizeof(*st));
+        reset_pending[stage] = false;
+    }
+
+    st->count++;
+    st->sum += d;
+    if (d > st->max) st->max = d;
+    if (tp_tasks[stage].budget_us && d > tp_tasks[stage].budget_us) st->over++;
+}
+
+static void put16(uint8_t *p, uint32_t v) {
+    if (v > UINT16_MAX) v = UINT16_MAX;
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+static uint32_t per_mille(uint32_t run_us, uint32_t window_us) {
+    if (window_us == 0) return 0;
+    uint32_t v = (uint32_t)((uint64_t)run_us * 1000 / window_us);
+    return v > 1000 ? 1000 : v;
+}
+
+uint16_t tp_sched_get_report(uint8_t *buffer, uint16_t reqlen) {
+    if (reqlen < TP_SCHED_REPORT_LEN) return 0;
+
+    uint32_t window_us = (uint32_t)(esp_timer_get_time() - base_us);
+
+    memset(buffer, 0, TP_SCHED_REPORT_LEN);
+    buffer[1] = TP_SCHED_REPORT_VERSION;
+    buffer[2] = TP_TASK_STAGE_COUNT;
+    buffer[3] = TP_TASK_COUNT;
+    put32(&buffer[4], window_us / 1000);
+
+    for (int s = 0; s < TP_TASK_STAGE_COUNT; s++) {
+        uint8_t *p = &buffer[8 + s * 8];
+        put16(p + 4, tp_tasks[s].budget_us);
+        if (reset_pending[s]) continue;
+
+        sched_stage_t st = stages[s];
+        put16(p, st.count ? (uint32_t)(st.sum / st.count) : 0);
+        put16(p + 2, st.max);
+        put16(p + 6, st.over);
+    }
+
+    // Tasks are looked up by name: esp_tinyusb creates its own, and
+    // heartbeat, capture, log and stress may not exist.
+    for (int t = 0; t < TP_TASK_COUNT; t++) {
+        TaskHandle_t h = xTaskGetHandle(tp_tasks[t].name);
+        if (h == NULL) continue;
+
+        put16(&buffer[32 + t * 2], per_mille(ulTaskGetRunTimeCounter(h) - base_run[t], window_us));
+        buffer[32 + (TP_TASK_COUNT + 1) * 2 + t] = (uint8_t)uxTaskPriorityGet(h);
+    }
+
+    put16(&buffer[32 + TP_TASK_COUNT * 2], per_mille(ulTaskGetIdleRunTimeCounter() - base_idle, window_us));
+
+    return TP_SCHED_REPORT_LEN;
+}
+
+void tp_sched_reset(void) {
+    for (int s = 0; s < TP_TASK_STAGE_COUNT; s++) reset_pending[s] = true;
+
+    for (int t = 0; t < TP_TASK_COUNT; t++) {
+        TaskHandle_t h = xTaskGetHandle(tp_tasks[t].name);
+        base_run[t] = h ? ulTaskGetRunTimeCounter(h) : 0;
+    }
+    base_idle = ulTaskGetIdleRunTimeCounter();
+    base_us = esp_timer_get_time();
+}
+
+#if CONFIG_TP_SCHED_STRESS
+
+// Broadcast, version 0 header: the receiver drops these as bad packets.
+#define STRESS_PACKET_LEN 250
+
+static const uint8_t broadcast_mac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+static volatile bool stress_running = false;
+
+static void stress_task(void *arg) {
+    uint8_t pkt[STRESS_PACKET_LEN];
+    uint32_t sent = 0;
+
+    memset(pkt, 0, sizeof(pkt));
+
+    while (stress_running) {
+        // Queue full: the radio is saturated, wait for room
+        if (esp_now_send(broadcast_mac, pkt, sizeof(pkt)) == ESP_OK) sent++;
+        else vTaskDelay(1);
+    }
+
+    ESP_LOGI(TAG, "Radio stress stopped, %lu packets queued", (unsigned long)sent);
+    vTaskDelete(NULL);
+}
+
+void tp_sched_stress_start(void) {
+    if (stress_running) return;
+
+    if (!esp_now_is_peer_exist(broadcast_mac)) {
+        esp_now_peer_info_t peer = {
+            .ifidx = WIFI_IF_STA,
+            .encrypt = false,
+        };
+        memcpy(peer.peer_addr, broadcast_mac, sizeof(broadcast_mac));
+        if (esp_now_add_peer(&peer) != ESP_OK) {
+            ESP_LOGW(TAG, "Broadcast peer not added, no radio stress");
+            return;
+        }
+    }
+
+    stress_running = true;
+    if (tp_task_create(TP_TASK_STRESS, stress_task, NULL, NULL) != pdPASS) {
+        stress_running = false;
+        return;
+    }
+    ESP_LOGI(TAG, "Radio stress started");
+}
+
+void tp_sched_stress_stop(void) {
+    stress_running = false;
+}
+
+#endif
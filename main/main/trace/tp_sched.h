@@ -0,0 +1,71 @@
+#ifndef TP_SCHED_H
+#define TP_SCHED_H
+
+#include <stdint.h>
+#include "esp_timer.h"
+
+#include "sdkconfig.h"
+#include "tp_tasks.h"
+
+// Run-time monitor of the task plan (tp_tasks.h). For each touch stage it
+// records the wake delay: the time from the stage being signalled (INT
+// edge, frame ready, frame queued) to its task running. That delay is the
+// time the stage spent preempted. Delays above the stage's budget are
+// counted. CPU share per task comes from the FreeRTOS run-time counters.
+//
+// Feature report page (generic HID instance 0), little endian:
+//   [0]      page (GENERIC_FEATURE_PAGE_SCHED)
+//   [1]      TP_SCHED_REPORT_VERSION
+//   [2]      TP_TASK_STAGE_COUNT
+//   [3]      TP_TASK_COUNT
+//   [4..7]   window since reset (ms)
+//   [8..31]  per stage: avg, max, budget (uint16 us), over budget (uint16)
+//   [32..53] CPU share per tp_tasks entry, then idle (uint16 per mille);
+//            the rest (Wi-Fi, esp_timer, ...) is 1000 minus their sum
+//   [54..63] priority per tp_tasks entry, 0 when the task does not exist
+#define TP_SCHED_REPORT_VERSION 2
+#define TP_SCHED_REPORT_LEN     64
+
+#if CONFIG_TP_SCHED_MONITOR
+
+extern volatile uint32_t tp_sched_signal_us[TP_TASK_STAGE_COUNT];
+
+// Stage work is pending from now on. Keeps the oldest unserved signal.
+// ISR safe.
+static inline void tp_sched_signal(tp_task_id_t stage) {
+    if (tp_sched_signal_us[stage] == 0) {
+        uint32_t now = (uint32_t)esp_timer_get_time();
+        tp_sched_signal_us[stage] = now ? now : 1;
+    }
+}
+
+// Called by the stage's own task right after it wakes.
+void tp_sched_woken(tp_task_id_t stage);
+
+uint16_t tp_sched_get_report(uint8_t *buffer, uint16_t reqlen);
+void tp_sched_reset(void);
+
+#else
+
+static inline void tp_sched_signal(tp_task_id_t stage) { (void)stage; }
+static inline void tp_sched_woken(tp_task_id_t stage) { (void)stage; }
+static inline uint16_t tp_sched_get_report(uint8_t *buffer, uint16_t reqlen) { (void)buffer; (void)reqlen; return 0; }
+static inline void tp_sched_reset(void) {}
+
+#endif
+
+#if CONFIG_TP_SCHED_STRESS
+
+// Floods the radio with broadcast ESP-NOW packets from the TP_TASK_STRESS
+// task until stopped, to measure the touch path under radio load.
+void tp_sched_stress_start(void);
+void tp_sched_stress_stop(void);
+
+#else
+
+static inline void tp_sched_stress_start(void) {}
+static inline void tp_sched_stress_stop(void) {}
+
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "tusb.h"
+
+#include "usb/hid_sched.h"
+
+#define FRAME_MASK 0x7FF    // 11-bit USB frame number
+
+// Largest power of two not above bInterval
+#define POLL_PERIOD (HID_SCHED_INTERVAL_MS >= 8 ? 8 : HID_SCHED_INTERVAL_MS >= 4 ? 4 : \
+                     HID_SCHED_INTERVAL_MS >= 2 ? 2 : 1)
+
+static TaskHandle_t sched_task = NULL;
+
+// Written by the TinyUSB task
+static atomic_uint sof_frame;
+static atomic_uint poll_frame;
+static atomic_bool have_phase;
+static atomic_bool sof_seen;     // sof_frame is current
+static atomic_bool due;
+
+static bool sof_on = false;
+static atomic_bool in_flight;
+
+void hid_sched_init(TaskHandle_t task) {
+    sched_task = task;
+    atomic_init(&sof_frame, 0);
+    atomic_init(&poll_frame, 0);
+    atomic_init(&have_phase, false);
+    atomic_init(&sof_seen, false);
+    atomic_init(&due, false);
+    atomic_init(&in_flight, false);
+}
+
+static void set_sof(bool on) {
+    if (on == sof_on) return;
+    sof_on = on;
+    atomic_store(&sof_seen, false);
+    tud_sof_cb_enable(on);
+}
+
+void tud_sof_cb(uint32_t frame_count) {
+    atomic_store(&sof_frame, frame_count & FRAME_MASK);
+    atomic_store(&sof_seen, true);
+
+    if (!atomic_load(&have_phase)) return;
+
+    // The next frame is polled: arm the endpoint now
+    unsigned since_poll = (frame_count - atomic_load(&poll_frame)) & FRAME_MASK;
+    if (since_poll % POLL_PERIOD == POLL_PERIOD - 1 && !atomic_load(&due)) {
+        atomic_store(&due, true);
+        if (sched_task != NULL) {
+            xTaskNotifyGive(sched_task);
+        }
+    }
+}
+
+bool hid_sched_ptp_due(bool pending) {
+    if (POLL_PERIOD == 1) return true;
+
+    if (!tud_mounted()) {
+        atomic_store(&have_phase, false);
+        atomic_store(&in_flight, false);
+        set_sof(false);
+        return true;
+    }
+
+    set_sof(pending || atomic_load(&in_flight));
+
+    // Phase unknown (first report, or SOF was off at the last completion)
+    if (!atomic_load(&have_phase)) return true;
+    return atomic_load(&due);
+}
+
+void hid_sched_ptp_sent(void) {
+    atomic_store(&due, false);
+    atomic_store(&in_flight, true);
+}
+
+void hid_sched_ptp_complete(void) {
+    // Only a frame number seen while SOF was tracked gives the phase
+    if (atomic_load(&sof_seen)) {
+        atomic_store(&poll_frame, atomic_load(&sof_frame));
+        atomic_store(&have_phase, true);
+    }
+    // Polled in this frame: the next report waits for the next poll
+    atomic_store(&due, false);
+    atomic_store(&in_flight, false);
+}
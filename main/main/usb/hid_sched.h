@@ -0,0 +1,35 @@
+#ifndef HID_SCHED_H
+#define HID_SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "sdkconfig.h"
+
+// SOF-aligned submission for the wired PTP endpoint. A report armed right
+// after the host's IN poll waits a whole polling interval in the endpoint;
+// instead touch frames stay in tp_pipe (which merges move-only frames and
+// keeps every tip transition) until the USB frame before the next poll.
+//
+// The poll phase is learned from the SOF frame number at which the last
+// report completed. Hosts schedule full-speed interrupt endpoints at the
+// largest power of two not above bInterval, which is the period used here.
+// With a 1 ms interval every frame is polled and reports go out at once.
+// SOF events are only enabled while a report is held or in flight.
+
+#define HID_SCHED_INTERVAL_MS CONFIG_TOUCHPAD_HID_POLL_INTERVAL
+
+void hid_sched_init(TaskHandle_t task);
+
+// usbhid_task: may a touch report be submitted now? pending tells whether
+// frames are waiting, so SOF tracking can be switched on or off.
+bool hid_sched_ptp_due(bool pending);
+void hid_sched_ptp_sent(void);
+
+// tud_hid_report_complete_cb for the PTP instance
+void hid_sched_ptp_complete(void);
+
+#endif
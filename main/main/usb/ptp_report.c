@@ -0,0 +1,28 @@
+#include <string.h>
+
+#include "usb/ptp_report.h"
+
+void ptp_report_build(const tp_multi_msg_t *msg, ptp_report_t *report) {
+    memset(report, 0, sizeof(*report));
+
+    report->scan_time = msg->scan_time;
+
+    // Padding fingers stay zero: no tip, no confidence
+    for (int i = 0; i < msg->actual_count && i < 5; i++) {
+        report->fingers[i].x = msg->fingers[i].x;
+        report->fingers[i].y = msg->fingers[i].y;
+
+        uint8_t base_id;
+        if (msg->fingers[i].confidence == 1) {
+            base_id = msg->fingers[i].tip_switch ? 0x03 : 0x01;
+        } else {
+            base_id = 0x02;
+        }
+
+        report->fingers[i].tip_conf_id = (msg->fingers[i].contact_id << 2) | base_id;
+    }
+
+    report->contact_count = msg->actual_count;
+
+    report->buttons = (msg->button_mask > 0) ? 0x01 : 0x00;
+}
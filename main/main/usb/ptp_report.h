@@ -0,0 +1,13 @@
+#ifndef PTP_REPORT_H
+#define PTP_REPORT_H
+
+#include <stdint.h>
+#include "i2c/tp_frame.h"
+#include "ptp_wire.h"
+
+// PTP input report (report ID 0x01 on HID instance 1). No ESP-IDF
+// dependencies so the host replay tool builds the same bytes.
+
+void ptp_report_build(const tp_multi_msg_t *msg, ptp_report_t *report);
+
+#endif
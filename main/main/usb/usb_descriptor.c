@@ -3,10 +3,15 @@
 
 #include "tinyusb.h"
 #include "tusb.h"
+#include "esp_log.h"
 
 #include "sdkconfig.h"
 
 #include "i2c/I2C_HID_Report.h"
+#include "i2c/tp_driver.h"
+#include "usb/usbhid.h"
+
+static const char *TAG = "USB_DESC";
 
 #define REPORTID_TOUCHPAD         0x01
 #define REPORTID_MOUSE            0x02  // 示例中通常是这样排列的
@@ -22,8 +27,23 @@
 
 #define CONFIG_TOTAL_LEN  (TUD_CONFIG_DESC_LEN + 3 * TUD_HID_DESC_LEN)
 
+// TUD_HID_REPORT_DESC_GENERIC_INOUT(64) plus a 64-byte feature report for
+// the diagnostics pages (see generic_feature_get in usbhid.c)
 const uint8_t generic_hid_report_descriptor[] = {
-    TUD_HID_REPORT_DESC_GENERIC_INOUT(64)
+    HID_USAGE_PAGE_N(HID_USAGE_PAGE_VENDOR, 2),
+    HID_USAGE(0x01),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+        HID_USAGE(0x02),
+        HID_LOGICAL_MIN(0x00),
+        HID_LOGICAL_MAX_N(0xff, 2),
+        HID_REPORT_SIZE(8),
+        HID_REPORT_COUNT_N(64, 2),
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE(0x03),
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE(0x04),
+        HID_FEATURE(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+    HID_COLLECTION_END
 };
 
 const uint8_t mouse_hid_report_descriptor[] = {
@@ -59,7 +79,9 @@ const uint8_t mouse_hid_report_descriptor[] = {
 
 };
 
-const uint8_t ptp_hid_report_descriptor[] = {
+// X/Y ranges are filled in by ptp_report_desc_set_model() once the touch
+// pad model is known
+uint8_t ptp_hid_report_descriptor[] = {
     
     //TOUCH PAD input TLC
     0x05, 0x0d,                         // USAGE_PAGE (Digitizers)
@@ -90,12 +112,12 @@ const uint8_t ptp_hid_report_descriptor[] = {
     0x05, 0x01,                         // USAGE_PAGE (Generic Desktop)
     0x09, 0x30,                         // USAGE (X)
     0x15, 0x00,                         // LOGICAL_MINIMUM (0)
-    LOGICAL_X,                          // LOGICAL_MAXIMUM
+    0x26, 0x00, 0x00,                   // LOGICAL_MAXIMUM (model)
 
     0x35, 0x00,                         // PHYSICAL_MINIMUM (0)
-    PHYSICAL_X,                         // PHYSICAL_MAXIMUM
-    PHYSICAL_UNIT_EXPONENT,             // UNIT_EXPONENT (-3)
-    PHYSICAL_UNIT,                      // UNIT (Centimeter)
+    0x46, 0x00, 0x00,                   // PHYSICAL_MAXIMUM (model)
+    0x55, 0x00,                         // UNIT_EXPONENT (model)
+    0x65, 0x00,                         // UNIT (model)
 
     0x75, 0x10,                         // REPORT_SIZE (16)
     0x95, 0x01,                         // REPORT_COUNT (1)
@@ -104,10 +126,10 @@ const uint8_t ptp_hid_report_descriptor[] = {
     // ---- Y Axis ----
     0x09, 0x31,                         // USAGE (Y)
     0x15, 0x00,                         // LOGICAL_MINIMUM (0)
-    LOGICAL_Y,                          // LOGICAL_MAXIMUM
+    0x26, 0x00, 0x00,                   // LOGICAL_MAXIMUM (model)
 
     0x35, 0x00,                         // PHYSICAL_MINIMUM (0)
-    PHYSICAL_Y,                         // PHYSICAL_MAXIMUM
+    0x46, 0x00, 0x00,                   // PHYSICAL_MAXIMUM (model)
 
     0x75, 0x10,                         // REPORT_SIZE (16)
     0x95, 0x01,                         // REPORT_COUNT (1)
@@ -138,12 +160,12 @@ const uint8_t ptp_hid_report_descriptor[] = {
     0x05, 0x01,                         // USAGE_PAGE (Generic Desktop)
     0x09, 0x30,                         // USAGE (X)
     0x15, 0x00,                         // LOGICAL_MINIMUM (0)
-    LOGICAL_X,                          // LOGICAL_MAXIMUM
+    0x26, 0x00, 0x00,                   // LOGICAL_MAXIMUM (model)
 
     0x35, 0x00,                         // PHYSICAL_MINIMUM (0)
-    PHYSICAL_X,                         // PHYSICAL_MAXIMUM
-    PHYSICAL_UNIT_EXPONENT,             // UNIT_EXPONENT (-3)
-    PHYSICAL_UNIT,                      // UNIT (Centimeter)
+    0x46, 0x00, 0x00,                   // PHYSICAL_MAXIMUM (model)
+    0x55, 0x00,                         // UNIT_EXPONENT (model)
+    0x65, 0x00,                         // UNIT (model)
 
     0x75, 0x10,                         // REPORT_SIZE (16)
     0x95, 0x01,                         // REPORT_COUNT (1)
@@ -152,10 +174,10 @@ const uint8_t ptp_hid_report_descriptor[] = {
     // ---- Y Axis ----
     0x09, 0x31,                         // USAGE (Y)
     0x15, 0x00,                         // LOGICAL_MINIMUM (0)
-    LOGICAL_Y,                          // LOGICAL_MAXIMUM
+    0x26, 0x00, 0x00,                   // LOGICAL_MAXIMUM (model)
 
     0x35, 0x00,                         // PHYSICAL_MINIMUM (0)
-    PHYSICAL_Y,                         // PHYSICAL_MAXIMUM
+    0x46, 0x00, 0x00,                   // PHYSICAL_MAXIMUM (model)
 
     0x75, 0x10,                         // REPORT_SIZE (16)
     0x95, 0x01,                         // REPORT_COUNT (1)
@@ -186,12 +208,12 @@ const uint8_t ptp_hid_report_descriptor[] = {
     0x05, 0x01,                         // USAGE_PAGE (Generic Desktop)
     0x09, 0x30,                         // USAGE (X)
     0x15, 0x00,                         // LOGICAL_MINIMUM (0)
-    LOGICAL_X,                          // LOGICAL_MAXIMUM
+    0x26, 0x00, 0x00,                   // LOGICAL_MAXIMUM (model)
 
     0x35, 0x00,                         // PHYSICAL_MINIMUM (0)
-    PHYSICAL_X,                         // PHYSICAL_MAXIMUM
-    PHYSICAL_UNIT_EXPONENT,             // UNIT_EXPONENT (-3)
-    PHYSICAL_UNIT,                      // UNIT (Centimeter)
+    0x46, 0x00, 0x00,                   // PHYSICAL_MAXIMUM (model)
+    0x55, 0x00,                         // UNIT_EXPONENT (model)
+    0x65, 0x00,                         // UNIT (model)
 
     0x75, 0x10,                         // REPORT_SIZE (16)
     0x95, 0x01,                         // REPORT_COUNT (1)
@@ -200,10 +222,10 @@ const uint8_t ptp_hid_report_descriptor[] = {
     // ---- Y Axis ----
     0x09, 0x31,                         // USAGE (Y)
     0x15, 0x00,                         // LOGICAL_MINIMUM (0)
-    LOGICAL_Y,                          // LOGICAL_MAXIMUM
+    0x26, 0x00, 0x00,                   // LOGICAL_MAXIMUM (model)
 
     0x35, 0x00,                         // PHYSICAL_MINIMUM (0)
-    PHYSICAL_Y,                         // PHYSICAL_MAXIMUM
+    0x46, 0x00, 0x00,                   // PHYSICAL_MAXIMUM (model)
 
     0x75, 0x10,                         // REPORT_SIZE (16)
     0x95, 0x01,                         // REPORT_COUNT (1)
@@ -234,12 +256,12 @@ const uint8_t ptp_hid_report_descriptor[] = {
     0x05, 0x01,                         // USAGE_PAGE (Generic Desktop)
     0x09, 0x30,                         // USAGE (X)
     0x15, 0x00,                         // LOGICAL_MINIMUM (0)
-    LOGICAL_X,                          // LOGICAL_MAXIMUM
+    0x26, 0x00, 0x00,                   // LOGICAL_MAXIMUM (model)
 
     0x35, 0x00,                         // PHYSICAL_MINIMUM (0)
-    PHYSICAL_X,                         // PHYSICAL_MAXIMUM
-    PHYSICAL_UNIT_EXPONENT,             // UNIT_EXPONENT (-3)
-    PHYSICAL_UNIT,                      // UNIT (Centimeter)
+    0x46, 0x00, 0x00,                   // PHYSICAL_MAXIMUM (model)
+    0x55, 0x00,                         // UNIT_EXPONENT (model)
+    0x65, 0x00,                         // UNIT (model)
 
     0x75, 0x10,                         // REPORT_SIZE (16)
     0x95, 0x01,                         // REPORT_COUNT (1)
@@ -248,10 +270,10 @@ const uint8_t ptp_hid_report_descriptor[] = {
     // ---- Y Axis ----
     0x09, 0x31,                         // USAGE (Y)
     0x15, 0x00,                         // LOGICAL_MINIMUM (0)
-    LOGICAL_Y,                          // LOGICAL_MAXIMUM
+    0x26, 0x00, 0x00,                   // LOGICAL_MAXIMUM (model)
 
     0x35, 0x00,                         // PHYSICAL_MINIMUM (0)
-    PHYSICAL_Y,                         // PHYSICAL_MAXIMUM
+    0x46, 0x00, 0x00,                   // PHYSICAL_MAXIMUM (model)
 
     0x75, 0x10,                         // REPORT_SIZE (16)
     0x95, 0x01,                         // REPORT_COUNT (1)
@@ -282,12 +304,12 @@ const uint8_t ptp_hid_report_descriptor[] = {
     0x05, 0x01,                         // USAGE_PAGE (Generic Desktop)
     0x09, 0x30,                         // USAGE (X)
     0x15, 0x00,                         // LOGICAL_MINIMUM (0)
-    LOGICAL_X,                          // LOGICAL_MAXIMUM
+    0x26, 0x00, 0x00,                   // LOGICAL_MAXIMUM (model)
 
     0x35, 0x00,                         // PHYSICAL_MINIMUM (0)
-    PHYSICAL_X,                         // PHYSICAL_MAXIMUM
-    PHYSICAL_UNIT_EXPONENT,             // UNIT_EXPONENT (-3)
-    PHYSICAL_UNIT,                      // UNIT (Centimeter)
+    0x46, 0x00, 0x00,                   // PHYSICAL_MAXIMUM (model)
+    0x55, 0x00,                         // UNIT_EXPONENT (model)
+    0x65, 0x00,                         // UNIT (model)
 
     0x75, 0x10,                         // REPORT_SIZE (16)
     0x95, 0x01,                         // REPORT_COUNT (1)
@@ -296,10 +318,10 @@ const uint8_t ptp_hid_report_descriptor[] = {
     // ---- Y Axis ----
     0x09, 0x31,                         // USAGE (Y)
     0x15, 0x00,                         // LOGICAL_MINIMUM (0)
-    LOGICAL_Y,                          // LOGICAL_MAXIMUM
+    0x26, 0x00, 0x00,                   // LOGICAL_MAXIMUM (model)
 
     0x35, 0x00,                         // PHYSICAL_MINIMUM (0)
-    PHYSICAL_Y,                         // PHYSICAL_MAXIMUM
+    0x46, 0x00, 0x00,                   // PHYSICAL_MAXIMUM (model)
 
     0x75, 0x10,                         // REPORT_SIZE (16)
     0x95, 0x01,                         // REPORT_COUNT (1)
@@ -394,6 +416,61 @@ const uint8_t ptp_hid_report_descriptor[] = {
 uint8_t const desc_configuration[] = {
     TUD_CONFIG_DESCRIPTOR(1, 3, 0, CONFIG_TOTAL_LEN, 0x00, 100),
     TUD_HID_DESCRIPTOR(0, 0, false, sizeof(generic_hid_report_descriptor), EPNUM_GENERIC_IN, 64, 10),
-    TUD_HID_DESCRIPTOR(1, 0, HID_ITF_PROTOCOL_NONE, sizeof(ptp_hid_report_descriptor), EPNUM_TP_IN, 64, 10),
-    TUD_HID_DESCRIPTOR(2, 0, HID_ITF_PROTOCOL_MOUSE, sizeof(mouse_hid_report_descriptor), EPNUM_MOUSE_IN, 8, 10)
-};
\ No newline at end of file
+    TUD_HID_DESCRIPTOR(1, 0, HID_ITF_PROTOCOL_NONE, sizeof(ptp_hid_report_descriptor), EPNUM_TP_IN, 64, CONFIG_TOUCHPAD_HID_POLL_INTERVAL),
+    TUD_HID_DESCRIPTOR(2, 0, HID_ITF_PROTOCOL_MOUSE, sizeof(mouse_hid_report_descriptor), EPNUM_MOUSE_IN, 8, CONFIG_TOUCHPAD_HID_POLL_INTERVAL)
+};
+
+static void put_le16(uint8_t *p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+// Walks the short items of the PTP descriptor. Between a Generic Desktop
+// Usage (X) or (Y) and the Input item that follows it, the logical and
+// physical maximum and the unit items take the model's values. The
+// placeholders have the same item sizes, so the length never changes.
+//
+// Every finger's X and Y must get the range the coordinate scaler fills
+// (TP_OUTPUT_MAX of the controller's range), or the host would stretch
+// or clip the contacts; a mismatch is logged.
+void ptp_report_desc_set_model(const tp_driver_t *drv) {
+    uint8_t *p = ptp_hid_report_descriptor;
+    const uint8_t *end = p + sizeof(ptp_hid_report_descriptor);
+    uint8_t usage_page = 0;
+    int axis = -1;
+    int patched[2] = {0, 0};
+
+    while (p < end) {
+        uint8_t tag = p[0] & 0xFC;
+        size_t size = (p[0] & 0x03) == 3 ? 4 : (p[0] & 0x03);
+        if (p + 1 + size > end) break;
+
+        if (tag == 0x04 && size == 1) {
+            usage_page = p[1];
+        } else if (tag == 0x08 && size == 1 && usage_page == 0x01 && (p[1] == 0x30 || p[1] == 0x31)) {
+            axis = p[1] - 0x30;
+        } else if (tag == 0x80) {
+            axis = -1;
+        } else if (axis >= 0) {
+            if (tag == 0x24 && size == 2) {
+                put_le16(p + 1, axis ? drv->logical_max_y : drv->logical_max_x);
+                patched[axis]++;
+            } else if (tag == 0x44 && size == 2) {
+                put_le16(p + 1, axis ? drv->physical_max_y : drv->physical_max_x);
+            } else if (tag == 0x54 && size == 1) {
+                p[1] = drv->unit_exponent;
+            } else if (tag == 0x64 && size == 1) {
+                p[1] = drv->unit;
+            }
+        }
+        p += 1 + size;
+    }
+
+    if (patched[0] != TP_MAX_CONTACTS || patched[1] != TP_MAX_CONTACTS ||
+        drv->logical_max_x != TP_OUTPUT_MAX(drv->controller_max_x) ||
+        drv->logical_max_y != TP_OUTPUT_MAX(drv->controller_max_y)) {
+        ESP_LOGE(TAG, "PTP descriptor range %ux%u (%d/%d axes) does not match the scaler's %ux%u",
+                 drv->logical_max_x + 1, drv->logical_max_y + 1, patched[0], patched[1],
+                 TP_OUTPUT_MAX(drv->controller_max_x) + 1, TP_OUTPUT_MAX(drv->controller_max_y) + 1);
+    }
+}
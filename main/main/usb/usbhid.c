@@ -17,8 +17,23 @@
 #include "math.h"
 
 #include "i2c/I2C_HID_Report.h"
+#include "i2c/tp_driver.h"
 
 #include "usb/usbhid.h"
+#include "usb/hid_sched.h"
+
+#include "i2c/tp_pipe.h"
+#include "wl_proto.h"
+#include "wireless/wl_tx.h"
+
+#include "trace/tp_capture.h"
+#include "trace/tp_latency.h"
+#include "trace/tp_sched.h"
+#include "trace/tp_counters.h"
+#include "trace/tp_log.h"
+#include "tp_boot.h"
+#include "tp_mode.h"
+#include "tp_tasks.h"
 
 #include "wireless/wireless.h"
 
@@ -43,6 +58,29 @@ const float SENSITIVITY = 3.0f;
 
 #define REPORTID_DFU_CMD  0xFF
 
+// Commands on the generic interface (instance 0), first byte of the report
+#define GENERIC_CMD_CAPTURE_START 0xC0
+#define GENERIC_CMD_CAPTURE_STOP  0xC1
+#define GENERIC_CMD_STRESS_START  0xC2
+#define GENERIC_CMD_STRESS_STOP   0xC3
+
+// Diagnostics feature report on the generic interface (no report ID).
+// SET_FEATURE byte 0 selects the page the next GET_FEATURE returns,
+// byte 1 bit 0 clears that page's statistics, bit 1 writes the page's
+// settings from byte 2 on.
+#define GENERIC_FEATURE_PAGE_LATENCY 0x01
+#define GENERIC_FEATURE_PAGE_FILTER  0x02   // [1] smoothing mode (tp_smooth_mode_t)
+#define GENERIC_FEATURE_PAGE_SCHED   0x03
+#define GENERIC_FEATURE_PAGE_COUNTERS 0x04
+#define GENERIC_FEATURE_PAGE_LOG     0x05   // drains the binary log (CONFIG_TP_LOG_TRANSPORT_HID)
+#define GENERIC_FEATURE_PAGE_BOOT    0x06
+#define GENERIC_FEATURE_PAGE_MODE    0x07
+#define GENERIC_FEATURE_FLAG_RESET   0x01
+#define GENERIC_FEATURE_FLAG_WRITE   0x02
+#define GENERIC_FEATURE_LEN          64
+
+static uint8_t generic_feature_page = GENERIC_FEATURE_PAGE_LATENCY;
+
 void enter_dfu_mode(void)
 {
 
@@ -95,7 +133,81 @@ uint8_t const *tud_hid_descriptor_report_cb(uint8_t instance) {
     return NULL;
 }
 
+static uint16_t generic_feature_get(uint8_t *buffer, uint16_t reqlen) {
+    uint16_t len = 0;
+
+    switch (generic_feature_page) {
+    case GENERIC_FEATURE_PAGE_LATENCY:
+        len = tp_latency_get_report(buffer, reqlen);
+        break;
+    case GENERIC_FEATURE_PAGE_SCHED:
+        len = tp_sched_get_report(buffer, reqlen);
+        break;
+    case GENERIC_FEATURE_PAGE_COUNTERS:
+        len = tp_counters_get_report(buffer, reqlen);
+        break;
+    case GENERIC_FEATURE_PAGE_LOG:
+        len = tp_log_get_report(buffer, reqlen);
+        break;
+    case GENERIC_FEATURE_PAGE_BOOT:
+        len = tp_boot_get_report(buffer, reqlen);
+        break;
+    case GENERIC_FEATURE_PAGE_MODE:
+        len = tp_mode_get_report(buffer, reqlen);
+        break;
+    case GENERIC_FEATURE_PAGE_FILTER:
+        if (reqlen < GENERIC_FEATURE_LEN) break;
+        memset(buffer, 0, GENERIC_FEATURE_LEN);
+        buffer[1] = tp_smoothing;
+        len = GENERIC_FEATURE_LEN;
+        break;
+    default:
+        break;
+    }
+
+    if (len > 0) buffer[0] = generic_feature_page;
+    return len;
+}
+
+static void generic_feature_set(uint8_t const *buffer, uint16_t bufsize) {
+    if (bufsize < 1) return;
+    generic_feature_page = buffer[0];
+
+    if (bufsize >= 2 && (buffer[1] & GENERIC_FEATURE_FLAG_RESET)) {
+        switch (generic_feature_page) {
+        case GENERIC_FEATURE_PAGE_LATENCY:
+            tp_latency_reset();
+            break;
+        case GENERIC_FEATURE_PAGE_SCHED:
+            tp_sched_reset();
+            break;
+        case GENERIC_FEATURE_PAGE_MODE:
+            tp_mode_reset();
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (bufsize >= 3 && (buffer[1] & GENERIC_FEATURE_FLAG_WRITE)) {
+        switch (generic_feature_page) {
+        case GENERIC_FEATURE_PAGE_FILTER:
+            if (buffer[2] < TP_SMOOTH_COUNT) {
+                tp_smoothing = buffer[2];
+                ESP_LOGI(TAG, "Smoothing mode %u", buffer[2]);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
 uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t *buffer, uint16_t reqlen) {
+    if (instance == 0 && report_type == HID_REPORT_TYPE_FEATURE) {
+        return generic_feature_get(buffer, reqlen);
+    }
+
     if (report_type == HID_REPORT_TYPE_FEATURE) {
         if (report_id == REPORTID_FEATURE) {
             buffer[0] = 0x03;
@@ -113,70 +225,32 @@ uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_t
     return 0;
 }
 
-static uint8_t ptp_input_mode = 0x00;
-
 void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t const *buffer, uint16_t bufsize) {
-    (void)instance;
+    if (instance == 0 && report_type == HID_REPORT_TYPE_FEATURE) {
+        generic_feature_set(buffer, bufsize);
+        return;
+    }
 
     uint8_t command = buffer[0];
 
     if (report_type == HID_REPORT_TYPE_FEATURE && report_id == REPORTID_FEATURE) {
         if (bufsize >= 1) {
-            ptp_input_mode = buffer[0];
+            tp_mode_host(buffer[0]);
         }
     }
 
     if (command == REPORTID_DFU_CMD) {
         enter_dfu_mode();
     }
-}
 
-#define USB_CONNECTED BIT0
-
-EventGroupHandle_t usb_event_group;
-
-static uint8_t last_ptp_input_mode = 0xFF;
-
-void usb_mount_task(void *arg) {
-    while (1) {
-
-        xEventGroupWaitBits(
-            usb_event_group,
-            USB_CONNECTED,
-            pdTRUE,
-            pdTRUE,
-            portMAX_DELAY
-        );
-        
-        ptp_input_mode = 0x00; 
-        last_ptp_input_mode = 0xFF;
-
-        while (tud_mounted()) {
-
-            if (ptp_input_mode != last_ptp_input_mode) {
-
-                switch (ptp_input_mode) {
-
-                case 0x03:
-                    ESP_LOGI(TAG, "Mode 0x03 detected: Activating PTP");
-                    current_mode = PTP_MODE;
-                    activate_ptp();
-                    break;
-
-                default:
-                    if (wireless_mode == 1) {
-                        ESP_LOGW(TAG, "Mode 0x%02X detected: Activating Default Mouse Mode", ptp_input_mode);
-                        current_mode = MOUSE_MODE;
-                        activate_mouse();
-                    }
-                    break;
-                }
-
-                last_ptp_input_mode = ptp_input_mode;
-            }
-
-            vTaskDelay(pdMS_TO_TICKS(100));
-        }
+    if (instance == 0 && command == GENERIC_CMD_CAPTURE_START) {
+        tp_capture_start();
+    } else if (instance == 0 && command == GENERIC_CMD_CAPTURE_STOP) {
+        tp_capture_stop();
+    } else if (instance == 0 && command == GENERIC_CMD_STRESS_START) {
+        tp_sched_stress_start();
+    } else if (instance == 0 && command == GENERIC_CMD_STRESS_STOP) {
+        tp_sched_stress_stop();
     }
 }
 
@@ -184,12 +258,13 @@ static void tinyusb_event_cb(tinyusb_event_t *event, void *arg) {
     switch (event->id) {
 
         case TINYUSB_EVENT_ATTACHED:
-            xEventGroupSetBits(usb_event_group, USB_CONNECTED);
+            tp_boot_mark(TP_BOOT_USB_MOUNTED);
+            // A newly configured host starts in mouse mode
+            tp_mode_host(0x00);
             break;
 
         case TINYUSB_EVENT_DETACHED:
-            xEventGroupClearBits(usb_event_group, USB_CONNECTED);
-            ptp_input_mode = 0x00;
+            tp_mode_host(0x00);
             break;
 
         case TINYUSB_EVENT_SUSPENDED:
@@ -204,7 +279,11 @@ static void tinyusb_event_cb(tinyusb_event_t *event, void *arg) {
 }
 
 void usbhid_init(void) {
+    // esp_tinyusb runs tud_task() in its own task, blocked on the TinyUSB
+    // event queue, so nothing else may call it.
     tinyusb_config_t tusb_cfg = TINYUSB_DEFAULT_CONFIG();
+    tusb_cfg.task.priority = tp_tasks[TP_TASK_USB].priority;
+    tusb_cfg.task.size = tp_tasks[TP_TASK_USB].stack;
     tusb_cfg.descriptor.device = &desc_device;
     tusb_cfg.descriptor.full_speed_config = desc_configuration;
     tusb_cfg.descriptor.string = string_desc;
@@ -212,84 +291,105 @@ void usbhid_init(void) {
     tusb_cfg.descriptor.string_count = sizeof(string_desc)/sizeof(string_desc[0]);
 
     ESP_ERROR_CHECK(tinyusb_driver_install(&tusb_cfg));
+    tp_boot_mark(TP_BOOT_USB_STARTED);
+}
+
+static TaskHandle_t hid_task = NULL;
+
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint16_t len) {
+    (void)report; (void)len;
+
+    if (instance == 1) {
+        hid_sched_ptp_complete();
+    }
+
+    // Endpoint free again: let usbhid_task send what is still queued
+    if (hid_task != NULL) {
+        xTaskNotifyGive(hid_task);
+    }
+}
+
+// Queued frames stay in the pipe while the endpoint is busy; when USB is
+// not mounted they are consumed and lost as before.
+static bool hid_endpoint_ready(uint8_t instance) {
+    return wireless_mode != 1 || !tud_mounted() || tud_hid_n_ready(instance);
+}
+
+// Wired touch reports wait for the USB frame before the host's next poll
+static bool ptp_report_due(void) {
+    return wireless_mode != 1 || hid_sched_ptp_due(tp_pipe_touch_pending());
 }
 
 void usbhid_task(void *arg) {
     tp_multi_msg_t msg;
     mouse_msg_t mouse_msg;
-    wireless_msg_t pkt = {0};
+    bool backlog = false;
+    TickType_t link_wait = portMAX_DELAY;
+
+    hid_task = xTaskGetCurrentTaskHandle();
+    wl_tx_set_task(hid_task);
+    hid_sched_init(hid_task);
 
     while (1) {
 
-        QueueSetMemberHandle_t xActivatedMember = xQueueSelectFromSet(main_queue_set, portMAX_DELAY);
+        ulTaskNotifyTake(pdTRUE, backlog ? pdMS_TO_TICKS(1) : link_wait);
+        tp_sched_woken(TP_TASK_HID);
 
-        if (xActivatedMember == mouse_queue) {
-            if (xQueueReceive(mouse_queue, &mouse_msg, portMAX_DELAY)) {
+        while (hid_endpoint_ready(2) && tp_pipe_next_mouse(&mouse_msg)) {
 
-                mouse_hid_report_t report = {0};
+            mouse_hid_report_t report = {0};
 
-                int move_x = (int)(mouse_msg.x * SENSITIVITY);
-                int move_y = (int)(mouse_msg.y * SENSITIVITY);
+            int move_x = (int)(mouse_msg.x * SENSITIVITY);
+            int move_y = (int)(mouse_msg.y * SENSITIVITY);
 
-                if (move_x > 127)  move_x = 127;
-                if (move_x < -127) move_x = -127;
+            if (move_x > 127)  move_x = 127;
+            if (move_x < -127) move_x = -127;
 
-                if (move_y > 127)  move_y = 127;
-                if (move_y < -127) move_y = -127;
+            if (move_y > 127)  move_y = 127;
+            if (move_y < -127) move_y = -127;
 
-                report.x = (int8_t)move_x;
-                report.y = (int8_t)move_y;
+            report.x = (int8_t)move_x;
+            report.y = (int8_t)move_y;
 
-                report.buttons = mouse_msg.buttons & 0x07;
+            report.buttons = mouse_msg.buttons & 0x07;
 
-                // ESP_LOGI(TAG, "X: %d, y:%d", report.x, report.y);
+            // ESP_LOGI(TAG, "X: %d, y:%d", report.x, report.y);
 
-                if (wireless_mode == 1) {
-                    if (tud_hid_n_ready(2)) {
-                        tud_hid_n_report(2, REPORTID_MOUSE, &report, sizeof(report));
-                    } 
-                } else {
-                    pkt.type = MOUSE_MODE;
-                    pkt.payload.mouse = report;
-                    esp_now_send(receiver_mac, (uint8_t*)&pkt, sizeof(pkt));
+            if (wireless_mode == 1) {
+                if (!tud_hid_n_report(2, REPORTID_MOUSE, &report, sizeof(report))) {
+                    tp_count(TP_CNT_HID_REJECTED);
                 }
+            } else {
+                wl_tx_send_mouse(&report);
             }
-        } else if (xActivatedMember == tp_queue) {
-            if (xQueueReceive(tp_queue, &msg, portMAX_DELAY)) {
-
-                ptp_report_t report = {0};
-
-
-                report.scan_time = msg.scan_time;
-                
-                for (int i = 0; i < 5; i++) {
-                    report.fingers[i].x = msg.fingers[i].x;
-                    report.fingers[i].y = msg.fingers[i].y;
-                    
-                    uint8_t base_id;
-                    if (msg.fingers[i].confidence == 1) {
-                        base_id = msg.fingers[i].tip_switch ? 0x03 : 0x01;
-                    } else {
-                        base_id = 0x02;
-                    }
-
-                    report.fingers[i].tip_conf_id = (i << 2) | base_id;
-                }
+        }
 
-                report.contact_count = msg.actual_count;
+        while (hid_endpoint_ready(1) && ptp_report_due() && tp_pipe_next_touch(&msg)) {
+            uint32_t dequeue_us = tp_latency_now();
 
-                report.buttons = (msg.button_mask > 0) ? 0x01 : 0x00;
+            ptp_report_t report;
+            ptp_report_build(&msg, &report);
 
-                if (wireless_mode == 1) {
-                    if (tud_hid_n_ready(1)) {
-                        tud_hid_n_report(1, REPORTID_TOUCHPAD, &report, sizeof(report));
-                    }
+            if (wireless_mode == 1) {
+                if (tud_hid_n_report(1, REPORTID_TOUCHPAD, &report, sizeof(report))) {
+                    hid_sched_ptp_sent();
                 } else {
-                    pkt.type = PTP_MODE;
-                    pkt.payload.ptp = report;
-                    esp_now_send(receiver_mac, (uint8_t*)&pkt, sizeof(pkt));
+                    tp_count(TP_CNT_HID_REJECTED);
                 }
+            } else {
+                wl_tx_send_ptp(&report, msg.capture_ticks);
             }
+
+            tp_latency_record(&msg.trace, dequeue_us, tp_latency_now());
         }
+
+        if (wireless_mode != 1) {
+            link_wait = wl_tx_poll();
+        } else if (tud_mounted() && ((tp_pipe_touch_pending() && !tud_hid_n_ready(1)) ||
+                                     (tp_pipe_mouse_pending() && !tud_hid_n_ready(2)))) {
+            tp_count(TP_CNT_HID_BUSY);
+        }
+
+        backlog = tp_pipe_touch_pending() || tp_pipe_mouse_pending();
     }
 }
@@ -4,14 +4,16 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+#include "i2c/tp_driver.h"
+
 void usbhid_task(void *arg);
 void usbhid_init(void);
-void usb_mount_task(void *arg);
 
-extern const uint8_t ptp_hid_report_descriptor[];
+void ptp_report_desc_set_model(const tp_driver_t *drv);
+
+extern uint8_t ptp_hid_report_descriptor[];
 extern const uint8_t mouse_hid_report_descriptor[];
 extern const uint8_t generic_hid_report_descriptor[];
 extern const uint8_t desc_configuration[];
-extern EventGroupHandle_t usb_event_group;
 
 #endif
\ No newline at end of file
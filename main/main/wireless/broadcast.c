@@ -1,39 +1,24 @@
 #include "wireless/wireless.h"
 #include "i2c/I2C_HID_Report.h"
+#include "wl_proto.h"
 #include "esp_wifi.h"
 #include "esp_now.h"
-#include "esp_log.h"
+#include "tp_mode.h"
 #include <stdint.h>
 
-static const char *TAG = "BROADCAST";
-
-static uint8_t last_ptp_input_mode = 0xFF;
+static wl_decoder_t decoder;
 
+// Runs in the Wi-Fi task: mode commands are only handed to tp_mode, which
+// switches the controller and acknowledges them.
 void wifi_now_recv_cb(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len) {
-    if (wireless_mode == 0) {
-        if (len == 1) {
-            uint8_t received_cmd = data[0];
-
-            if (received_cmd != last_ptp_input_mode) {
-
-                if (received_cmd == PTP_MODE) {
-                    ESP_LOGI(TAG, "Wireless Mode 0x03 detected: Activating PTP");
-                    current_mode = PTP_MODE;
-                    activate_ptp();
-                } 
-                else if (received_cmd == MOUSE_MODE) {
-                    ESP_LOGI(TAG, "Wireless Mode 0x01 detected: Activating Mouse");
-                    current_mode = MOUSE_MODE;
-                    activate_mouse();
-                }
+    if (wl_packet_type(&decoder, data, len) != WL_PKT_MODE) return;
+    if (len < WL_PROTO_HEADER_LEN + (int)sizeof(mode_msg_t)) return;
 
-                last_ptp_input_mode = received_cmd;
-
-            }
-        }
-    }
+    const mode_msg_t *cmd = (const mode_msg_t *)wl_payload(data);
+    tp_mode_radio(cmd->mode, cmd->token);
 }
 
 void wireless_init() {
+    wl_decoder_init(&decoder);
     esp_now_register_recv_cb(wifi_now_recv_cb);
-}
\ No newline at end of file
+}
@@ -1,5 +1,6 @@
 #include "i2c/I2C_HID_Report.h"
 #include "wireless/wireless.h"
+#include "wl_proto.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_timer.h"
@@ -10,8 +11,8 @@
 bool stop_heartbeat = false;
 
 void alive_heartbeat_task(void *pvParameters) {
-    wireless_msg_t alive_pkt;
-    alive_pkt.type = ALIVE_MODE;
+    alive_msg_t alive;
+    uint8_t pkt[WL_PROTO_MAX_PACKET];
     
     while (1) {
         if (stop_heartbeat) {
@@ -20,11 +21,14 @@ void alive_heartbeat_task(void *pvParameters) {
 
         // ESP_LOGW("HeartBeat", "Starting Alive Heartbeat Task");
 
-        alive_pkt.payload.alive.battery_level = 100;
-        alive_pkt.payload.alive.uptime = xTaskGetTickCount() * portTICK_PERIOD_MS / 1000;
-        alive_pkt.payload.alive.vbus_level = wireless_mode;
+        alive.battery_level = 100;
+        alive.uptime = xTaskGetTickCount() * portTICK_PERIOD_MS / 1000;
+        alive.vbus_level = wireless_mode;
+        alive.mode = current_mode;
+        alive.clock_us = (uint32_t)(esp_timer_get_time() % WL_PROTO_CLOCK_PERIOD_US);
 
-        esp_now_send(receiver_mac, (uint8_t*)&alive_pkt, sizeof(alive_pkt));
+        size_t len = wl_encode_status(WL_PKT_ALIVE, &alive, sizeof(alive), pkt);
+        esp_now_send(receiver_mac, pkt, len);
 
         vTaskDelay(pdMS_TO_TICKS(1000));
     }
@@ -5,21 +5,23 @@
 #include "esp_timer.h"
 #include "esp_log.h"
 #include "esp_wifi.h"
-#include "nvs_flash.h"
 #include "esp_now.h"
 #include "i2c/I2C_HID_Report.h"
 #include "wireless/wireless.h"
+#include "wl_proto.h"
+#include "wireless/wl_tx.h"
 
 #include "freertos/semphr.h"
 
 #include "sdkconfig.h"
+#include "tp_boot.h"
+#include "tp_mode.h"
+#include "tp_tasks.h"
 
 #define TAG "VBUS_DET"
 
 #define ESPNOW_CHANNEL 1
 
-wireless_msg_t pkt = {0};
-
 uint8_t receiver_mac[6];
 
 void parse_mac_from_config() {
@@ -53,22 +55,16 @@ static void IRAM_ATTR vbus_det_gpio_isr_handler(void* arg) {
     stop_heartbeat = true;
 }
 
-void vbus_processor_task(void *pvParameters) {
-    pkt.type = VBUS_STATUS;
-    while (1) {
-        if (xSemaphoreTake(vbus_sem, portMAX_DELAY)) {
-            pkt.payload.vbus.vbus_level = wireless_mode;
-            esp_err_t ret = esp_now_send(receiver_mac, (uint8_t *)&pkt, sizeof(pkt));
-            ESP_LOGI(TAG, "VBUS Changed: %d, Send status: %s", wireless_mode, esp_err_to_name(ret));
-        }
-    }
+static esp_err_t send_vbus_status(void) {
+    uint8_t pkt[WL_PROTO_MAX_PACKET];
+    vbus_msg_t vbus = { .vbus_level = wireless_mode };
+    size_t len = wl_encode_status(WL_PKT_VBUS, &vbus, sizeof(vbus), pkt);
+    return esp_now_send(receiver_mac, pkt, len);
 }
 
-void vbus_det_init(void) {
-
-    pkt.type = VBUS_STATUS;
-
-    ESP_ERROR_CHECK(nvs_flash_init());
+// Runs on the vbus task, so app_main can start USB and the touch pad
+// while Wi-Fi comes up. NVS is already initialised by nvs_mode_init().
+static void radio_init(void) {
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
@@ -77,6 +73,9 @@ void vbus_det_init(void) {
     ESP_ERROR_CHECK(esp_wifi_start());
 
     ESP_ERROR_CHECK(esp_now_init());
+    // Whatever the VBUS level: wl_tx waits on these acks once it sends,
+    // which a wired boot also does after VBUS is lost
+    ESP_ERROR_CHECK(esp_now_register_send_cb(wl_tx_send_cb));
 
     esp_now_peer_info_t peer = {};
 
@@ -87,33 +86,55 @@ void vbus_det_init(void) {
     peer.encrypt = false;
     ESP_ERROR_CHECK(esp_now_add_peer(&peer));
 
-    vbus_sem = xSemaphoreCreateBinary();
-    
-    xTaskCreate(vbus_processor_task, "vbus_task", 4096, NULL, 5, NULL);
-
-    gpio_config_t io_conf = {
-        .intr_type = GPIO_INTR_ANYEDGE,
-        .mode = GPIO_MODE_INPUT,
-        .pin_bit_mask = (1ULL << GPIO_NUM_5),
-        .pull_up_en = GPIO_PULLUP_DISABLE,
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-    };
-    gpio_config(&io_conf);
+    tp_boot_mark(TP_BOOT_RADIO_READY);
 
     gpio_isr_handler_add(GPIO_NUM_5, vbus_det_gpio_isr_handler, NULL);
 
     wireless_mode = gpio_get_level(GPIO_NUM_5);
     
-    pkt.payload.vbus.vbus_level = wireless_mode;
-    
-    esp_now_send(receiver_mac, (uint8_t *)&pkt, sizeof(pkt));
+    send_vbus_status();
 
     if (wireless_mode == 0) {
-        xTaskCreate(alive_heartbeat_task, "heartbeat", 2048, NULL, 2, NULL);
+        tp_task_create(TP_TASK_HEARTBEAT, alive_heartbeat_task, NULL, NULL);
         stop_heartbeat = false;
         // ESP_LOGI(TAG, "Wireless mode currently, forcing PTP mode activation");
         // current_mode = PTP_MODE;
         // elan_activate_ptp();
+
+        // Mode commands from the receiver go to tp_mode
         wireless_init();
     }
+}
+
+void vbus_processor_task(void *pvParameters) {
+    radio_init();
+
+    while (1) {
+        if (xSemaphoreTake(vbus_sem, portMAX_DELAY)) {
+            esp_err_t ret = send_vbus_status();
+            ESP_LOGI(TAG, "VBUS Changed: %d, Send status: %s", wireless_mode, esp_err_to_name(ret));
+            tp_mode_vbus();
+        }
+    }
+}
+
+// Reads the VBUS level and hands the radio bring-up to the vbus task.
+void vbus_det_init(void) {
+
+    wl_tx_init();
+
+    vbus_sem = xSemaphoreCreateBinary();
+
+    gpio_config_t io_conf = {
+        .intr_type = GPIO_INTR_ANYEDGE,
+        .mode = GPIO_MODE_INPUT,
+        .pin_bit_mask = (1ULL << GPIO_NUM_5),
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+    };
+    gpio_config(&io_conf);
+
+    wireless_mode = gpio_get_level(GPIO_NUM_5);
+
+    tp_task_create(TP_TASK_VBUS, vbus_processor_task, NULL, NULL);
 }
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_now.h"
+#include "esp_timer.h"
+
+#include "i2c/I2C_HID_Report.h"
+#include "wireless/wireless.h"
+#include "wl_proto.h"
+#include "wireless/wl_tx.h"
+#include "trace/tp_counters.h"
+#include "trace/tp_log.h"
+
+static const char *TAG = "WL_TX";
+
+static wl_encoder_t encoder;
+
+// Updated from the Wi-Fi task by the send callback
+static atomic_bool send_failed;     // the receiver did not acknowledge a packet
+static atomic_bool ack_pending;     // last packet sent, status not known yet
+static atomic_int congestion;       // +WL_TX_FAIL_WEIGHT per failure, -1 per ack
+
+static TaskHandle_t tx_task = NULL;
+static uint32_t send_errors;
+
+static uint8_t batch[WL_PROTO_MAX_BATCH];
+static size_t batch_len = 0;
+static int64_t batch_since_us;
+
+static int64_t last_send_us;
+static bool repeat_due = false;
+
+void wl_tx_init(void) {
+    wl_encoder_init(&encoder);
+    atomic_init(&send_failed, false);
+    atomic_init(&ack_pending, false);
+    atomic_init(&congestion, 0);
+}
+
+void wl_tx_set_task(TaskHandle_t task) {
+    tx_task = task;
+}
+
+void wl_tx_send_cb(const esp_now_send_info_t *tx_info, esp_now_send_status_t status) {
+    int level = atomic_load(&congestion);
+
+    if (status != ESP_NOW_SEND_SUCCESS) {
+        tp_count(TP_CNT_ESPNOW_NO_ACK);
+        atomic_store(&send_failed, true);
+        level += WL_TX_FAIL_WEIGHT;
+        if (level > 2 * WL_TX_CONGESTED) level = 2 * WL_TX_CONGESTED;
+    } else if (level > 0) {
+        level--;
+    }
+    atomic_store(&congestion, level);
+    atomic_store(&ack_pending, false);
+
+    // A held batch can go out now that the air is free
+    if (batch_len > 0 && tx_task != NULL) {
+        xTaskNotifyGive(tx_task);
+    }
+}
+
+static void send_packet(const uint8_t *pkt, size_t len) {
+    atomic_store(&ack_pending, true);
+    last_send_us = esp_timer_get_time();
+
+    if (esp_now_send(receiver_mac, pkt, len) != ESP_OK) {
+        tp_count(TP_CNT_ESPNOW_SEND_FAILED);
+        if (send_errors++ == 0) {
+            TP_LOGW(TAG, "esp_now_send failed, resending state as keyframes");
+        }
+        atomic_store(&ack_pending, false);
+        wl_encoder_resync(&encoder);
+    }
+}
+
+static void flush_batch(void) {
+    if (batch_len == 0) return;
+
+    send_packet(batch, batch_len);
+    batch_len = 0;
+}
+
+static void check_acks(void) {
+    if (atomic_exchange(&send_failed, false)) {
+        wl_encoder_resync(&encoder);
+    }
+}
+
+// Frames go out one per packet while the link keeps up. Once failures pile
+// up, frames wait in a batch while a packet is in flight.
+static void queue_packet(const uint8_t *pkt, size_t len) {
+    bool congested = atomic_load(&congestion) >= WL_TX_CONGESTED;
+
+    if (!congested && batch_len == 0) {
+        send_packet(pkt, len);
+        return;
+    }
+
+    size_t n = wl_batch_add(batch, batch_len, pkt, len);
+    if (n == 0) {
+        flush_batch();
+        n = wl_batch_add(batch, 0, pkt, len);
+    }
+    if (batch_len == 0) batch_since_us = esp_timer_get_time();
+    batch_len = n;
+
+    if (!congested || !atomic_load(&ack_pending)) {
+        flush_batch();
+    }
+}
+
+void wl_tx_send_ptp(const ptp_report_t *report, uint16_t capture_ticks) {
+    uint8_t pkt[WL_PROTO_MAX_PACKET];
+    ptp_report_t timed = *report;
+
+    timed.scan_time = capture_ticks;
+
+    // The receiver's descriptor has the controller's ranges
+    for (int i = 0; i < TP_MAX_CONTACTS; i++) {
+        timed.fingers[i].x = tp_output_to_raw(timed.fingers[i].x);
+        timed.fingers[i].y = tp_output_to_raw(timed.fingers[i].y);
+    }
+
+    check_acks();
+    queue_packet(pkt, wl_encode_ptp(&encoder, &timed, pkt));
+    repeat_due = true;
+}
+
+void wl_tx_send_mouse(const mouse_hid_report_t *report) {
+    uint8_t pkt[WL_PROTO_MAX_PACKET];
+
+    check_acks();
+    queue_packet(pkt, wl_encode_mouse(&encoder, report, sizeof(*report), pkt));
+}
+
+static TickType_t wait_ticks(int64_t us) {
+    TickType_t ticks = pdMS_TO_TICKS((us + 999) / 1000);
+    return ticks > 0 ? ticks : 1;
+}
+
+TickType_t wl_tx_poll(void) {
+    int64_t now = esp_timer_get_time();
+
+    check_acks();
+
+    if (batch_len > 0) {
+        int64_t age = now - batch_since_us;
+        if (!atomic_load(&ack_pending) || age >= WL_TX_BATCH_MAX_US) {
+            flush_batch();
+        } else {
+            return wait_ticks(WL_TX_BATCH_MAX_US - age);
+        }
+    }
+
+    if (!repeat_due) return portMAX_DELAY;
+
+    // No new frame since the last state change: repeat it over the air
+    int64_t idle = now - last_send_us;
+    if (idle < WL_PROTO_REPEAT_MS * 1000) {
+        return wait_ticks(WL_PROTO_REPEAT_MS * 1000 - idle);
+    }
+
+    uint8_t pkt[WL_PROTO_MAX_PACKET];
+    size_t len = wl_encode_repeat(&encoder, pkt);
+    if (len > 0) {
+        send_packet(pkt, len);
+    }
+
+    repeat_due = wl_encoder_repeat_pending(&encoder) || atomic_load(&ack_pending);
+    return repeat_due ? pdMS_TO_TICKS(WL_PROTO_REPEAT_MS) : portMAX_DELAY;
+}
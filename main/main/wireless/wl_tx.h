@@ -0,0 +1,35 @@
+#ifndef WL_TX_H
+#define WL_TX_H
+
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_now.h"
+
+#include "i2c/I2C_HID_Report.h"
+
+// Transmit side of the ESP-NOW link, called from usbhid_task only. Sends
+// that fail locally or are not acknowledged by the receiver make the
+// encoder owe keyframes again.
+//
+// While the link keeps up every frame is sent at once. When unacknowledged
+// sends pile up, frames are packed into one batch packet while the
+// previous packet is still in flight, for at most WL_TX_BATCH_MAX_US.
+
+#define WL_TX_FAIL_WEIGHT       4
+#define WL_TX_CONGESTED         8       // congestion level that enables batching
+#define WL_TX_BATCH_MAX_US      16000   // about two frames at 125 Hz
+
+void wl_tx_init(void);
+void wl_tx_set_task(TaskHandle_t task);
+void wl_tx_send_cb(const esp_now_send_info_t *tx_info, esp_now_send_status_t status);
+
+// scan_time is replaced by capture_ticks (see wl_proto.h).
+void wl_tx_send_ptp(const ptp_report_t *report, uint16_t capture_ticks);
+void wl_tx_send_mouse(const mouse_hid_report_t *report);
+
+// Flushes a due batch and sends owed keyframe repeats. Returns how long
+// the caller may wait for new frames before calling it again.
+TickType_t wl_tx_poll(void);
+
+#endif